@@ -16,36 +16,52 @@
 #include "RequestHandler.hpp"
 #include <string>
 #include <map>
+#include <sys/types.h>
 
-// CGI 실행을 담당하는 핸들러
+// CGI 실행 준비/실행을 담당하는 핸들러
 // RFC 3147 (CGI 1.1) 기반
-class CgiHandler : public RequestHandler {
+// - 실제 입출력은 Server의 event loop가 pipe를 직접 감시하며 처리 (blocking 없음)
+// - 이 클래스는 경로/인터프리터/환경 변수 준비, fork+exec, 출력 헤더 해석만 맡는다
+class CgiHandler {
 public:
     CgiHandler();
-    virtual ~CgiHandler();
+    ~CgiHandler();
 
-    virtual HttpResponse handle(const HttpRequest& request,
-                                const LocationConfig& location);
+    // 스크립트 경로 / 인터프리터 확인 후 환경 변수 구성
+    // 실패하면 false, errorResponse에 상태 코드가 설정됨
+    bool prepare(const HttpRequest& request, const LocationConfig& location,
+                 HttpResponse& errorResponse);
 
-private:
-    // CGI 환경 변수 생성
-    std::map<std::string, std::string> buildEnv(
-        const HttpRequest& request,
-        const LocationConfig& location,
-        const std::string& scriptPath) const;
+    // fastcgi_pass용: 스크립트는 FastCGI 서버가 찾으므로 stat / 인터프리터 확인 없이 환경 변수만
+    bool prepareFastCgi(const HttpRequest& request, const LocationConfig& location,
+                        HttpResponse& errorResponse);
+
+    // prepare 이후 구성된 환경 변수 (FastCGI PARAMS로 전달)
+    const std::map<std::string, std::string>& environment() const;
 
-    // CGI 스크립트 실행 및 출력 캡처
-    std::string executeCgi(
-        const std::string& scriptPath,
-        const std::string& interpreter,
-        const std::map<std::string, std::string>& env,
-        const std::string& body) const;
+    // prepare 이후 호출. stdin 쓰기 끝 / stdout 읽기 끝을 돌려준다 (둘 다 close-on-exec)
+    // 실패하면 -1
+    pid_t spawn(int& stdinFd, int& stdoutFd) const;
+
+    // 출력에서 헤더 끝 위치 (빈 줄 다음). 아직 없으면 npos
+    static size_t findHeaderEnd(const std::string& output);
 
     // CGI 출력 파싱 (헤더와 바디 분리)
     void parseCgiOutput(const std::string& output,
                         std::map<std::string, std::string>& headers,
                         std::string& body) const;
 
+    // Status 헤더와 나머지 CGI 헤더를 응답에 반영
+    void applyCgiHeaders(std::map<std::string, std::string>& headers,
+                         HttpResponse& response) const;
+
+private:
+    // CGI 환경 변수 생성
+    std::map<std::string, std::string> buildEnv(
+        const HttpRequest& request,
+        const LocationConfig& location,
+        const std::string& scriptPath) const;
+
     // 파일 확장자로 인터프리터 결정
     std::string getInterpreter(const std::string& path,
                               const LocationConfig& location) const;
@@ -54,10 +70,11 @@ private:
     std::string buildScriptPath(const std::string& uri,
                                 const LocationConfig& location) const;
 
-    // 타임아웃 처리
-    bool waitWithTimeout(pid_t pid, int& status, int timeoutSec) const;
-
     std::string trim(const std::string& s) const;
+
+    std::string scriptPath;
+    std::string interpreter;
+    std::map<std::string, std::string> env;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef CGIPROCESS_HPP
+#define CGIPROCESS_HPP
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Deflater.hpp"
+#include "ProxyHandler.hpp"
+#include "ResponseCache.hpp"
+
+class ServerConfig;
+class UpstreamPool;
+class UpstreamGroup;
+
+// 실행 중인 CGI 하나의 상태 (Server가 소유)
+// - stdin/stdout pipe는 event loop에 등록되어 조금씩 쓰고/읽는다
+// - 종료 상태는 SIGCHLD(self-pipe) 후 waitpid(WNOHANG)로 회수
+// - 출력 끝(EOF) + 종료 회수가 모두 끝나야 응답을 마무리
+// - fastcgi_pass이면 자식 프로세스 대신 pool에서 빌린 upstream 연결 하나로 주고받고
+//   END_REQUEST 레코드가 종료 회수를 대신한다 (pid == -1)
+// - proxy_pass도 같은 upstream 연결 경로를 쓰고, HTTP 응답의 바디 끝이 종료 회수를 대신한다
+// - cache_path location의 miss면 클라이언트로 보내는 바디를 캐시 파일에도 쓴다 (cacheFill)
+// - 같은 GET을 기다리는 연결이 있을 수 있으면 (flightKey) 응답 사본을 메모리에도 모은다
+struct CgiProcess {
+    pid_t pid;
+    int inFd;                   // -1 이면 닫힘 (body 전송 완료)
+    int outFd;                  // -1 이면 닫힘 (EOF)
+    int clientFd;
+    unsigned long clientId;     // clientFd 재사용 구분
+    unsigned long response;     // 클라이언트 연결의 응답 자리 (pipelining 순서)
+    const ServerConfig* cfg;    // 에러 페이지용
+
+    std::string body;           // CGI stdin으로 보낼 요청 바디 (메모리)
+    int bodyFd;                 // 임시 파일로 받은 바디 (요청 fd를 dup, -1 이면 body 사용)
+    size_t bodySize;
+    size_t bodyPos;
+    std::string output;         // 헤더 해석 전(또는 비스트리밍) 출력
+
+    bool keepAlive;
+    bool streaming;             // HTTP/1.1: 헤더 해석 즉시 chunked로 전달
+    bool headersSent;
+    bool discard;               // 에러 페이지로 대체됨 / HEAD: 남은 출력은 버림
+    bool paused;                // 클라이언트 쪽 출력 큐가 가득 차 stdout 읽기 중지
+    bool detached;              // 클라이언트가 먼저 끊김: 회수만 기다림
+    bool exited;
+    bool failed;                // 비정상 종료 / 잘못된 출력: 502 또는 응답 중단
+    bool headOnly;              // HEAD: 헤더만 보내고 바디 출력은 버림
+
+    std::string acceptEncoding; // 요청의 Accept-Encoding (요청 객체는 곧 reset됨)
+    Deflater* deflater;         // 스트리밍 응답을 gzip으로 보낼 때 (조각마다 sync flush)
+
+    UpstreamPool* pool;
+    int upstreamFd;
+    bool reusedConn;            // idle 연결 재사용: 응답 전에 끊기면 새 연결로 한 번 재시도
+    bool gotResponse;
+    std::string requestHead;    // BEGIN_REQUEST + PARAMS / HTTP 요청 헤더 (재시도 때 다시 보냄)
+    std::string request;        // 보낼 바이트: 비면 body에서 다음 조각(STDIN 레코드)을 채운다
+    size_t requestPos;
+    bool stdinDone;             // 바디 끝까지 채움 (FastCGI는 빈 STDIN 레코드 포함)
+    std::string records;        // 아직 해석하지 않은 응답 레코드
+
+    bool proxy;                 // proxy_pass: upstream이 HTTP 서버
+    ProxyHandler upstream;      // upstream 응답 헤더 / 바디 경계 해석
+    bool rawBody;               // 바디를 chunk로 감싸지 않고 그대로 (Content-Length를 알 때)
+    UpstreamGroup* group;       // proxy_pass 대상 upstream 그룹
+    int backend;                // 지금 쓰는 backend (-1: 없음 / 결과 기록 끝)
+    std::vector<bool> tried;    // 이미 시도한 backend (응답 전 실패 시 다른 backend로)
+    std::string hashKey;        // hash 방식이면 요청에서 뽑은 키
+    bool idempotent;            // 요청을 보낸 뒤 실패해도 다른 backend로 다시 보내도 되는지
+    bool requestSent;           // 현재 연결로 요청 바이트를 보내기 시작함
+
+    ResponseCache* cache;       // 응답을 저장할 캐시 (NULL: 저장 안 함)
+    std::string cacheKey;
+    int cacheValid;             // cache_valid
+    ResponseCache::RequestHeaders requestHeaders;   // Vary 비교용 요청 헤더 사본
+    ResponseCache::Fill* cacheFill;     // 응답 헤더를 보낸 뒤 저장 중인 바디
+
+    std::string flightKey;      // 비어 있지 않으면 같은 요청의 대표: 끝날 때 기다리던 연결에 응답
+    bool flightCopy;            // 아래 사본이 보낸 응답과 같음 (에러 페이지 교체 / 한도 초과면 false)
+    int flightStatus;
+    std::vector<ResponseCache::Header> flightHeaders;
+    std::string flightBody;
+
+    CgiProcess()
+    : pid(-1), inFd(-1), outFd(-1), clientFd(-1), clientId(0), response(0), cfg(NULL),
+      bodyFd(-1), bodySize(0), bodyPos(0),
+      keepAlive(false), streaming(false), headersSent(false), discard(false),
+      paused(false), detached(false), exited(false), failed(false), headOnly(false), deflater(NULL),
+      pool(NULL), upstreamFd(-1), reusedConn(false), gotResponse(false), requestPos(0),
+      stdinDone(false), proxy(false), rawBody(false), group(NULL), backend(-1),
+      idempotent(false), requestSent(false), cache(NULL), cacheValid(0), cacheFill(NULL),
+      flightCopy(false), flightStatus(0) {}
+
+    ~CgiProcess() {
+        if (bodyFd != -1)
+            ::close(bodyFd);
+        delete deflater;
+        if (cacheFill != NULL)
+            cache->abandon(cacheFill);
+    }
+
+private:
+    CgiProcess(const CgiProcess&);
+    CgiProcess& operator=(const CgiProcess&);
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include "Token.hpp"
 #include "ConfigTokenizer.hpp"
 #include "ServerConfig.hpp"
+#include "UpstreamConfig.hpp"
 #include "ConfigException.hpp"
 #include <fstream>
 #include <sstream> // std::stringstream
@@ -29,7 +30,8 @@ enum	ParseState
 {
 	STATE_GLOBAL,
 	STATE_SERVER,
-	STATE_LOCATION
+	STATE_LOCATION,
+	STATE_UPSTREAM
 };
 
 /* Config 파일 전체 소유, parse state 구조 검증까지 담당 */
@@ -58,15 +60,20 @@ class	Config
 			bool	expectingServerBrace; // server 이후 '{' 반드시 기다려야 하는 상태면 true, '{' 를 만나면 false (기다리지 않아도 됨)
 			bool	expectingLocationBrace; // location 이후 '{' 반드시 기다려야 하는 상태면 true, '{' 를 만나면 false (기다리지 않아도 됨)
 
+			UpstreamConfig	currentUpstream;
+			bool	upstreamOpened;
+
 			// 생성자
 			ParserContext() : state(STATE_GLOBAL), i(0), currentLocation(0), serverOpened(false),
-				locationOpened(false), expectingServerBrace(false), expectingLocationBrace(false) {}
+				locationOpened(false), expectingServerBrace(false), expectingLocationBrace(false),
+				upstreamOpened(false) {}
 		};
 
 		/* State handlers */
 		void	handleGlobalState(ParserContext& ctx);
 		void	handleServerState(ParserContext& ctx);
 		void	handleLocationState(ParserContext& ctx);
+		void	handleUpstreamState(ParserContext& ctx);
 
 		/* utils */
 		std::string	openConfigFile(const std::string& filePath); // 내부 준비 작업이므로 private
@@ -75,6 +82,7 @@ class	Config
 		std::string					_content;
 		std::vector<Token>			_tokens;
 		std::vector<ServerConfig>	_servers;
+		std::vector<UpstreamConfig>	_upstreams;
 };
 
 #endif
@@ -2,7 +2,16 @@
 #define CONNECTION_HPP
 
 #include <string>
+#include <deque>
+#include <vector>
 #include <ctime>
+#include <sys/types.h>
+
+#include "HttpRequest.hpp"
+#include "SharedBuffer.hpp"
+#include "VhostTable.hpp"
+
+struct CgiProcess;
 
 class Connection {
 public:
@@ -11,10 +20,12 @@ public:
         WRITING
     };
 
-    explicit Connection(int fd);
+    // id: accept 순서대로 붙는 serial (같은 fd 번호 재사용과 구분)
+    Connection(int fd, unsigned long id);
     ~Connection();
 
     int fd() const;
+    unsigned long id() const;
     State state() const;
 
     // I/O (non-blocking)
@@ -25,8 +36,61 @@ public:
     std::string& inBuf();
     const std::string& inBuf() const;
 
+    // accept한 리스너 포트의 virtual host 테이블 (Server 소유)
+    const VhostTable* vhosts() const;
+    void setVhosts(const VhostTable* table);
+
+    // 파싱 중인 요청 (read 사이에 파서 위치 유지)
+    HttpRequest& request();
+    void resetRequest();
+
+    // 응답 자리 (HTTP/1.1 pipelining): 요청마다 하나, 요청 순서대로 (id는 1부터)
+    // - 맨 앞 응답은 출력 큐로 바로 쓰고, 뒤 응답은 앞 응답이 모두 끝날 때까지 자리별로 모아 둔다
+    //   그래서 CGI / upstream 응답이 늦어도 뒤 요청은 먼저 처리되고, 보내는 순서는 요청 순서 그대로
+    // - queue* / appendBuffer는 selectResponse로 고른 자리에 쓴다
+    unsigned long beginResponse();              // 새 자리를 열고 선택
+    void selectResponse(unsigned long id);
+    unsigned long currentResponse() const;
+    void endResponse(unsigned long id);         // 응답이 끝남: 앞에서부터 끝난 응답을 출력 큐로
+    // 연결을 닫게 된 응답 뒤의 자리를 버린다 (CGI는 호출 전에 정리해야 함)
+    void dropResponsesAfter(unsigned long id);
+    size_t openResponses() const;               // 아직 끝나지 않은 응답 수
+    bool responseBusy(unsigned long id) const;  // CGI / single-flight 대기로 아직 만드는 중
+    unsigned long firstResponse() const;        // 가장 앞의 끝나지 않은 응답 (없으면 0)
+
+    // 응답을 만드는 중인 CGI / FastCGI / upstream 요청
+    CgiProcess* responseCgi(unsigned long id) const;
+    void setResponseCgi(unsigned long id, CgiProcess* cgi);
+    void collectCgis(std::vector<CgiProcess*>& out) const;
+
+    // single-flight 대기: 파싱 중인 요청을 자리로 옮겨 두고 (파서는 다음 요청으로) 깨어날 때 돌려받는다
+    void holdRequest(unsigned long id);
+    HttpRequest* takeHeldRequest(unsigned long id);     // 호출한 쪽이 delete
+
+    // 이 응답이 끝날 때까지 다음 요청을 시작하지 않는다 (GET / HEAD가 아닌 요청)
+    void blockPipeline(unsigned long id);
+    bool pipelineBlocked() const;
+
+    // 출력 큐: 소유 버퍼 / 공유 불변 버퍼 / 파일 구간
+    // 연속된 메모리 구간은 onWritable에서 sendmsg(iovec) 한 번으로 묶어 전송
     void queueWrite(const std::string& bytes);
+    // 출력 큐 끝의 소유 버퍼에 직접 쓰기 (응답 헤더 직렬화용)
+    // 새 구간이 필요하면 전송이 끝난 버퍼의 capacity를 재사용
+    std::string& appendBuffer();
+    // bytes를 복사하지 않고 가져온다 (호출 후 bytes는 비워짐)
+    void queueOwned(std::string& bytes);
+    // 캐시된 헤더/바디처럼 여러 응답이 공유하는 버퍼를 참조만 추가
+    void queueShared(const SharedBuffer& buf);
+    // 파일 구간을 출력 큐에 추가 (fd 소유권 이전). onWritable에서 sendfile로 전송
+    void queueFile(int fileFd, off_t offset, size_t length);
     bool hasPendingWrite() const;
+    // 이 응답 앞에 쌓인 바이트 수 (CGI 출력 backpressure 판단용)
+    // 맨 앞 응답이면 출력 큐 전체, 뒤 응답이면 자기 자리에 모아 둔 바이트
+    size_t pendingBytes(unsigned long id) const;
+
+    // reactor에 WRITE 관심이 등록되어 있는지 (상태가 바뀔 때만 modify)
+    bool writeArmed() const;
+    void setWriteArmed(bool armed);
 
     void closeAfterWrite();
     bool shouldCloseAfterWrite() const;
@@ -35,19 +99,87 @@ public:
     void incRequestCount();
     int requestCount() const;
 
+    // touch()는 시각만 갱신: timer wheel 항목은 만료 시점에 lazy하게 재예약
     void touch();
     std::time_t lastActive() const;
 
+    // wheel에 걸려 있는 가장 이른 deadline (그 외 항목은 stale)
+    std::time_t timerDeadline() const;
+    void setTimerDeadline(std::time_t deadline);
+
 private:
+    enum SegmentKind {
+        SEG_OWNED,
+        SEG_SHARED,
+        SEG_FILE
+    };
+
+    // 출력 큐의 한 구간
+    struct OutSegment {
+        SegmentKind kind;
+        std::string bytes;     // SEG_OWNED
+        SharedBuffer shared;   // SEG_SHARED
+        size_t pos;            // 메모리 구간 중 이미 보낸 위치
+        int fileFd;            // SEG_FILE
+        off_t fileOffset;
+        size_t fileRemaining;
+
+        OutSegment();
+        const char* data() const;
+        size_t size() const;
+    };
+
+    // 요청 하나의 응답 자리
+    struct Response {
+        unsigned long id;
+        std::deque<OutSegment> out;     // 앞 응답을 기다리는 출력 (맨 앞 자리는 _out에 바로 쓴다)
+        CgiProcess* cgi;
+        HttpRequest* held;              // single-flight 대기 중인 요청 (소유)
+        bool done;
+        bool blocking;
+
+        Response();
+    };
+
+    // sendmsg 한 번에 묶을 최대 구간 수 (IOV_MAX보다 충분히 작게)
+    static const int MAX_IOV = 64;
+
+    enum WriteResult {
+        WRITE_OK,
+        WRITE_PARTIAL,
+        WRITE_RETRY,
+        WRITE_FATAL
+    };
+
+    WriteResult writeHead();
+    WriteResult writeMemory();
+    WriteResult writeFile();
+    void popHead();
+    static void closeSegments(std::deque<OutSegment>& segs);
+    static size_t segmentBytes(const std::deque<OutSegment>& segs);
+
+    Response* findResponse(unsigned long id);
+    const Response* findResponse(unsigned long id) const;
+    // queue* / appendBuffer가 쓸 곳 (선택한 응답이 맨 앞이면 _out)
+    std::deque<OutSegment>& target();
+
     int _fd;
+    unsigned long _id;
     State _state;
 
-    std::string _in;
-    std::string _out;
-    size_t _outPos;  // write offset to avoid repeated erase
+    const VhostTable* _vhosts;
+    std::string _in;     // 아직 파서가 소비하지 않은 바이트
+    HttpRequest* _req;
+    std::deque<OutSegment> _out;
+    std::deque<Response> _responses;    // 끝나지 않은 응답 (요청 순서)
+    unsigned long _responseSeq;
+    unsigned long _selected;
+    std::string _spare;  // 다 보낸 소유 버퍼 (appendBuffer에서 재사용)
 
     bool _closeAfterWrite;
+    bool _writeArmed;
     std::time_t _lastActive;
+    std::time_t _timerDeadline;
     int _requestsHandled;
     int _readFailStreak;
     int _writeFailStreak;
@@ -0,0 +1,74 @@
+#ifndef DEFLATER_HPP
+#define DEFLATER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// DEFLATE (RFC 1951) 스트리밍 인코더 + gzip (RFC 1952) / zlib (RFC 1950) 래퍼
+// - LZ77: 3바이트 해시 체인으로 최근 32KB 안에서 일치 구간 탐색
+//   level이 높을수록 체인을 길게 따라가고, 4 이상은 lazy match (한 칸 뒤가 더 길면 literal)
+// - 블록마다 dynamic Huffman / fixed Huffman / stored 중 비트 수가 가장 작은 것을 고른다
+// - write(): 블록 크기만큼 모일 때마다 출력
+//   flush(): 받은 입력을 모두 내보내고 바이트 경계로 맞춤 (sync flush, 스트리밍 응답의 조각 단위)
+//   finish(): 마지막 블록 + 트레일러 (CRC32 / Adler-32)
+// - 외부 라이브러리(zlib) 없이 구현
+class Deflater {
+public:
+    enum Format {
+        FORMAT_GZIP,    // Content-Encoding: gzip
+        FORMAT_ZLIB     // Content-Encoding: deflate (zlib 래퍼를 씌운 DEFLATE)
+    };
+
+    // level: 1 (빠름) ~ 9 (작게)
+    Deflater(Format format, int level);
+
+    // 출력은 out 뒤에 덧붙인다
+    void write(const char* data, size_t len, std::string& out);
+    void flush(std::string& out);
+    void finish(std::string& out);
+
+    // 한 번에 압축
+    static void compress(Format format, int level, const char* data, size_t len, std::string& out);
+
+private:
+    struct Symbol {
+        unsigned short litLen;  // literal 바이트 또는 일치 길이
+        unsigned short dist;    // 0이면 literal
+    };
+
+    void writeHeader(std::string& out);
+    void compressBlock(bool final, std::string& out);
+    void findSymbols(size_t begin, size_t end);
+    size_t longestMatch(size_t pos, size_t end, size_t& dist) const;
+    void insertUpTo(size_t absLimit);
+    void emitBlock(bool final, size_t rawBegin, size_t rawLen, std::string& out);
+    void emitSymbols(const unsigned short* litCodes, const unsigned char* litLens,
+                     const unsigned short* distCodes, const unsigned char* distLens,
+                     std::string& out);
+    void putBits(unsigned int bits, int count, std::string& out);
+    void alignToByte(std::string& out);
+
+    Format _format;
+    int _maxChain;
+    size_t _niceLength;
+    bool _lazy;
+
+    std::string _window;            // [최근 32KB 창 | 아직 압축하지 않은 입력]
+    size_t _windowStart;            // _window[0]의 스트림 내 절대 위치
+    size_t _pending;                // 압축하지 않은 입력이 시작하는 _window 내 위치
+    size_t _hashed;                 // 다음에 해시에 넣을 절대 위치
+    std::vector<size_t> _head;      // 해시 -> 가장 최근 절대 위치 + 1 (0 = 없음)
+    std::vector<size_t> _prev;      // (절대 위치 & 창 마스크) -> 같은 해시의 이전 위치 + 1
+    std::vector<Symbol> _symbols;
+
+    unsigned long _bitBuf;
+    int _bitCount;
+    unsigned long _crc;
+    unsigned long _adler;
+    unsigned long _totalIn;
+    bool _headerDone;
+    bool _finished;
+};
+
+#endif
@@ -27,7 +27,7 @@ public:
     static HttpResponse buildError(int code,
                                    const std::map<int, std::string>& errorPages);
 
-private:
+    // 아래는 ErrorPageCache가 바디를 한 번만 만들 때도 사용
     // 기본 에러 HTML 템플릿
     static std::string getDefaultErrorPage(int code, const std::string& message);
     
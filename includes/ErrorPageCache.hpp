@@ -0,0 +1,47 @@
+#ifndef ERRORPAGECACHE_HPP
+#define ERRORPAGECACHE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <ctime>
+#include <sys/types.h>
+
+#include "HttpResponse.hpp"
+#include "SharedBuffer.hpp"
+#include "GzipFilter.hpp"
+
+// 에러 응답 바디 캐시 (worker마다 하나, 락 없음)
+// - (에러 페이지 경로, 상태 코드)마다 HTML을 한 번만 만들고 SharedBuffer로 공유
+//   404 폭주에도 기본 페이지 생성 / 커스텀 페이지 파일 읽기를 반복하지 않는다
+// - 커스텀 페이지는 dev/inode/mtime/size가 바뀌면 다시 읽는다 (stat은 항목당 1초에 한 번까지)
+// - gzip 압축본도 항목에 붙여 둔다 (coding + level별, 페이지가 바뀌면 함께 버림)
+class ErrorPageCache {
+public:
+    ErrorPageCache();
+
+    HttpResponse build(int code, const std::string& pagePath,
+                       const GzipFilter& gzip, const std::string& acceptEncoding);
+
+private:
+    struct Entry {
+        SharedBuffer body;
+        bool found;             // 커스텀 페이지 파일이 있었는지
+        dev_t dev;
+        ino_t ino;
+        time_t mtime;
+        off_t size;
+        time_t checkedAt;
+        std::vector<std::pair<std::string, SharedBuffer> > variants;
+    };
+
+    Entry& refresh(int code, const std::string& pagePath);
+
+    std::map<std::pair<std::string, int>, Entry> _entries;
+
+    ErrorPageCache(const ErrorPageCache&);
+    ErrorPageCache& operator=(const ErrorPageCache&);
+};
+
+#endif
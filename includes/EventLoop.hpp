@@ -0,0 +1,70 @@
+#ifndef EVENTLOOP_HPP
+#define EVENTLOOP_HPP
+
+#include <vector>
+#include <poll.h>
+
+#ifdef __linux__
+# define WEBSERV_HAVE_EPOLL 1
+# include <sys/epoll.h>
+#endif
+
+// fd readiness multiplexer.
+// - epoll backend: fd는 한 번만 등록하고, 관심 이벤트가 바뀔 때만 modify
+// - poll backend: epoll이 없는 환경을 위한 fallback (fd -> index 테이블로 O(1) 갱신)
+class EventLoop {
+public:
+    enum Backend {
+        BACKEND_POLL,
+        BACKEND_EPOLL
+    };
+
+    // backend 독립적인 이벤트 비트
+    enum {
+        EVENT_READ = 1,
+        EVENT_WRITE = 2,
+        EVENT_ERROR = 4
+    };
+
+    struct Event {
+        int fd;
+        int events;
+    };
+
+    explicit EventLoop(Backend backend);
+    ~EventLoop();
+
+    // 빌드 환경에서 사용 가능한 가장 좋은 backend
+    static Backend defaultBackend();
+    static bool isAvailable(Backend backend);
+
+    Backend backend() const;
+    const char* backendName() const;
+
+    void add(int fd, int events);
+    void modify(int fd, int events);
+    void remove(int fd);
+
+    // ready 이벤트만 out에 채운다. 반환값은 ready 개수, 에러 시 -1 (errno 유지)
+    int wait(std::vector<Event>& out, int timeoutMs);
+
+private:
+    static short toPollEvents(int events);
+    static int fromPollEvents(short revents);
+
+    Backend _backend;
+    int _epfd;
+
+    // poll backend
+    std::vector<pollfd> _pfds;
+    std::vector<int> _pollIndex; // fd -> _pfds index (-1 = 미등록)
+
+#ifdef WEBSERV_HAVE_EPOLL
+    std::vector<epoll_event> _epEvents;
+#endif
+
+    EventLoop(const EventLoop&);
+    EventLoop& operator=(const EventLoop&);
+};
+
+#endif
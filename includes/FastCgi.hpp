@@ -0,0 +1,51 @@
+#ifndef FASTCGI_HPP
+#define FASTCGI_HPP
+
+#include <string>
+#include <map>
+#include <cstddef>
+
+// FastCGI 1.0 레코드 인코딩 / 디코딩 (Responder role만)
+// - 요청: BEGIN_REQUEST + PARAMS 스트림 + STDIN 스트림 (빈 레코드로 스트림 끝)
+// - 응답: STDOUT(CGI 출력과 같은 형식) / STDERR / END_REQUEST
+class FastCgi {
+public:
+    enum RecordType {
+        BEGIN_REQUEST = 1,
+        ABORT_REQUEST = 2,
+        END_REQUEST = 3,
+        PARAMS = 4,
+        STDIN = 5,
+        STDOUT = 6,
+        STDERR = 7
+    };
+
+    // END_REQUEST protocolStatus
+    enum { REQUEST_COMPLETE = 0 };
+
+    // 버퍼 안의 레코드 하나 (content는 offset으로만 가리킴: 복사 없음)
+    struct Record {
+        unsigned char type;
+        unsigned short requestId;
+        size_t contentOffset;
+        size_t contentLength;
+    };
+
+    // keepConn: 응답 후 서버가 연결을 닫지 않도록 (FCGI_KEEP_CONN)
+    static void appendBeginRequest(std::string& out, unsigned short requestId, bool keepConn);
+    static void appendParams(std::string& out, unsigned short requestId,
+                             const std::map<std::string, std::string>& params);
+    // 65535 바이트 단위로 나눠 붙인다. len == 0 이면 스트림 끝 레코드
+    static void appendStream(std::string& out, unsigned char type, unsigned short requestId,
+                             const char* data, size_t len);
+
+    // buf[pos..]에 완성된 레코드가 있으면 rec을 채우고 pos를 다음 레코드로 옮긴다
+    static bool nextRecord(const std::string& buf, size_t& pos, Record& rec);
+
+private:
+    static void appendHeader(std::string& out, unsigned char type, unsigned short requestId,
+                             size_t contentLength, unsigned char padding);
+    static void appendLength(std::string& out, size_t len);
+};
+
+#endif
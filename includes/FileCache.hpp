@@ -0,0 +1,83 @@
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "SharedBuffer.hpp"
+
+// location 단위 정적 파일 LRU 캐시
+// - key: 실제 파일 경로, 유효성: stat 결과의 dev/inode/mtime/size가 모두 같을 때만 hit
+// - 바디는 SharedBuffer라 응답 여러 개가 복사 없이 같은 내용을 전송
+// - Content-Type / Last-Modified 헤더 값도 미리 만들어 둔다
+// - gzip 압축본도 항목에 붙여 둔다: 같은 파일을 요청마다 다시 압축하지 않음
+//   (압축본 바이트도 캐시 한도에 포함, 파일이 바뀌면 항목과 함께 버려짐)
+// - worker 프로세스마다 따로 가진다 (공유/락 없음)
+class FileCache {
+public:
+    struct Entry {
+        std::string path;
+        dev_t dev;
+        ino_t ino;
+        time_t mtime;
+        off_t size;
+        SharedBuffer body;
+        std::string contentType;
+        std::string lastModified;
+        std::vector<std::pair<std::string, SharedBuffer> > variants;  // coding -> 압축된 바디
+    };
+
+    struct Stats {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+        size_t entries;
+        size_t bytes;
+    };
+
+    FileCache(size_t maxBytes, size_t maxEntrySize);
+
+    // st는 방금 stat한 결과. 내용이 바뀌었으면 항목을 버리고 NULL (miss)
+    const Entry* lookup(const std::string& path, const struct stat& st);
+
+    // 캐시에 넣을 수 있는 크기인지 (읽기 전에 확인)
+    bool admits(size_t size) const;
+
+    // body는 swap으로 가져간다. 넣지 못하면 NULL
+    const Entry* insert(const std::string& path, const struct stat& st, std::string& body,
+                        const std::string& contentType, const std::string& lastModified);
+
+    // lookup / insert가 돌려준 항목의 압축본. 없으면 NULL
+    const SharedBuffer* variant(const Entry* entry, const std::string& coding) const;
+    // bytes는 swap으로 가져간다. 한도를 넘으면 다른 항목을 밀어내고, 그래도 안 되면 NULL
+    const SharedBuffer* addVariant(const Entry* entry, const std::string& coding, std::string& bytes);
+
+    Stats stats() const;
+
+private:
+    typedef std::list<Entry> LruList;   // front = 가장 최근 사용
+
+    void evictOne();
+    void erase(LruList::iterator it);
+
+    size_t _maxBytes;
+    size_t _maxEntrySize;
+    size_t _bytes;
+    LruList _lru;
+    std::map<std::string, LruList::iterator> _index;
+
+    unsigned long _hits;
+    unsigned long _misses;
+    unsigned long _evictions;
+
+    FileCache(const FileCache&);
+    FileCache& operator=(const FileCache&);
+};
+
+#endif
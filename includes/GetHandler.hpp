@@ -14,22 +14,43 @@
 #define GETHANDLER_HPP
 
 #include "RequestHandler.hpp"
+#include "FileCache.hpp"
+#include "GzipFilter.hpp"
 #include <sys/stat.h>
 
 class GETHandler : public RequestHandler {
 public:
+    // cache: location에 file_cache가 설정된 경우 Server가 넘겨줌 (없으면 NULL)
+    // gzip: server 블록의 gzip 설정 (캐시된 파일의 압축본을 만들 때 사용)
+    GETHandler(FileCache* cache = NULL, const GzipFilter* gzip = NULL);
     virtual HttpResponse handle(const HttpRequest& request,
                                 const LocationConfig& location);
 
 private:
     // 디렉토리 처리
-    HttpResponse handleDirectory(const std::string& path,
-                                 const std::string& uri,
+    HttpResponse handleDirectory(const HttpRequest& request,
+                                 const std::string& path,
                                  const LocationConfig& location);
     
-    // 파일 처리
-    HttpResponse handleFile(const std::string& path,
-                           const struct stat& st);
+    // 파일 처리 (gzip_static이면 보낼 표현을 고른 뒤 serveFile)
+    HttpResponse handleFile(const HttpRequest& request,
+                           const std::string& path,
+                           const struct stat& st,
+                           const LocationConfig& location);
+    HttpResponse serveFile(const HttpRequest& request,
+                           const std::string& path,
+                           const struct stat& st,
+                           const std::string& mime,
+                           bool mayCompress);
+
+    // 조건부 요청 (ETag / If-*)
+    std::string makeETag(const struct stat& st) const;
+    int evaluatePreconditions(const HttpRequest& request, const struct stat& st,
+                              const std::string& etag) const;
+    // Range / If-Range
+    bool applyRange(const HttpRequest& request, const std::string& path,
+                    const struct stat& st, const std::string& etag,
+                    const std::string& mime, HttpResponse& response) const;
 
     // 경로 빌드 및 검증
     std::string buildPath(const std::string& uri,
@@ -39,6 +60,7 @@ private:
 
     // 파일 읽기
     std::string readFile(const std::string& path) const;
+    bool readWhole(const std::string& path, size_t size, std::string& out) const;
     
     // autoindex HTML 생성
     std::string generateAutoIndex(const std::string& path,
@@ -46,6 +68,10 @@ private:
     
     // MIME 타입 결정
     std::string getMimeType(const std::string& path) const;
+    std::string formatHttpDate(time_t t) const;
+
+    FileCache* cache;
+    const GzipFilter* gzip;
 };
 
 #endif
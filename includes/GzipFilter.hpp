@@ -0,0 +1,41 @@
+#ifndef GZIPFILTER_HPP
+#define GZIPFILTER_HPP
+
+#include <string>
+#include <cstddef>
+
+#include "ServerConfig.hpp"
+#include "HttpResponse.hpp"
+#include "Deflater.hpp"
+
+// server 블록의 gzip 설정으로 응답 바디를 압축하는 필터
+// - Accept-Encoding 협상: gzip 우선, 그다음 deflate (q=0은 거부, 목록에 없으면 "*"를 따른다)
+// - 대상: gzip_types에 있는 Content-Type + gzip_min_length 이상인 메모리 바디
+//   (autoindex, 에러 페이지, 버퍼링한 CGI 출력 등). 파일 바디는 sendfile 경로를 그대로 둔다
+// - 캐시된 정적 파일의 압축본은 GETHandler가 FileCache에 보관해 재사용
+// - 스트리밍 CGI 응답은 Server가 Deflater를 직접 붙여 조각마다 sync flush
+class GzipFilter {
+public:
+    explicit GzipFilter(const ServerConfig& cfg);
+
+    static bool acceptsEncoding(const std::string& acceptEncoding, const char* coding);
+    static Deflater::Format formatOf(const char* coding);
+    // Vary에 Accept-Encoding을 더한다 (CGI / upstream이 보낸 Vary는 그대로 두고 뒤에 붙임)
+    static void addVary(HttpResponse& response);
+
+    bool enabled() const;
+    int level() const;
+    // 압축 대상 타입인지 (Vary를 붙일지도 이걸로 결정)
+    bool matchesType(const std::string& contentType) const;
+    bool matches(const std::string& contentType, size_t size) const;
+    // 요청이 받을 수 있는 coding ("gzip" / "deflate"). 없거나 gzip off면 NULL
+    const char* negotiate(const std::string& acceptEncoding) const;
+
+    // 메모리 바디 응답을 그 자리에서 압축 (대상이 아니면 그대로)
+    void apply(const std::string& acceptEncoding, HttpResponse& response) const;
+
+private:
+    const ServerConfig& _cfg;
+};
+
+#endif
@@ -17,6 +17,8 @@
 #include <map>
 #include <ctime>
 
+class MultipartParser;
+
 // 향상된 HTTP 요청 파서
 // - 요청 크기 제한
 // - 타임아웃 추적
@@ -25,9 +27,25 @@
 class HttpRequest {
 public:
     HttpRequest();
+    ~HttpRequest();
+
+    // 연결 입력 버퍼에서 이번 요청에 속한 바이트만 소비한다. (incremental)
+    // - 헤더: in 안에서 이전 검색 위치부터 "\r\n\r\n"을 찾고, 완성되면 헤더만 잘라낸다
+    // - 바디: 새로 들어온 바이트만 body에 옮기고 in에서 제거
+    // 다음 요청(pipelining)의 바이트는 in에 그대로 남는다.
+    // 요청이 완성되면 true
+    // 바디가 있는 요청은 헤더까지만 읽고 멈춘다: setBodyPolicy() 후 다시 consume
+    bool consume(std::string& in);
 
-    // 소켓에서 읽은 raw data를 누적
-    bool appendData(const std::string& data);
+    // 헤더가 끝났고 바디 정책(최대 크기 / 메모리 버퍼 크기)을 기다리는 중
+    // Host로 server 블록이 정해져야 client_max_body_size를 알 수 있기 때문
+    bool awaitingBodyPolicy() const;
+    // bufferSize를 넘는 바디는 받는 즉시 임시 파일로 옮긴다 (메모리 사용량 고정)
+    // Content-Length가 이미 maxBodySize를 넘으면 ERROR_REQUEST_TOO_LARGE
+    void setBodyPolicy(size_t maxBodySize, size_t bufferSize);
+    // 업로드 location의 multipart 바디: 저장하지 않고 도착하는 대로 파서로 흘려보낸다
+    // (setBodyPolicy 전에 호출, 파일 part는 uploadDir에 바로 기록)
+    void streamMultipart(const std::string& boundary, const std::string& uploadDir);
 
     // 상태 확인
     bool isComplete() const;
@@ -43,7 +61,8 @@ public:
         ERROR_INVALID_REQUEST_LINE,
         ERROR_INVALID_HEADER,
         ERROR_TIMEOUT,
-        ERROR_MALFORMED_CHUNKED
+        ERROR_MALFORMED_CHUNKED,
+        ERROR_BODY_STORAGE      // 임시 파일 생성 / 쓰기 실패
     };
     
     ErrorType getErrorType() const;
@@ -54,7 +73,16 @@ public:
     const std::string& getURI() const;
     const std::string& getVersion() const;
     const std::map<std::string, std::string>& getHeaders() const;
+    // 메모리 바디 (임시 파일로 옮겨졌으면 비어 있음)
     const std::string& getBody() const;
+    // 바디 길이 (메모리 / 파일 공통)
+    size_t getBodySize() const;
+    // 임시 파일로 옮겨진 바디: 이미 unlink된 파일의 fd (reset 때 닫힘)
+    // 오래 써야 하는 쪽(CGI 등)은 dup해서 가져간다
+    bool isBodyInFile() const;
+    int getBodyFd() const;
+    // streamMultipart로 받은 바디의 결과 (없으면 NULL)
+    const MultipartParser* getMultipart() const;
 
     // CHECK) getter 추가
     size_t  getConsumedLength() const;
@@ -69,8 +97,12 @@ public:
 private:
     void parseRequestLine(const std::string& line);
     void parseHeaders(const std::string& block);
-    bool parseBody();
-    bool parseChunkedBody();
+    bool parseBody(std::string& in);
+    bool parseChunkedBody(std::string& in);
+    bool hasBody() const;
+    // 바디 바이트 추가: 메모리 한도를 넘으면 임시 파일로 전환
+    bool appendBody(const char* data, size_t len);
+    bool spoolBodyToFile();
     
     // 검증 메서드
     bool validateRequestLine();
@@ -90,13 +122,28 @@ private:
     void setError(ErrorType type);
 
 private:
+    // chunked body 파싱 상태 (read 사이에 위치 유지)
+    enum ChunkState {
+        CHUNK_SIZE,     // "<hex>\r\n" 대기
+        CHUNK_DATA,     // chunkRemaining 바이트 대기
+        CHUNK_DATA_END, // chunk 데이터 뒤 "\r\n" 대기
+        CHUNK_LAST_END  // 마지막 "0\r\n" 뒤 "\r\n" 대기
+    };
+
     // 요청 데이터
-    std::string rawBuffer;
     std::string method;
     std::string uri;
     std::string version;
     std::map<std::string, std::string> headers;
     std::string body;
+    size_t bodySize;
+    int bodyFd;             // -1 이면 메모리 바디
+    MultipartParser* multipart;
+
+    // 바디 정책 (setBodyPolicy)
+    bool bodyPolicySet;
+    size_t maxBodySize;
+    size_t bodyBufferSize;
 
     // 상태 플래그
     bool headersParsed;
@@ -108,25 +155,32 @@ private:
     // 크기 정보
     size_t contentLength;
     bool chunked;
-    size_t bodyStart;
+
+    // incremental 파싱 위치
+    size_t headerScanPos;   // in에서 "\r\n\r\n" 검색을 재개할 위치
+    ChunkState chunkState;
+    size_t chunkRemaining;
     
     // 타임아웃 추적
     time_t lastActivityTime;
     
     // 보안 제한 (설정 가능하도록 static const로)
-    static const size_t MAX_REQUEST_SIZE = 10 * 1024 * 1024;  // 10MB
+    static const size_t MAX_REQUEST_SIZE = 10 * 1024 * 1024;  // 10MB (정책 설정 전 기본값)
+    static const size_t DEFAULT_BODY_BUFFER_SIZE = 16 * 1024;  // 16KB
     static const size_t MAX_HEADER_SIZE = 8 * 1024;            // 8KB
     static const size_t MAX_URI_LENGTH = 2048;                 // 2KB
     static const size_t MAX_LINE_LENGTH = 8192;                // 8KB
     static const size_t MAX_HEADERS_COUNT = 100;               // 100개
 
     // CHECK)
-    // ex) rawBuffer에 [요청1][요청2] 있다고 가정
+    // ex) 연결 버퍼에 [요청1][요청2] 있다고 가정
     // 요청1 길이 = 52 bytes : consumedLength = 52
-    // server에서 in.erase(0, 52); -> 다음 버퍼(요청 2)를 읽기 위해
-    // [요청2]만 남음
-    // 이 작업을 위해 멤버변수 생성
+    // consume()이 요청1의 바이트만 in에서 제거 -> [요청2]만 남음
     size_t consumedLength;
+
+    // 임시 파일 fd를 소유하므로 복사 금지
+    HttpRequest(const HttpRequest&);
+    HttpRequest& operator=(const HttpRequest&);
 };
 
 #endif
@@ -23,6 +23,8 @@ class	HttpRequestValidator
 {
 	public:
 		static HttpParseResult	validate(const HttpRequest& request);
+		// 헤더까지만 읽은 요청 검사 (버전 / Host / 메서드 / 바디 길이 헤더)
+		static HttpParseResult	validateHeaders(const HttpRequest& request);
 	
 	private:
 		// 내부 구현 세부사항이라 private
@@ -14,12 +14,19 @@
 #define HTTPRESPONSE_HPP
 
 #include <string>
-#include <map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <sys/types.h>
+
+#include "SharedBuffer.hpp"
 
 // 향상된 HTTP 응답 클래스
 // - Keep-Alive 지원
 // - Chunked transfer encoding 지원
 // - 자동 헤더 관리 (Date, Server, Content-Length 등)
+// - 자주 쓰는 헤더는 전용 필드로 들고 있다가 직렬화 때 바로 출력 (map 조회 없음)
+//   그 외 헤더는 설정 순서대로 작은 vector에 보관
 class HttpResponse {
 public:
     HttpResponse();
@@ -27,12 +34,54 @@ public:
     // 상태 코드 설정
     void setStatus(int code);
     
-    // 헤더 설정
+    // 헤더 설정 (이름은 대소문자 구분 없이 같은 헤더로 취급)
     void setHeader(const std::string& key, const std::string& value);
+    // 같은 이름이 있어도 덮어쓰지 않고 한 줄 더 (Set-Cookie처럼 반복되는 헤더)
+    void addHeader(const std::string& key, const std::string& value);
+    // 추가 헤더 값 (없으면 빈 문자열)
+    std::string getHeader(const std::string& key) const;
+    // setHeader / addHeader로 넣은 헤더 전체 (설정 순서, Content-Type 등 전용 필드는 제외)
+    const std::vector<std::pair<std::string, std::string> >& getHeaders() const;
     void setContentType(const std::string& type);
+    // 실제로 나갈 Content-Type (설정 안 했으면 기본값)
+    std::string getContentType() const;
     
     // 바디 설정
     void setBody(const std::string& body);
+    // 공유 바디: 캐시된 내용을 복사 없이 응답에 붙인다 (Connection::queueShared)
+    void setBody(const SharedBuffer& body);
+    bool hasSharedBody() const;
+    const SharedBuffer& getSharedBody() const;
+    // 메모리 바디를 복사 없이 꺼낸다 (호출 후 응답의 바디는 비워짐)
+    void takeBody(std::string& out);
+    size_t getBodySize() const;
+    // 바디를 응답 밖에서 따로 흘려보낼 때 Content-Length만 지정 (proxy_pass 등)
+    void setContentLength(size_t length);
+    // HEAD: 헤더 (Content-Length 포함)는 GET과 같게 두고 바디만 버린다
+    void dropBody();
+
+    // 파일 기반 바디: 내용을 메모리에 올리지 않고 전송 단계에서 sendfile
+    // toHeaderString()은 헤더만 만들고, 파일 구간은 Connection::queueFile로 넘긴다.
+    void setFileBody(const std::string& path, size_t length);
+    // 이미 열린 파일 (임시 파일로 받은 요청 바디 등). fd는 빌려 쓰기만 하고 큐에 넣을 때 dup
+    void setFileBody(int fd, size_t length);
+    bool hasFileBody() const;
+    const std::string& getFilePath() const;
+    int getFileFd() const;     // path로 지정했으면 -1
+    size_t getFileLength() const;
+
+    // Range 응답: 파일 전체 대신 [offset, offset + length) 구간들을 보낸다
+    // 각 구간 앞에 prefix (multipart/byteranges의 part 헤더), 마지막에 suffix (닫는 구분자)
+    // 구간이 없으면 파일 전체
+    struct FileSegment {
+        std::string prefix;
+        off_t offset;
+        size_t length;
+    };
+    void addFileSegment(const std::string& prefix, off_t offset, size_t length);
+    void setFileSuffix(const std::string& suffix);
+    const std::vector<FileSegment>& getFileSegments() const;
+    const std::string& getFileSuffix() const;
     
     // Keep-Alive 설정
     // timeout: 초 단위, max: 최대 요청 수
@@ -42,24 +91,44 @@ public:
     void setChunked(bool enable);
     
     // 응답 문자열 생성
-    std::string toString();
-    std::string toChunkedString();
+    // appendHeaders: 상태줄 + 헤더 + 빈 줄을 out 뒤에 덧붙인다 (연결별 버퍼 재사용용)
+    void appendHeaders(std::string& out) const;
+    std::string toHeaderString() const;
+    std::string toString() const;
+    std::string toChunkedString() const;
     
     // Keep-Alive 상태 확인
     bool isKeepAlive() const;
     int getStatusCode() const;
 
+    // 초 단위로 캐시된 현재 시각의 HTTP-date ("Sun, 06 Nov 1994 08:49:37 GMT")
+    static const std::string& currentDate();
+    // HTTP-date 파싱 (IMF-fixdate, 폐기된 RFC 850 / asctime 형식도 받아야 함). 실패하면 false
+    static bool parseHttpDate(const std::string& value, time_t& out);
+
 private:
-    std::string getStatusMessage(int code) const;
-    void ensureHeaders();
+    typedef std::pair<std::string, std::string> HeaderField;
+
+    size_t contentLength() const;
 
 private:
     int statusCode;
-    std::string statusMessage;
-    std::map<std::string, std::string> headers;
+    std::string contentType;        // 비어 있으면 기본값 text/html
+    std::vector<HeaderField> extraHeaders;
     std::string body;
+    SharedBuffer sharedBody; // null이 아니면 body 대신 사용
+    std::string filePath;   // 비어 있으면 메모리 바디
+    size_t fileLength;
+    int fileFd;             // 빌린 fd (-1 이면 filePath 사용)
+    std::vector<FileSegment> fileSegments;
+    std::string fileSuffix;
+    size_t declaredLength;
+    bool hasDeclaredLength;
     
     bool keepAlive;
+    bool connectionSet;     // setKeepAlive 호출 여부 (Connection / Keep-Alive 헤더 출력)
+    int keepAliveTimeout;
+    int keepAliveMax;
     bool chunked;
 };
 
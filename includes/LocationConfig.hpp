@@ -17,6 +17,7 @@
 #include "ConfigException.hpp"
 #include "ConfigTypes.hpp"
 #include "ConfigUtils.hpp"
+#include "UpstreamConfig.hpp"
 #include <vector>
 #include <map>
 
@@ -49,7 +50,30 @@ class	LocationConfig
 		const std::string&				getUploadStore(void) const;
 		bool							hasCgiPass(void) const;
 		const std::map<std::string, std::string>&	getCgiPass(void) const;
+		/* fastcgi_pass: location의 모든 요청을 FastCGI 서버로 (unix:/path 또는 host:port) */
+		bool							hasFastCgiPass(void) const;
+		const std::string&				getFastCgiPass(void) const;
+		/* proxy_pass: location의 모든 요청을 HTTP upstream으로 (http://host:port[/uri] 또는 http://upstream이름) */
+		bool							hasProxyPass(void) const;
+		const std::string&				getProxyPass(void) const;		// upstream 이름 또는 "host:port"
+		const std::string&				getProxyPassUri(void) const;	// 비어 있으면 요청 URI 그대로
+		const UpstreamConfig&			getUpstream(void) const;		// resolveProxyPass 이후
+		/* 설정 파일을 다 읽은 뒤: 이름이 upstream 블록과 같으면 그 그룹, 아니면 주소 하나짜리 그룹 */
+		void							resolveProxyPass(const std::vector<UpstreamConfig>& upstreams);
 		void							inheritRootIfUnset(const std::string& serverRoot);
+		/* file_cache: 정적 파일 메모리 캐시 (location 단위) */
+		bool							hasFileCache(void) const;
+		size_t							getFileCacheSize(void) const;
+		size_t							getFileCacheMaxEntry(void) const;
+		/* cache_path: proxy_pass / fastcgi_pass / CGI 응답을 디스크에 캐시 (같은 경로를 쓰는 location끼리 공유) */
+		bool							hasCachePath(void) const;
+		const std::string&				getCachePath(void) const;
+		int								getCacheValid(void) const;		// Cache-Control / Expires가 없을 때 유효 시간 (초, 0 = 저장 안 함)
+		size_t							getCacheMaxSize(void) const;
+		/* stub_status: 서버 통계 페이지 */
+		bool							getStubStatus(void) const;
+		/* gzip_static: 미리 압축된 file.br / file.gz가 있으면 그 파일로 응답 */
+		bool							getGzipStatic(void) const;
 
 
 	private:
@@ -62,6 +86,15 @@ class	LocationConfig
 		void	handleAllowMethods(const std::vector<Token>& tokens, size_t& i);
 		void	handleUploadStore(const std::vector<Token>& tokens, size_t& i);
 		void	handleCgiPass(const std::vector<Token>& tokens, size_t& i);
+		void	handleFastCgiPass(const std::vector<Token>& tokens, size_t& i);
+		void	handleProxyPass(const std::vector<Token>& tokens, size_t& i);
+		void	handleFileCache(const std::vector<Token>& tokens, size_t& i);
+		void	handleFileCacheMaxEntry(const std::vector<Token>& tokens, size_t& i);
+		void	handleCachePath(const std::vector<Token>& tokens, size_t& i);
+		void	handleCacheValid(const std::vector<Token>& tokens, size_t& i);
+		void	handleCacheMaxSize(const std::vector<Token>& tokens, size_t& i);
+		void	handleStubStatus(const std::vector<Token>& tokens, size_t& i);
+		void	handleGzipStatic(const std::vector<Token>& tokens, size_t& i);
 
 		void	validatePath(void) const;
 	
@@ -93,6 +126,39 @@ class	LocationConfig
 		std::map<std::string, std::string>	_cgiPass;
 		bool								_hasCgiPass;
 
+		/* fastcgi_pass (location 전용) */
+		std::string					_fastCgiPass;
+		bool						_hasFastCgiPass;
+
+		/* proxy_pass (location 전용) */
+		std::string					_proxyPass;
+		std::string					_proxyPassUri;
+		bool						_proxyPassPortSet;
+		bool						_hasProxyPass;
+		UpstreamConfig				_upstream;
+
+		/* file_cache (location 전용) */
+		size_t						_fileCacheSize;
+		bool						_hasFileCache;
+		size_t						_fileCacheMaxEntry;
+		bool						_hasFileCacheMaxEntry;
+
+		/* cache_path / cache_valid / cache_max_size (location 전용) */
+		std::string					_cachePath;
+		bool						_hasCachePath;
+		int							_cacheValid;
+		bool						_hasCacheValid;
+		size_t						_cacheMaxSize;
+		bool						_hasCacheMaxSize;
+
+		/* stub_status */
+		bool						_stubStatus;
+		bool						_hasStubStatus;
+
+		/* gzip_static */
+		bool						_gzipStatic;
+		bool						_hasGzipStatic;
+
 };
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef MASTER_HPP
+#define MASTER_HPP
+
+#include <vector>
+#include <sys/types.h>
+
+#include "ServerConfig.hpp"
+
+// worker 프로세스 관리자
+// - worker_processes N 이면 N개의 독립 event loop(Server)를 fork
+// - 각 worker는 SO_REUSEPORT 리스너를 직접 열어 커널이 accept를 분산
+// - 연결 테이블 / 세션 저장소는 worker마다 따로 (공유 상태 없음)
+//   그래서 메모리 세션은 worker가 여러 개면 요청이 다른 worker로 가는 순간 끊긴다
+class Master {
+public:
+    explicit Master(const std::vector<ServerConfig>& cfgs);
+    ~Master();
+
+    // worker가 1개면 현재 프로세스에서 바로 Server::run()
+    int run();
+
+private:
+    int resolveWorkerCount() const;
+    pid_t spawnWorker(int id);
+    // cache_path 디렉터리 준비 (owner가 0이 아니면 그 worker가 남긴 파일만 정리)
+    bool prepareResponseCaches(pid_t owner) const;
+    void stopWorkers();
+
+    const std::vector<ServerConfig>& _configs;
+    std::vector<pid_t> _workers;
+
+    Master(const Master&);
+    Master& operator=(const Master&);
+};
+
+#endif
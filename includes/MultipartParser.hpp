@@ -0,0 +1,104 @@
+#ifndef MULTIPARTPARSER_HPP
+#define MULTIPARTPARSER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// multipart/form-data 스트리밍 파서
+// - 요청 바디가 도착하는 대로 feed()로 조각을 넘긴다 (조각 경계는 아무 곳이나 가능)
+// - 구분자("\r\n--boundary")는 Boyer-Moore-Horspool로 찾고,
+//   조각 끝에 걸칠 수 있는 마지막 (구분자 길이 - 1) 바이트만 다음 조각까지 보류
+// - 파일 part는 upload_store에 바로 쓴다: 바디 전체를 메모리에 모으지 않음
+//   (O_TMPFILE로 이름 없이 쓰다가 part가 끝나면 linkat으로 최종 이름에 연결)
+// - 끝 구분자 없이 바디가 끝나거나 형식이 깨지면 이미 저장한 파일도 지운다
+class MultipartParser {
+public:
+    struct Part {
+        enum Result {
+            FIELD,          // 일반 필드 (value에 앞부분만 보관)
+            SAVED,
+            SAVE_FAILED,
+            INVALID_NAME,   // 정리 후 남는 파일명이 없음
+            UNSAFE_PATH
+        };
+
+        std::string name;
+        std::string filename;   // 클라이언트가 보낸 원래 파일명
+        std::string savedName;  // upload_store 안에 실제로 저장된 이름 (link 후에 정해짐)
+        std::string value;
+        size_t size;
+        Result result;
+
+        Part() : size(0), result(FIELD) {}
+    };
+
+    // 필드 값은 응답 요약에 쓸 만큼만 보관
+    static const size_t FIELD_PREVIEW_MAX = 101;
+
+    // expectedLength: Content-Length (chunked면 0). 파일 part 사전 할당의 상한
+    // 사전 할당은 받은 바이트보다 PREALLOC_STEP만큼만 앞서 간다 (바디를 보내지 않는 큰 Content-Length 방지)
+    MultipartParser(const std::string& boundary, const std::string& uploadDir,
+                    size_t expectedLength);
+    ~MultipartParser();
+
+    // Content-Type 헤더에서 boundary 추출 (따옴표 / 뒤따르는 파라미터 제거)
+    static bool boundaryFromContentType(const std::string& contentType, std::string& boundary);
+
+    void feed(const char* data, size_t len);
+    // 바디 끝: 끝 구분자를 못 봤으면 malformed로 정리
+    void finish();
+
+    bool isComplete() const;
+    bool isMalformed() const;
+    bool uploadDirReady() const;
+    const std::vector<Part>& parts() const;
+
+private:
+    enum State {
+        STATE_DATA,             // part 데이터 (첫 구분자 전 preamble 포함)
+        STATE_DELIMITER_TAIL,   // 구분자 뒤 "\r\n" 또는 "--"
+        STATE_HEADERS,
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    static const size_t HEADER_BLOCK_MAX = 16 * 1024;
+    static const size_t PREALLOC_STEP = 8 * 1024 * 1024;
+
+    size_t feedData(const char* data, size_t len);
+    size_t feedDelimiterTail(const char* data, size_t len);
+    size_t feedHeaders(const char* data, size_t len);
+
+    size_t search(const char* hay, size_t len) const;
+    void emit(const char* data, size_t len);
+    void beginPart(const std::string& headerBlock);
+    void openPartFile(Part& part);
+    bool openTempFile();
+    bool linkTempFile(std::string& savedName);
+    void reserve(size_t end);
+    void closePartFile(bool commit);
+    void endPart();
+    void fail();
+
+    std::string _needle;            // "\r\n--" + boundary
+    size_t _skip[256];              // Horspool bad-character 이동 거리
+    std::string _uploadDir;
+    bool _dirReady;
+    size_t _expected;
+
+    State _state;
+    std::string _carry;             // 다음 조각과 이어 붙여 볼 꼬리 (< 구분자 길이)
+    std::string _pending;           // 구분자 뒤 / 헤더 블록 누적
+    bool _inPart;                   // false: 첫 구분자 전 (preamble)
+    int _fileFd;
+    std::string _tempPath;          // O_TMPFILE 대신 쓴 숨김 임시 파일 (없으면 빈 문자열)
+    std::string _fileName;          // 정리된 원래 파일명 (link할 이름의 기준)
+    size_t _allocated;              // 지금 part 파일에 fallocate로 잡아 둔 크기
+    std::vector<Part> _parts;
+
+    MultipartParser(const MultipartParser&);
+    MultipartParser& operator=(const MultipartParser&);
+};
+
+#endif
@@ -17,6 +17,8 @@
 #include <map>
 #include <vector>
 
+class MultipartParser;
+
 class POSTHandler : public RequestHandler {
 public:
     POSTHandler(size_t maxBodySizeBytes);
@@ -33,24 +35,14 @@ private:
     HttpResponse handleMultipart(const HttpRequest& request,
                                  const LocationConfig& location,
                                  const std::string& boundary);
-
-    // 파일 저장 관련
-    bool saveFile(const std::string& path, const std::string& data) const;
-    std::string sanitizeFilename(const std::string& name) const;
-    std::string generateUniqueFilename(const std::string& dir,
-                                      const std::string& name) const;
-    bool isPathSafe(const std::string& fullPath,
-                   const std::string& baseDir) const;
+    HttpResponse buildMultipartResponse(const MultipartParser& parser,
+                                        const LocationConfig& location) const;
 
     // Parsers
     std::map<std::string, std::string> parseUrlEncoded(const std::string& body) const;
-    bool parseMultipart(const std::string& body,
-                        const std::string& boundary,
-                        std::vector< std::map<std::string,std::string> >& parts) const;
 
     // Utils
     std::string urlDecode(const std::string& s) const;
-    std::string trim(const std::string& s) const;
     std::string toLower(const std::string& s) const;
 
 private:
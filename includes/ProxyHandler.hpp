@@ -0,0 +1,77 @@
+#ifndef PROXYHANDLER_HPP
+#define PROXYHANDLER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+class HttpRequest;
+class LocationConfig;
+
+// proxy_pass: upstream으로 보낼 HTTP/1.1 요청 헤더 만들기 + upstream 응답 해석
+// - 요청: Host는 upstream 주소로, Connection은 keep-alive로 바꾸고 hop-by-hop 헤더는 뺀다
+//   바디는 이미 디코딩되어 있으므로 (chunked 요청 포함) 항상 Content-Length로 보낸다
+// - 응답: 상태줄 + 헤더를 모은 뒤 바디 경계를 Content-Length / chunked / 연결 종료로 판단
+//   chunked 바디는 풀어서 내보내고, 응답이 끝나면 연결을 pool에 돌려줄 수 있는지 알려준다
+// - 실제 입출력은 Server의 event loop가 맡는다 (이 클래스는 바이트만 다룸)
+class ProxyHandler {
+public:
+    enum State {
+        HEAD,       // 상태줄 + 헤더를 받는 중
+        BODY,       // 바디를 받는 중
+        DONE,       // 응답 끝
+        FAILED      // 잘못된 응답
+    };
+
+    typedef std::pair<std::string, std::string> Header;
+
+    ProxyHandler();
+
+    static void buildRequestHead(const HttpRequest& request, const LocationConfig& location,
+                                 std::string& out);
+    // 클라이언트에 그대로 넘기면 안 되는 연결 단위 헤더 (RFC 9110 7.6.1)
+    static bool isHopByHop(const std::string& name);
+    // upstream 응답 헤더 중 클라이언트로 넘길 것 (hop-by-hop과 우리가 직접 쓰는 Date / Server 제외)
+    static bool passResponseHeader(const std::string& name);
+
+    // headRequest: HEAD 요청의 응답은 헤더만 온다
+    void reset(bool headRequest);
+    // upstream에서 받은 바이트를 넣는다. 바디(chunked는 디코딩한 내용)는 body 뒤에 덧붙인다
+    State feed(const char* data, size_t len, std::string& body);
+    // upstream이 연결을 닫음: 길이를 모르는 바디는 여기서 정상 종료
+    State closed();
+
+    State state() const;
+    int status() const;
+    const std::vector<Header>& headers() const;
+    // 바디가 올 응답인지 (HEAD / 204 / 304는 아님)
+    bool hasBody() const;
+    bool hasLength() const;
+    size_t length() const;
+    // 응답이 깔끔하게 끝나 연결을 재사용할 수 있는지 (keep-alive + 남은 바이트 없음)
+    bool reusable() const;
+
+private:
+    enum Framing { FRAME_NONE, FRAME_LENGTH, FRAME_CHUNKED, FRAME_CLOSE };
+    enum ChunkState { CHUNK_SIZE, CHUNK_DATA, CHUNK_DATA_END, CHUNK_TRAILER };
+
+    bool parseHead(size_t headerEnd);
+    void feedBody(const char* data, size_t len, std::string& body);
+    bool takeLine(const char* data, size_t len, size_t& pos);
+
+    State _state;
+    bool _headRequest;
+    std::string _head;          // 아직 해석하지 않은 헤더 (또는 chunk 크기 / trailer 한 줄)
+    int _status;
+    std::vector<Header> _headers;
+    bool _keepAlive;
+    bool _hasLength;
+    size_t _length;
+    Framing _framing;
+    ChunkState _chunkState;
+    size_t _remaining;          // Content-Length 또는 현재 chunk의 남은 바이트
+    bool _excess;               // 응답이 끝난 뒤에도 바이트가 옴
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef RESPONSECACHE_HPP
+#define RESPONSECACHE_HPP
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <ctime>
+#include <sys/types.h>
+
+// cache_path 디렉터리 하나에 대한 proxy / FastCGI / CGI 응답 디스크 캐시 (worker 단위)
+// - 바디는 항목마다 파일 하나 (응답 바디 바이트 그대로: gzip으로 보냈으면 압축된 바이트)
+//   hit은 이 파일을 sendfile로 보낸다
+// - 키 / 상태 / 헤더 / 크기 / 만료 시각은 메모리 인덱스에만 둔다 (디스크 파일은 바디뿐)
+//   그래서 이전 실행이 남긴 파일은 쓸 수 없다: 시작할 때 purge()로 비운다
+// - 저장 여부와 유효 시간은 응답 헤더로 판단 (RFC 9111 공유 캐시 규칙)
+//   Cache-Control: no-store / private / no-cache, Set-Cookie, Vary: * 는 저장하지 않음
+//   s-maxage > max-age > Expires 순, 셋 다 없으면 cache_valid (200 / 203 / 301 / 308만)
+// - Vary: 키 하나에 요청 헤더 값 조합마다 항목 하나 (키 -> Vary 헤더 이름 목록을 따로 기억)
+//   응답의 Vary 이름 목록이 바뀌면 그 키의 이전 항목은 모두 버린다
+// - 키에 메서드가 없다: GET 응답만 저장하고 HEAD는 저장된 GET 항목으로 답한다
+// - 파일 이름은 "pid-번호"라 worker끼리 같은 디렉터리를 써도 겹치지 않는다
+// - maxBytes는 이 worker의 몫 (Server가 cache_max_size를 worker 수로 나눠 준다)
+class ResponseCache {
+public:
+    typedef std::pair<std::string, std::string> Header;
+    typedef std::map<std::string, std::string> RequestHeaders;   // 이름은 소문자
+
+    struct Entry {
+        std::string key;            // 키 + Vary 값
+        std::string file;
+        size_t size;
+        int status;
+        std::vector<Header> headers;    // Content-Type 포함, 연결 단위 헤더 / Date / Server 제외
+        std::time_t storedAt;
+        std::time_t expires;
+    };
+
+    // 받는 대로 파일에 쓰는 중인 응답 하나 (commit 또는 abandon으로 끝낸다)
+    struct Fill {
+        std::string key;
+        std::string primaryKey;
+        std::vector<std::string> vary;
+        std::string file;
+        int fd;
+        size_t size;
+        size_t maxSize;
+        bool failed;                // 쓰기 실패 / 한도 초과: commit해도 저장하지 않음
+        int status;
+        std::vector<Header> headers;
+        std::time_t storedAt;
+        std::time_t expires;
+
+        // 바디 조각 추가 (실패해도 응답 전달에는 영향 없음)
+        void write(const char* data, size_t len);
+    };
+
+    struct Stats {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long stores;
+        unsigned long evictions;
+        size_t entries;
+        size_t bytes;
+    };
+
+    ResponseCache(const std::string& dir, size_t maxBytes);
+    ~ResponseCache();
+
+    // 다른 클라이언트에게 그대로 줘도 되는 응답인지 (Set-Cookie / private / no-store / Vary: * 가 없음)
+    static bool shareable(const std::vector<Header>& headers);
+    // 응답의 Vary에 나온 요청 헤더 값이 두 요청에서 같은지 (같은 응답을 줘도 되는지)
+    static bool sameVariant(const std::vector<Header>& headers, const RequestHeaders& a,
+                            const RequestHeaders& b);
+
+    // 디렉터리를 만들고 캐시 파일을 지운다 (worker를 띄우기 전에 한 번). 실패하면 false
+    // owner: 그 worker(pid)가 만든 파일만 (죽은 worker를 다시 띄울 때)
+    static bool purge(const std::string& dir, pid_t owner = 0);
+
+    const std::string& dir() const;
+
+    // 아직 유효한 항목 (hit이면 LRU 앞으로). 만료됐거나 없으면 NULL
+    const Entry* lookup(const std::string& key, const RequestHeaders& requestHeaders);
+    // hit 파일을 열지 못한 항목 등을 버린다
+    void invalidate(const Entry* entry);
+
+    // status / headers(클라이언트로 보낸 것)를 보고 저장할 수 있으면 파일을 만든다. 아니면 NULL
+    Fill* begin(const std::string& key, const RequestHeaders& requestHeaders, int status,
+                const std::vector<Header>& headers, int defaultValid);
+    // 응답이 끝까지 정상으로 끝났을 때: 인덱스에 넣고 같은 키의 이전 항목을 대체
+    void commit(Fill* fill);
+    void abandon(Fill* fill);
+
+    Stats stats() const;
+
+private:
+    typedef std::list<Entry> LruList;   // front = 가장 최근 사용
+
+    static std::string variantKey(const std::string& key, const std::vector<std::string>& vary,
+                                  const RequestHeaders& requestHeaders);
+    void evictOne();
+    void erase(LruList::iterator it);
+    // 키 하나의 모든 Vary 변형 항목을 버린다 (Vary 헤더 이름이 바뀌었을 때)
+    void eraseVariants(const std::string& key);
+
+    std::string _dir;
+    size_t _maxBytes;
+    size_t _bytes;
+    unsigned long _seq;
+    LruList _lru;
+    std::map<std::string, LruList::iterator> _index;
+    std::map<std::string, std::vector<std::string> > _vary;    // 키 -> Vary 헤더 이름 (소문자)
+
+    unsigned long _hits;
+    unsigned long _misses;
+    unsigned long _stores;
+    unsigned long _evictions;
+
+    ResponseCache(const ResponseCache&);
+    ResponseCache& operator=(const ResponseCache&);
+};
+
+#endif
@@ -20,13 +20,17 @@
 // Router
 // - 여러 LocationConfig를 관리하고
 // - 들어온 요청의 URI에 대해 어떤 location을 사용할지 결정하는 책임을 가진다.
+// - server 블록마다 시작 시 한 번만 만든다 (location path로 문자 단위 prefix trie 구성)
+// - LocationConfig는 복사하지 않고 포인터만 보관: 원본(ServerConfig)이 Router보다 오래 살아야 함
 class Router {
 public:
     Router();
+    explicit Router(const std::vector<LocationConfig>& locations);
 
     void addLocation(const LocationConfig& loc);
 
     // URI에 가장 잘 매칭되는 location 반환 (가장 긴 prefix)
+    // trie를 URI 길이만큼만 내려가며, 요청마다 할당 없음
     const LocationConfig* match(const std::string& uri) const;
     
     // 해당 location에서 HTTP method가 허용되는지 확인
@@ -35,7 +39,20 @@ public:
     bool isMethodAllowed(const LocationConfig* loc, const std::string& method) const;
 
 private:
-    std::vector<LocationConfig> locations;
+    struct Edge {
+        unsigned char ch;
+        int next;           // nodes 인덱스
+    };
+
+    struct Node {
+        const LocationConfig* loc;  // 이 지점에서 끝나는 location (없으면 NULL)
+        std::vector<Edge> edges;    // 자식 수가 적어 선형 탐색
+        Node() : loc(NULL) {}
+    };
+
+    int findChild(int node, unsigned char ch) const;
+
+    std::vector<Node> nodes;    // nodes[0] = root (빈 path)
 };
 
 #endif
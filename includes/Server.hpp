@@ -5,24 +5,36 @@
 #include <map>
 #include <string>
 #include <ctime>
-#include <poll.h>
 #include <set>
 
 #include "Connection.hpp"
+#include "EventLoop.hpp"
+#include "TimerWheel.hpp"
 #include "HttpRequest.hpp"
 #include "HttpResponse.hpp"
 #include "ServerConfig.hpp"
+#include "Router.hpp"
+#include "VhostTable.hpp"
+#include "FileCache.hpp"
+#include "CgiProcess.hpp"
+#include "UpstreamPool.hpp"
+#include "UpstreamGroup.hpp"
+#include "ErrorPageCache.hpp"
+#include "ResponseCache.hpp"
 
 class Server {
 public:
     // explicit: 암묵적 변환을 막아 잘못된 생성 호출을 방지
-    explicit Server(const std::vector<ServerConfig>& cfgs);
+    // reusePort: worker마다 자기 리스너를 여는 multi-worker 모드 (SO_REUSEPORT)
+    // workerCount: 전체 worker 수 (worker 단위 자원의 한도를 나눠 갖는다: cache_max_size)
+    explicit Server(const std::vector<ServerConfig>& cfgs, bool reusePort = false, int workerCount = 1);
     ~Server();
 
     void run();
 
 private:
     std::vector<ServerConfig> _configs;      // 모든 server 블록 설정을 저장
+    std::vector<Router> _routers;            // _configs[i]의 location trie (시작 시 한 번 생성)
     std::vector<int> _listenFds;             // 리스닝 소켓 FD 목록
     std::set<int> _listenFdSet;              // 빠른 판단용 집합
     int _port;                               // 첫 포트 (임시 호환성)
@@ -30,13 +42,37 @@ private:
     int _idleTimeoutSec;
     int _writeTimeoutSec;
     int _maxKeepAlive;
+    bool _reusePort;
 
-    std::vector<pollfd> _pfds;               // [0..n) 리스너, 이후 클라이언트
+    EventLoop _loop;                         // epoll/poll reactor (fd는 한 번만 등록)
+    std::vector<EventLoop::Event> _events;   // wait() 결과 재사용 버퍼
     std::map<int, Connection*> _conns;       // fd -> Connection*
+    unsigned long _connSeq;                  // Connection id 발급용
+    TimerWheel _timers;                      // idle / write timeout deadline
+    std::vector<TimerWheel::Entry> _expired; // expire() 결과 재사용 버퍼
     std::map<int, int> _listenFdToPort;      // listen fd -> port
-    std::map<int, int> _clientPort;          // client fd -> accepted listen port
+    std::map<const LocationConfig*, FileCache*> _fileCaches; // file_cache가 켜진 location만
+    std::map<int, VhostTable> _vhostsByPort; // listen port -> server_name 테이블 (accept 시 Connection에 연결)
+    std::map<int, CgiProcess*> _cgiByFd;     // CGI stdin/stdout pipe fd -> 실행 중인 CGI
+    std::map<pid_t, CgiProcess*> _cgiByPid;  // 회수 전인 CGI (클라이언트가 끊긴 것 포함)
+    int _sigchldFd;                          // SIGCHLD self-pipe 읽기 끝
+    std::map<std::string, UpstreamPool*> _fastCgiPools; // fastcgi_pass 주소 -> 연결 풀
+    std::map<std::string, UpstreamGroup*> _upstreamGroups; // proxy_pass 대상 (upstream 이름 / 주소) -> 그룹
+    std::map<int, UpstreamPool*> _upstreamIdle;         // idle upstream fd (닫힘 감지용 READ 등록)
+    ErrorPageCache _errorPages;              // (에러 페이지 경로, 상태 코드) -> 만들어 둔 바디
+    std::map<std::string, ResponseCache*> _responseCaches;  // cache_path -> 디스크 응답 캐시 (같은 경로는 공유)
+    // single-flight로 기다리는 요청 하나: 연결 (fd, id)과 그 연결의 응답 자리
+    struct FlightWaiter {
+        int fd;
+        unsigned long conn;
+        unsigned long response;
+    };
+    // 진행 중인 동적 GET (server 블록 + Host + URI) -> 같은 응답을 기다리는 요청
+    std::map<std::string, std::vector<FlightWaiter> > _flights;
 
     // simple in-memory session store
+    // worker 프로세스 메모리에만 있다: worker_processes가 2 이상이면
+    // 다른 worker가 받은 요청에는 세션이 없다 (SO_REUSEPORT는 연결 단위로 분산)
     struct Session {
         int counter;
         std::time_t lastSeen;
@@ -44,26 +80,101 @@ private:
     };
     std::map<std::string, Session> _sessions;
     unsigned long _sidSeq;
+    std::time_t _nextSessionSweep;
+
+    // stub_status 카운터 (worker 단위)
+    unsigned long _statAccepted;
+    unsigned long _statRequests;
+    unsigned long _statCoalesced;           // 진행 중인 요청의 응답을 나눠 받은 요청
 
 private:
     int createListenSocket(int port);
     void setNonBlocking(int fd);
 
     void acceptLoop(int listenFd);
-    void handleClientEvent(size_t idx);
+    void handleClientEvent(int fd, int events);
+    void processInput(int fd, Connection* conn);
+    // 업로드 location의 multipart POST면 바디를 받는 동안 upload_store에 바로 저장
+    void prepareBodyStreaming(HttpRequest& req, const ServerConfig& cfg);
 
     void updatePollEventsFor(int fd);
     void removeConn(int fd);
 
+    // timer wheel에서 만료된 연결만 확인 (전체 순회 없음)
     void sweepTimeouts();
+    void sweepSessions(std::time_t now);
+    std::time_t connDeadline(const Connection* conn) const;
+    void scheduleConnTimer(Connection* conn);
+    int nextWaitTimeoutMs() const;
 
     // request/response flow
-    void onRequest(int fd, const HttpRequest& req);
-    const ServerConfig& pickServerConfig(int fd, const HttpRequest& req) const;
-    std::string extractHostName(const HttpRequest& req) const;
+    // coalesce: 같은 요청이 진행 중이면 기다린다 (기다렸다 깨어난 요청은 false)
+    void onRequest(int fd, const HttpRequest& req, bool coalesce = true);
+    bool wantsKeepAlive(const Connection* conn, const HttpRequest& req) const;
+    const ServerConfig& pickServerConfig(const Connection* conn, const HttpRequest& req) const;
     bool isMethodAllowed(const ServerConfig& cfg, const std::string& method) const;
-    const ServerConfig& pickDefaultServerConfigForFd(int fd) const;
-    HttpResponse buildErrorResponse(int code, const ServerConfig& cfg) const;
+    const ServerConfig& pickDefaultServerConfig(const Connection* conn) const;
+    const Router& routerFor(const ServerConfig& cfg) const;
+    // acceptEncoding: 요청의 Accept-Encoding (gzip 설정이면 캐시된 압축본으로)
+    HttpResponse buildErrorResponse(int code, const ServerConfig& cfg,
+                                    const std::string& acceptEncoding = std::string());
+    HttpResponse buildStubStatusResponse() const;
+    FileCache* fileCacheFor(const LocationConfig* loc) const;
+
+    // cache_path: CGI / FastCGI / proxy 응답 디스크 캐시
+    ResponseCache* responseCacheFor(const LocationConfig& loc) const;
+    // 유효한 항목이면 hit 응답을 큐에 넣고 true
+    bool serveFromCache(Connection* conn, const HttpRequest& req, ResponseCache* cache,
+                        const std::string& key, bool keepAlive);
+    // single-flight: 같은 요청이 진행 중이면 연결을 held로 두고 true
+    bool joinFlight(Connection* conn, const std::string& flightKey);
+    // 방금 시작한 CGI / upstream 요청 (GET)을 같은 요청의 대표로 등록하고 캐시 정보를 붙인다
+    void beginFlight(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                     ResponseCache* cache, const std::string& cacheKey, const std::string& flightKey);
+    // 응답 헤더를 보낼 때: 캐시 파일을 열고 / 기다리는 연결에 줄 사본을 시작한다
+    void startResponseCopy(CgiProcess* p, const HttpResponse& resp);
+    // 응답이 끝났을 때 (complete: 끝까지 정상 전달): 캐시 저장을 마무리하고 기다리던 연결에 응답
+    void endFlight(CgiProcess* p, bool complete);
+    // 헤더 / 바디 / 파일 구간을 각각 출력 큐에 넣는다 (바디 복사 없음)
+    void queueResponse(Connection* conn, HttpResponse& resp, int fileFd = -1);
+
+    // CGI: pipe는 event loop에 등록, 종료는 SIGCHLD self-pipe로 회수 (blocking 없음)
+    bool startCgi(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                  const ServerConfig& cfg, bool keepAlive, HttpResponse& errResp);
+    bool startFastCgi(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                      const ServerConfig& cfg, bool keepAlive, HttpResponse& errResp);
+    void handleCgiEvent(CgiProcess* p, int fd, int events);
+    void writeCgiInput(CgiProcess* p, int events);
+    void relayCgiOutput(CgiProcess* p, int events);
+    void deliverCgiOutput(CgiProcess* p, Connection* conn, const char* data, size_t len);
+    void handleFastCgiEvent(CgiProcess* p, int events);
+    void processFastCgiRecords(CgiProcess* p);
+    // proxy_pass: 요청 헤더 + 바디를 upstream 연결로, 응답은 받는 대로 클라이언트로 흘려보낸다
+    bool startProxy(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                    const ServerConfig& cfg, bool keepAlive, HttpResponse& errResp);
+    void handleProxyEvent(CgiProcess* p, int events);
+    void relayProxyOutput(CgiProcess* p, const char* data, size_t len);
+    void sendProxyHeaders(CgiProcess* p, Connection* conn);
+    // 아직 시도하지 않은 살아 있는 backend를 골라 연결 (없으면 false: 502)
+    bool connectProxyBackend(CgiProcess* p);
+    // backend 결과(성공 / 실패)를 그룹에 한 번만 기록
+    void releaseBackend(CgiProcess* p, bool failed);
+    bool connectUpstream(CgiProcess* p);
+    void finishUpstream(CgiProcess* p, bool reusable);
+    void handleUpstreamIdleEvent(int fd);
+    void sendCgiHeaders(CgiProcess* p, Connection* conn);
+    void maybeFinishCgi(CgiProcess* p);
+    void resumeCgiOutput(Connection* conn);
+    void abortCgi(Connection* conn, CgiProcess* p);
+    // 연결을 닫게 되어 id 뒤의 응답은 보내지 않는다: 그 CGI / 대기 요청을 정리 (0이면 전부)
+    void discardResponsesAfter(Connection* conn, unsigned long id);
+    // 맨 앞 응답을 아직 시작하지 않았으면 504를 넣고 닫기로 한다 (시작했으면 false)
+    bool sendGatewayTimeout(Connection* conn);
+    void reapChildren();
+    void closeCgiInput(CgiProcess* p);
+    void closeCgiOutput(CgiProcess* p);
+    // p가 아직 응답 중인 클라이언트 연결 (없으면 NULL). 이후 출력은 p의 응답 자리로 가도록 선택해 둔다
+    Connection* cgiClient(const CgiProcess* p);
 
     // session helpers
     std::string newSessionId();
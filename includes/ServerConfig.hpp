@@ -39,6 +39,7 @@ class	ServerConfig
 		const std::vector<LocationConfig>& getLocations(void) const;
 		const std::string&				getRoot(void) const;
 		const std::string&				getErrorPage(void) const;
+		const std::map<int, std::string>&	getErrorPages(void) const; // error_page 상태 코드별 경로
 		bool							hasServerNames(void) const;
 		const std::vector<std::string>&	getServerNames(void) const;
 		bool							hasMethods(void) const;
@@ -47,6 +48,7 @@ class	ServerConfig
 		/* getter */
 		bool							hasClientMaxBodySize(void) const;
 		size_t							getClientMaxBodySize(void) const;
+		size_t							getClientBodyBufferSize(void) const; // 이보다 큰 요청 바디는 임시 파일로
 		bool							hasIndex(void) const;
 		const std::vector<std::string>&	getIndex(void) const;
 		bool							hasRedirect(void) const;
@@ -63,12 +65,22 @@ class	ServerConfig
 		int								getKeepAliveMax(void) const;
 		bool							hasAutoindex(void) const;
 		bool							getAutoindex(void) const;
+		bool							hasEventBackend(void) const;
+		const std::string&				getEventBackend(void) const;
+		bool							hasWorkerProcesses(void) const;
+		int								getWorkerProcesses(void) const; // 0 = auto (CPU 개수)
+		/* gzip: 동적 응답 / 캐시된 정적 파일 압축 */
+		bool							getGzip(void) const;
+		int								getGzipCompLevel(void) const;	// 1 (빠름) ~ 9 (작게)
+		size_t							getGzipMinLength(void) const;	// 이보다 작은 바디는 그대로
+		const std::vector<std::string>&	getGzipTypes(void) const;		// text/html은 항상 포함
 
 
 
 		void							parseDirective(const std::vector<Token> &tokens, size_t &i);
 		void							addLocation(const LocationConfig &location); // location은 server 내부에 종속: ServerConfig가 관리 및 내부에서 통제 가능(캡슐화)
 		void							validateServerBlock(void); // server block 전체 보고 판단: 의미적으로 완성되었는가, 기본값을 채워야 하는가
+		void							resolveUpstreams(const std::vector<UpstreamConfig>& upstreams); // 설정 파일 끝에서: location의 proxy_pass 이름 해석
 
 	
 	private:
@@ -79,6 +91,7 @@ class	ServerConfig
 		void	handleServerName(const std::vector<Token>& tokens, size_t& i);
 		void	handleMethods(const std::vector<Token>& tokens, size_t& i);
 		void	handleClientMaxBodySize(const std::vector<Token>& tokens, size_t& i);
+		void	handleClientBodyBufferSize(const std::vector<Token>& tokens, size_t& i);
 		void	handleIndex(const std::vector<Token>& tokens, size_t& i);
 		void	handleReturn(const std::vector<Token>& tokens, size_t& i);
 		void	handleAllowMethods(const std::vector<Token>& tokens, size_t& i);
@@ -87,6 +100,12 @@ class	ServerConfig
 		void	handleWriteTimeout(const std::vector<Token>& tokens, size_t& i);
 		void	handleKeepAliveMax(const std::vector<Token>& tokens, size_t& i);
 		void	handleAutoIndex(const std::vector<Token>& tokens, size_t& i);
+		void	handleEventBackend(const std::vector<Token>& tokens, size_t& i);
+		void	handleWorkerProcesses(const std::vector<Token>& tokens, size_t& i);
+		void	handleGzip(const std::vector<Token>& tokens, size_t& i);
+		void	handleGzipCompLevel(const std::vector<Token>& tokens, size_t& i);
+		void	handleGzipMinLength(const std::vector<Token>& tokens, size_t& i);
+		void	handleGzipTypes(const std::vector<Token>& tokens, size_t& i);
 		
 		void	duplicateLocationPathCheck(void) const;
 		void	applyDefaultErrorPage(void);
@@ -110,6 +129,8 @@ class	ServerConfig
 		/* server 그외 필드 */
 		size_t						_clientMaxBodySize;
 		bool						_hasClientMaxBodySize;
+		size_t						_clientBodyBufferSize;
+		bool						_hasClientBodyBufferSize;
 		std::vector<std::string>	_index;
 		bool						_hasIndex;
 		Redirect					_redirect;
@@ -130,6 +151,25 @@ class	ServerConfig
 
 		bool						_autoindex;
 		bool						_hasAutoindex;
+
+		/* event loop backend: "epoll" | "poll" (첫 server 블록 값이 전역 정책) */
+		std::string					_eventBackend;
+		bool						_hasEventBackend;
+
+		/* worker 프로세스 개수 (첫 server 블록 값이 전역 정책)
+		   메모리 세션은 worker마다 따로라 2 이상이면 worker 사이에서 유지되지 않는다 */
+		int							_workerProcesses;
+		bool						_hasWorkerProcesses;
+
+		/* gzip */
+		bool						_gzip;
+		bool						_hasGzip;
+		int							_gzipCompLevel;
+		bool						_hasGzipCompLevel;
+		size_t						_gzipMinLength;
+		bool						_hasGzipMinLength;
+		std::vector<std::string>	_gzipTypes;
+		bool						_hasGzipTypes;
 		std::map<int, std::string>	_errorPages;
 };
 
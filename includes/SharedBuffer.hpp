@@ -0,0 +1,38 @@
+#ifndef SHAREDBUFFER_HPP
+#define SHAREDBUFFER_HPP
+
+#include <string>
+#include <cstddef>
+
+// 참조 카운트 기반 불변 바이트 버퍼
+// - 캐시된 헤더/바디를 여러 응답이 복사 없이 공유하기 위한 용도
+// - 복사는 포인터 + 카운트 증가만 한다. 내용은 생성 후 바뀌지 않는다.
+// - worker는 프로세스 단위라 카운트에 원자 연산이 필요 없음
+class SharedBuffer {
+public:
+    SharedBuffer();
+    explicit SharedBuffer(const std::string& bytes);
+    SharedBuffer(const SharedBuffer& other);
+    SharedBuffer& operator=(const SharedBuffer& other);
+    ~SharedBuffer();
+
+    // 내용을 복사하지 않고 가져와서 공유 버퍼로 만든다 (bytes는 비워짐)
+    static SharedBuffer adopt(std::string& bytes);
+
+    bool isNull() const;
+    const char* data() const;
+    size_t size() const;
+    const std::string& str() const;
+
+private:
+    struct Block {
+        std::string bytes;
+        size_t refs;
+    };
+
+    void release();
+
+    Block* _block;
+};
+
+#endif
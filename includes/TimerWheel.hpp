@@ -0,0 +1,38 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <vector>
+#include <ctime>
+#include <cstddef>
+
+// 초 단위 hashed timing wheel
+// - slot = deadline % slot 수, 한 바퀴보다 먼 deadline은 같은 slot에서 다음 바퀴까지 대기
+// - schedule O(1), expire는 지나간 slot만 본다 (시간이 안 흘렀으면 O(1))
+// - 취소 API는 없다: 호출자가 id/deadline으로 stale 항목을 걸러내고 필요하면 다시 schedule
+class TimerWheel {
+public:
+    struct Entry {
+        int fd;
+        unsigned long id;      // fd 재사용 구분용 연결 serial
+        std::time_t deadline;
+    };
+
+    explicit TimerWheel(size_t slots = 512);
+
+    void schedule(int fd, unsigned long id, std::time_t deadline);
+
+    // now 까지 만료된 항목을 out에 추가하고 wheel에서 제거
+    void expire(std::time_t now, std::vector<Entry>& out);
+
+    // 다음 만료까지 남은 ms (nowMs: epoch ms). 항목이 없으면 -1
+    long msUntilNext(long long nowMs) const;
+
+    size_t size() const;
+
+private:
+    std::vector<std::vector<Entry> > _slots;
+    std::time_t _current;   // 마지막으로 처리한 초
+    size_t _count;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef UPSTREAMCONFIG_HPP
+#define UPSTREAMCONFIG_HPP
+
+#include "Token.hpp"
+#include "ConfigException.hpp"
+#include "ConfigUtils.hpp"
+#include <vector>
+
+/* upstream 블록 (server 블록 밖, 전역): proxy_pass http://이름 으로 참조
+	upstream backend {
+		server 127.0.0.1:9001 weight=2 max_fails=3 fail_timeout=10;
+		server 127.0.0.1:9002;
+		least_conn;				(또는 hash $request_uri; / hash $cookie_sid; 없으면 round-robin)
+	}
+	max_fails번 실패(connect 실패, 응답 전 끊김, 5xx, timeout)하면 fail_timeout초 동안 제외 */
+class	UpstreamConfig
+{
+	public:
+		enum	Balance
+		{
+			BALANCE_ROUND_ROBIN,
+			BALANCE_LEAST_CONN,
+			BALANCE_HASH
+		};
+
+		struct	Server
+		{
+			std::string	address;		// "host:port"
+			int			weight;
+			int			maxFails;
+			int			failTimeout;	// 초
+		};
+
+		UpstreamConfig(const std::string& name = "");
+		~UpstreamConfig(void);
+
+		/* proxy_pass http://host:port 처럼 upstream 블록 없이 주소 하나만 쓴 경우 */
+		static UpstreamConfig	single(const std::string& address);
+
+		void	parseDirective(const std::vector<Token>& tokens, size_t& i);
+		void	validateUpstreamBlock(void) const;
+
+		/* getter */
+		const std::string&			getName(void) const;
+		const std::vector<Server>&	getServers(void) const;
+		Balance						getBalance(void) const;
+		const std::string&			getHashKey(void) const;	// "$request_uri" 또는 "$cookie_이름"
+
+	private:
+		void	handleServer(const std::vector<Token>& tokens, size_t& i);
+		void	handleLeastConn(const std::vector<Token>& tokens, size_t& i);
+		void	handleHash(const std::vector<Token>& tokens, size_t& i);
+
+		std::string			_name;
+		std::vector<Server>	_servers;
+		Balance				_balance;
+		bool				_hasBalance;
+		std::string			_hashKey;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef UPSTREAMGROUP_HPP
+#define UPSTREAMGROUP_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+#include <ctime>
+
+#include "UpstreamConfig.hpp"
+#include "UpstreamPool.hpp"
+
+class HttpRequest;
+
+// proxy_pass가 가리키는 upstream 그룹 하나의 런타임 상태 (worker 단위)
+// - backend마다 keep-alive 연결 풀 + 진행 중 / 누적 요청 / 실패 카운터
+// - 선택: 가중치 smooth round-robin (nginx와 같은 방식), least_conn (진행 중 / weight가 가장 작은 곳),
+//   hash (일관 해시: backend마다 weight × 160개 가상 노드, 빠진 backend는 링의 다음 노드로)
+// - 수동 health check: fail_timeout 안에 max_fails번 실패하면 fail_timeout 동안 선택에서 뺀다
+//   backend가 하나뿐인 그룹은 빼지 않는다 (대신 보낼 곳이 없으므로)
+class UpstreamGroup {
+public:
+    UpstreamGroup(const UpstreamConfig& cfg, size_t keepalive);
+    ~UpstreamGroup();
+
+    const std::string& name() const;
+    size_t size() const;
+    const std::string& address(int backend) const;
+    UpstreamPool* pool(int backend);
+
+    // hash 방식이면 요청에서 키를 뽑는다 ($request_uri / $cookie_이름). 그 외에는 빈 문자열
+    std::string hashKey(const HttpRequest& request) const;
+    // tried에 표시되지 않았고 지금 쓸 수 있는 backend. 모두 down이면 가장 먼저 풀릴 backend
+    // 시도하지 않은 backend가 없으면 -1
+    int pick(const std::string& key, const std::vector<bool>& tried);
+
+    // 요청 하나의 시작 / 끝 (failed: connect 실패, 응답 전 끊김, 잘못된 응답, 5xx, timeout)
+    void begin(int backend);
+    void end(int backend, bool failed);
+
+    // stub_status: backend마다 " 그룹 주소 up|down 진행중 요청 실패" 한 줄
+    void writeStatus(std::ostream& out) const;
+
+private:
+    struct Backend {
+        std::string address;
+        int weight;
+        int maxFails;
+        int failTimeout;
+        UpstreamPool* pool;
+        int currentWeight;          // smooth round-robin 누적값
+        unsigned long active;
+        unsigned long requests;
+        unsigned long fails;
+        int recentFails;            // firstFailAt부터 fail_timeout 안의 실패 수
+        std::time_t firstFailAt;
+        std::time_t downUntil;
+    };
+
+    bool usable(size_t i, const std::vector<bool>& tried, std::time_t now) const;
+    int pickRoundRobin(const std::vector<bool>& tried, std::time_t now);
+    int pickLeastConn(const std::vector<bool>& tried, std::time_t now);
+    int pickHash(const std::string& key, const std::vector<bool>& tried, std::time_t now);
+
+    std::string _name;
+    UpstreamConfig::Balance _balance;
+    std::string _hashKey;
+    std::vector<Backend> _backends;
+    std::vector<std::pair<unsigned int, int> > _ring;  // (해시, backend) 정렬
+    size_t _next;                                       // least_conn 동점일 때 시작 위치
+
+    UpstreamGroup(const UpstreamGroup&);
+    UpstreamGroup& operator=(const UpstreamGroup&);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef UPSTREAMPOOL_HPP
+#define UPSTREAMPOOL_HPP
+
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+// upstream 주소 하나에 대한 keep-alive 연결 풀 (worker 단위)
+// - 요청마다 connect 하지 않고 깔끔하게 끝난 연결을 idle 목록에 보관
+//   (fastcgi_pass는 FCGI_KEEP_CONN, proxy_pass는 HTTP/1.1 keep-alive)
+// - 연결 하나에는 한 번에 요청 하나 (php-fpm 등은 multiplexing을 지원하지 않음)
+// - idle 연결의 event 등록 / 해제는 Server가 맡는다
+class UpstreamPool {
+public:
+    // address: "unix:/path.sock" 또는 "host:port" (host는 IPv4 주소 또는 localhost)
+    // maxIdle: worker당 보관할 idle 연결 수
+    UpstreamPool(const std::string& address, size_t maxIdle);
+    ~UpstreamPool();
+
+    const std::string& address() const;
+
+    // idle 연결이 있으면 꺼내고(reused = true), 없으면 non-blocking connect 시작
+    // 실패하면 -1
+    int acquire(bool& reused);
+    // 요청을 깔끔하게 마친 연결을 idle로 돌려준다. 가득 차 있으면 false (호출자가 close)
+    bool release(int fd);
+    // idle 중 upstream이 닫은 연결을 목록에서 빼고 close
+    void dropIdle(int fd);
+    size_t idleCount() const;
+
+private:
+    int connectNew() const;
+
+    std::string _address;
+    size_t _maxIdle;
+    bool _unix;
+    sockaddr_un _unAddr;
+    sockaddr_in _inAddr;
+    std::vector<int> _idle;
+
+    UpstreamPool(const UpstreamPool&);
+    UpstreamPool& operator=(const UpstreamPool&);
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef VHOSTTABLE_HPP
+#define VHOSTTABLE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class ServerConfig;
+
+// listen 포트 하나에 대한 server_name -> ServerConfig 조회 테이블
+// - 시작 시 한 번 구성, 이름은 소문자로 저장
+// - open addressing 해시: 요청마다 Host 값을 복사/소문자 변환하지 않고 바로 조회
+// - 같은 이름이 여러 server 블록에 있으면 먼저 나온 블록 (기존 선형 탐색과 동일)
+class VhostTable {
+public:
+    VhostTable();
+
+    void add(const std::string& name, const ServerConfig* cfg);
+    // 포트의 기본 server: 처음 등록된 블록만 유지
+    void setDefault(const ServerConfig* cfg);
+
+    // Host 헤더 값 그대로 (앞뒤 공백, :port, 대소문자는 여기서 처리)
+    // 일치하는 이름이 없으면 기본 server
+    const ServerConfig* lookup(const std::string& hostHeader) const;
+    const ServerConfig* defaultServer() const;
+
+private:
+    struct Slot {
+        unsigned long hash;
+        std::string name;               // 비어 있으면 빈 slot
+        const ServerConfig* cfg;
+    };
+
+    static unsigned long hashLower(const char* s, size_t len);
+    static bool equalsLower(const std::string& lowered, const char* s, size_t len);
+    void grow();
+
+    std::vector<Slot> _slots;   // 크기는 항상 2의 거듭제곱
+    size_t _used;
+    const ServerConfig* _default;
+};
+
+#endif
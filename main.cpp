@@ -1,7 +1,7 @@
 #include <iostream>
 #include <string>
 #include "Config.hpp"
-#include "Server.hpp"
+#include "Master.hpp"
 
 int main(int argc, char* argv[])
 {
@@ -17,8 +17,8 @@ int main(int argc, char* argv[])
             return 1;
         }
 
-        Server server(servers);
-        server.run();
+        Master master(servers);
+        return master.run();
     } catch (const std::exception& e) {
         std::cerr << "Startup error: " << e.what() << std::endl;
         return 1;
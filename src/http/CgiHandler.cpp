@@ -11,7 +11,6 @@
 /* ************************************************************************** */
 
 #include "CgiHandler.hpp"
-#include <sys/wait.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -27,18 +26,17 @@
 CgiHandler::CgiHandler() {}
 CgiHandler::~CgiHandler() {}
 
-/* ================= Main Handler ================= */
-
-HttpResponse CgiHandler::handle(const HttpRequest& request,
-                                const LocationConfig& location) {
-    HttpResponse response;
+/* ================= 준비 ================= */
 
+bool CgiHandler::prepare(const HttpRequest& request,
+                         const LocationConfig& location,
+                         HttpResponse& response) {
     // 1. 스크립트 경로 빌드
-    std::string scriptPath = buildScriptPath(request.getURI(), location);
+    scriptPath = buildScriptPath(request.getURI(), location);
     if (scriptPath.empty()) {
         response.setStatus(403);
         response.setBody("<h1>403 Forbidden</h1>");
-        return response;
+        return false;
     }
 
     // 2. 파일 존재 및 실행 권한 확인
@@ -46,54 +44,37 @@ HttpResponse CgiHandler::handle(const HttpRequest& request,
     if (stat(scriptPath.c_str(), &st) != 0) {
         response.setStatus(404);
         response.setBody("<h1>404 Not Found</h1>");
-        return response;
+        return false;
     }
 
     // 3. 인터프리터 결정 (php-cgi, python 등)
-    std::string interpreter = getInterpreter(scriptPath, location);
+    interpreter = getInterpreter(scriptPath, location);
     if (interpreter.empty()) {
         response.setStatus(500);
         response.setBody("<h1>500 Internal Server Error</h1><p>No CGI interpreter configured</p>");
-        return response;
+        return false;
     }
 
     // 4. CGI 환경 변수 준비
-    std::map<std::string, std::string> env = buildEnv(request, location, scriptPath);
-
-    // 5. CGI 실행
-    std::string output;
-    try {
-        output = executeCgi(scriptPath, interpreter, env, request.getBody());
-    } catch (const std::exception&) {
-        response.setStatus(502);
-        response.setBody("<h1>502 Bad Gateway</h1><p>CGI execution failed</p>");
-        return response;
-    }
-
-    // 6. CGI 출력 파싱
-    std::map<std::string, std::string> cgiHeaders;
-    std::string body;
-    parseCgiOutput(output, cgiHeaders, body);
-
-    // 7. 응답 구성
-    // Status 헤더가 있으면 사용, 없으면 200
-    if (cgiHeaders.count("status")) {
-        int code = std::atoi(cgiHeaders["status"].c_str());
-        response.setStatus(code > 0 ? code : 200);
-    } else {
-        response.setStatus(200);
-    }
+    env = buildEnv(request, location, scriptPath);
+    return true;
+}
 
-    // CGI 헤더를 응답에 복사
-    for (std::map<std::string, std::string>::iterator it = cgiHeaders.begin();
-         it != cgiHeaders.end(); ++it) {
-        if (it->first != "status") {
-            response.setHeader(it->first, it->second);
-        }
+bool CgiHandler::prepareFastCgi(const HttpRequest& request,
+                                const LocationConfig& location,
+                                HttpResponse& response) {
+    scriptPath = buildScriptPath(request.getURI(), location);
+    if (scriptPath.empty()) {
+        response.setStatus(403);
+        response.setBody("<h1>403 Forbidden</h1>");
+        return false;
     }
+    env = buildEnv(request, location, scriptPath);
+    return true;
+}
 
-    response.setBody(body);
-    return response;
+const std::map<std::string, std::string>& CgiHandler::environment() const {
+    return env;
 }
 
 /* ================= CGI 환경 변수 ================= */
@@ -135,8 +116,14 @@ std::map<std::string, std::string> CgiHandler::buildEnv(
     // Content 관련
     if (headers.count("content-type"))
         env["CONTENT_TYPE"] = headers.find("content-type")->second;
-    if (headers.count("content-length"))
+    // chunked 요청은 content-length 헤더가 없으므로 디코딩된 바디 길이를 사용
+    if (request.getBodySize() > 0) {
+        std::ostringstream len;
+        len << request.getBodySize();
+        env["CONTENT_LENGTH"] = len.str();
+    } else if (headers.count("content-length")) {
         env["CONTENT_LENGTH"] = headers.find("content-length")->second;
+    }
 
     // HTTP 헤더를 HTTP_* 형식으로 변환
     for (std::map<std::string, std::string>::const_iterator it = headers.begin();
@@ -164,27 +151,36 @@ std::map<std::string, std::string> CgiHandler::buildEnv(
 
 /* ================= CGI 실행 ================= */
 
-std::string CgiHandler::executeCgi(
-    const std::string& scriptPath,
-    const std::string& interpreter,
-    const std::map<std::string, std::string>& env,
-    const std::string& body) const {
+static void setCloseOnExec(int fd) {
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
 
+pid_t CgiHandler::spawn(int& stdinFd, int& stdoutFd) const {
     int pipeIn[2];   // 부모 -> 자식 (stdin)
     int pipeOut[2];  // 자식 -> 부모 (stdout)
 
-    if (pipe(pipeIn) < 0 || pipe(pipeOut) < 0)
-        throw std::runtime_error("pipe failed");
+    if (pipe(pipeIn) < 0)
+        return -1;
+    if (pipe(pipeOut) < 0) {
+        close(pipeIn[0]); close(pipeIn[1]);
+        return -1;
+    }
+    // 부모 쪽 끝이 다른 CGI 자식에게 상속되면 EOF가 오지 않으므로 exec 시 닫히게
+    setCloseOnExec(pipeIn[1]);
+    setCloseOnExec(pipeOut[0]);
 
     pid_t pid = fork();
     if (pid < 0) {
         close(pipeIn[0]); close(pipeIn[1]);
         close(pipeOut[0]); close(pipeOut[1]);
-        throw std::runtime_error("fork failed");
+        return -1;
     }
 
     if (pid == 0) {
         // 자식 프로세스: CGI 스크립트 실행
+        // 서버가 바꾼 signal 설정은 exec 후에도 상속되므로 기본값으로 복구
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
         
         // stdin/stdout 리다이렉트
         dup2(pipeIn[0], STDIN_FILENO);
@@ -213,7 +209,7 @@ std::string CgiHandler::executeCgi(
             std::string dir = scriptPath.substr(0, lastSlash);
             if (chdir(dir.c_str()) < 0) {
                 std::cerr << "chdir failed: " << strerror(errno) << std::endl;
-                exit(1);
+                _exit(1);
             }
         }
 
@@ -227,63 +223,60 @@ std::string CgiHandler::executeCgi(
         
         // execve 실패 시
         std::cerr << "execve failed: " << strerror(errno) << std::endl;
-        exit(1);
+        _exit(1);
     }
 
     // 부모 프로세스
     close(pipeIn[0]);
     close(pipeOut[1]);
+    stdinFd = pipeIn[1];
+    stdoutFd = pipeOut[0];
+    return pid;
+}
 
-    // POST body를 CGI stdin으로 전송
-    if (!body.empty()) {
-        ssize_t written = write(pipeIn[1], body.c_str(), body.size());
-        (void)written; // 에러 처리는 실제 구현에서 강화
-    }
-    close(pipeIn[1]);
+/* ================= CGI 출력 파싱 ================= */
 
-    // CGI 출력 읽기
-    std::string output;
-    char buffer[4096];
-    ssize_t bytesRead;
-    
-    while ((bytesRead = read(pipeOut[0], buffer, sizeof(buffer))) > 0) {
-        output.append(buffer, bytesRead);
-    }
-    close(pipeOut[0]);
-
-    // 자식 프로세스 종료 대기 (타임아웃 처리)
-    int status;
-    if (!waitWithTimeout(pid, status, 30)) { // 30초 타임아웃
-        kill(pid, SIGKILL);
-        waitpid(pid, &status, 0);
-        throw std::runtime_error("CGI timeout");
-    }
+size_t CgiHandler::findHeaderEnd(const std::string& output) {
+    size_t crlf = output.find("\r\n\r\n");
+    size_t lf = output.find("\n\n");
+    if (crlf != std::string::npos && (lf == std::string::npos || crlf < lf))
+        return crlf + 4;
+    if (lf != std::string::npos)
+        return lf + 2;
+    return std::string::npos;
+}
 
-    if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
-        throw std::runtime_error("CGI script exited with error");
+void CgiHandler::applyCgiHeaders(std::map<std::string, std::string>& cgiHeaders,
+                                 HttpResponse& response) const {
+    // Status 헤더가 있으면 사용, 없으면 200
+    if (cgiHeaders.count("status")) {
+        int code = std::atoi(cgiHeaders["status"].c_str());
+        response.setStatus(code > 0 ? code : 200);
+    } else {
+        response.setStatus(200);
     }
 
-    return output;
+    // CGI 헤더를 응답에 복사
+    for (std::map<std::string, std::string>::iterator it = cgiHeaders.begin();
+         it != cgiHeaders.end(); ++it) {
+        if (it->first != "status") {
+            response.setHeader(it->first, it->second);
+        }
+    }
 }
 
-/* ================= CGI 출력 파싱 ================= */
-
 void CgiHandler::parseCgiOutput(const std::string& output,
                                 std::map<std::string, std::string>& headers,
                                 std::string& body) const {
-    // CGI 출력은 "헤더\r\n\r\n바디" 형식
-    size_t pos = output.find("\r\n\r\n");
-    if (pos == std::string::npos) {
-        // \n\n으로 시도
-        pos = output.find("\n\n");
-        if (pos == std::string::npos) {
-            body = output;
-            return;
-        }
+    // CGI 출력은 "헤더\r\n\r\n바디" 형식 (스트리밍 경로와 같은 기준으로 분리)
+    size_t end = findHeaderEnd(output);
+    if (end == std::string::npos) {
+        body = output;
+        return;
     }
 
-    std::string headerBlock = output.substr(0, pos);
-    body = output.substr(pos + (output[pos] == '\r' ? 4 : 2));
+    std::string headerBlock = output.substr(0, end);
+    body = output.substr(end);
 
     // 헤더 파싱
     std::istringstream iss(headerBlock);
@@ -363,22 +356,6 @@ std::string CgiHandler::getInterpreter(const std::string& path,
     return "";
 }
 
-bool CgiHandler::waitWithTimeout(pid_t pid, int& status, int timeoutSec) const {
-    time_t start = time(NULL);
-    
-    while (time(NULL) - start < timeoutSec) {
-        pid_t result = waitpid(pid, &status, WNOHANG);
-        if (result == pid)
-            return true;
-        if (result < 0)
-            return false;
-        
-        usleep(100000); // 100ms
-    }
-    
-    return false;
-}
-
 std::string CgiHandler::trim(const std::string& s) const {
     size_t start = 0;
     while (start < s.size() && std::isspace(static_cast<unsigned char>(s[start])))
@@ -0,0 +1,602 @@
+#include "Deflater.hpp"
+#include <algorithm>
+#include <utility>
+
+static const size_t WINDOW_SIZE = 32768;
+static const size_t WINDOW_MASK = WINDOW_SIZE - 1;
+static const size_t BLOCK_INPUT = 65535;    // stored 블록 하나에 들어가는 최대 크기
+static const size_t MIN_MATCH = 3;
+static const size_t MAX_MATCH = 258;
+static const size_t TOO_FAR = 4096;         // 이보다 먼 길이 3 일치는 literal 3개보다 길어지기 쉬움
+static const int HASH_BITS = 15;
+static const size_t HASH_SIZE = static_cast<size_t>(1) << HASH_BITS;
+
+static const int LITLEN_CODES = 286;
+static const int DIST_CODES = 30;
+static const int CODELEN_CODES = 19;
+static const int END_OF_BLOCK = 256;
+
+static const unsigned short LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// 코드 길이 알파벳을 헤더에 적는 순서
+static const unsigned char CODELEN_ORDER[CODELEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// level별 탐색 강도 (zlib의 표를 단순화)
+struct LevelParams {
+    int maxChain;
+    size_t niceLength;
+    bool lazy;
+};
+static const LevelParams LEVELS[10] = {
+    { 4, 8, false },        // 0은 쓰지 않음 (1과 같게)
+    { 4, 8, false },
+    { 8, 16, false },
+    { 32, 32, false },
+    { 16, 16, true },
+    { 32, 32, true },
+    { 128, 128, true },
+    { 256, 128, true },
+    { 1024, 258, true },
+    { 4096, 258, true }
+};
+
+/* ================= 정적 테이블 ================= */
+
+struct Tables {
+    unsigned char lengthCode[MAX_MATCH + 1];    // 일치 길이 -> 257.. 기준 인덱스 (0..28)
+    unsigned char distCode[512];                // zlib 방식: dist-1 < 256 이면 그대로, 아니면 256 + ((dist-1) >> 7)
+    unsigned long crc[256];
+    unsigned short fixedLitCodes[288];
+    unsigned char fixedLitLens[288];
+    unsigned short fixedDistCodes[DIST_CODES];
+    unsigned char fixedDistLens[DIST_CODES];
+};
+
+static unsigned short reverseBits(unsigned int code, int len) {
+    unsigned int r = 0;
+    for (int i = 0; i < len; ++i) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return static_cast<unsigned short>(r);
+}
+
+// 코드 길이 -> canonical Huffman 코드 (DEFLATE는 비트를 뒤집어 LSB부터 쓴다)
+static void buildCodes(const unsigned char* lens, int n, unsigned short* codes) {
+    unsigned int count[16] = { 0 };
+    unsigned int next[16] = { 0 };
+    for (int i = 0; i < n; ++i)
+        count[lens[i]]++;
+    count[0] = 0;
+    unsigned int code = 0;
+    for (int bits = 1; bits < 16; ++bits) {
+        code = (code + count[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for (int i = 0; i < n; ++i)
+        codes[i] = lens[i] ? reverseBits(next[lens[i]]++, lens[i]) : 0;
+}
+
+static const Tables& tables() {
+    static Tables t;
+    static bool ready = false;
+    if (ready)
+        return t;
+
+    for (int code = 0; code < 29; ++code) {
+        size_t last = (code == 28) ? MAX_MATCH : static_cast<size_t>(LENGTH_BASE[code + 1]) - 1;
+        for (size_t len = LENGTH_BASE[code]; len <= last; ++len)
+            t.lengthCode[len] = static_cast<unsigned char>(code);
+    }
+    for (int code = 0; code < DIST_CODES; ++code) {
+        unsigned int first = DIST_BASE[code] - 1;
+        unsigned int count = 1u << DIST_EXTRA[code];
+        for (unsigned int d = first; d < first + count; ++d) {
+            if (d < 256)
+                t.distCode[d] = static_cast<unsigned char>(code);
+            else
+                t.distCode[256 + (d >> 7)] = static_cast<unsigned char>(code);
+        }
+    }
+    for (unsigned long n = 0; n < 256; ++n) {
+        unsigned long c = n;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+        t.crc[n] = c;
+    }
+    for (int i = 0; i < 288; ++i)
+        t.fixedLitLens[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+    buildCodes(t.fixedLitLens, 288, t.fixedLitCodes);
+    for (int i = 0; i < DIST_CODES; ++i)
+        t.fixedDistLens[i] = 5;
+    buildCodes(t.fixedDistLens, DIST_CODES, t.fixedDistCodes);
+    ready = true;
+    return t;
+}
+
+static int distCodeOf(size_t dist) {
+    size_t d = dist - 1;
+    return tables().distCode[(d < 256) ? d : 256 + (d >> 7)];
+}
+
+// 빈도 -> 최대 maxBits 비트로 제한된 Huffman 코드 길이
+// 트리를 만든 뒤 넘치는 깊이는 Kraft 합이 맞을 때까지 짧은 코드를 쪼개 내려보낸다
+static void buildLengths(const unsigned long* freq, int n, int maxBits, unsigned char* lens) {
+    std::vector<std::pair<unsigned long, int> > syms;
+    for (int i = 0; i < n; ++i) {
+        lens[i] = 0;
+        if (freq[i])
+            syms.push_back(std::make_pair(freq[i], i));
+    }
+    // 디코더가 완전한 코드를 만들 수 있도록 기호가 최소 둘은 있게
+    for (int i = 0; syms.size() < 2; ++i) {
+        if (!freq[i])
+            syms.push_back(std::make_pair(1UL, i));
+    }
+    std::sort(syms.begin(), syms.end());
+
+    // 정렬된 잎 큐 + 내부 노드 큐 (내부 노드는 만들어지는 순서대로 무게가 증가)
+    const size_t m = syms.size();
+    std::vector<unsigned long> weight(2 * m - 1);
+    std::vector<size_t> parent(2 * m - 1, 0);
+    for (size_t k = 0; k < m; ++k)
+        weight[k] = syms[k].first;
+    size_t leaf = 0;
+    size_t inner = m;
+    for (size_t next = m; next < 2 * m - 1; ++next) {
+        size_t pick[2];
+        for (int j = 0; j < 2; ++j) {
+            if (leaf < m && (inner >= next || weight[leaf] <= weight[inner]))
+                pick[j] = leaf++;
+            else
+                pick[j] = inner++;
+        }
+        weight[next] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = next;
+        parent[pick[1]] = next;
+    }
+
+    std::vector<int> depth(2 * m - 1, 0);
+    int count[32] = { 0 };
+    for (size_t k = 2 * m - 1; k-- > 0; ) {
+        if (k != 2 * m - 2)
+            depth[k] = depth[parent[k]] + 1;
+        if (k < m)
+            count[std::min(depth[k], maxBits)]++;
+    }
+
+    unsigned long total = 0;
+    for (int i = maxBits; i > 0; --i)
+        total += static_cast<unsigned long>(count[i]) << (maxBits - i);
+    while (total != (1UL << maxBits)) {
+        count[maxBits]--;
+        for (int i = maxBits - 1; i > 0; --i) {
+            if (count[i]) {
+                count[i]--;
+                count[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // 빈도가 낮은 기호부터 긴 코드를 준다
+    size_t k = 0;
+    for (int len = maxBits; len > 0; --len) {
+        for (int c = 0; c < count[len]; ++c)
+            lens[syms[k++].second] = static_cast<unsigned char>(len);
+    }
+}
+
+static inline size_t hashAt(const unsigned char* p) {
+    return ((static_cast<size_t>(p[0]) << 10) ^ (static_cast<size_t>(p[1]) << 5) ^ p[2]) & (HASH_SIZE - 1);
+}
+
+/* ================= Deflater ================= */
+
+Deflater::Deflater(Format format, int level)
+: _format(format), _windowStart(0), _pending(0), _hashed(0),
+  _head(HASH_SIZE, 0), _prev(WINDOW_SIZE, 0),
+  _bitBuf(0), _bitCount(0), _crc(0xFFFFFFFFUL), _adler(1), _totalIn(0),
+  _headerDone(false), _finished(false) {
+    if (level < 1) level = 1;
+    if (level > 9) level = 9;
+    _maxChain = LEVELS[level].maxChain;
+    _niceLength = LEVELS[level].niceLength;
+    _lazy = LEVELS[level].lazy;
+}
+
+void Deflater::compress(Format format, int level, const char* data, size_t len, std::string& out) {
+    Deflater d(format, level);
+    d.write(data, len, out);
+    d.finish(out);
+}
+
+void Deflater::write(const char* data, size_t len, std::string& out) {
+    if (_finished)
+        return;
+    if (!_headerDone)
+        writeHeader(out);
+
+    const Tables& t = tables();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    unsigned long crc = _crc;
+    unsigned long a = _adler & 0xFFFF;
+    unsigned long b = (_adler >> 16) & 0xFFFF;
+    for (size_t i = 0; i < len; ++i) {
+        crc = t.crc[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        a += p[i];
+        b += a;
+        if ((i & 0xFFF) == 0xFFF) {     // 4096바이트마다 모듈로 (overflow 방지)
+            a %= 65521;
+            b %= 65521;
+        }
+    }
+    _crc = crc;
+    _adler = ((b % 65521) << 16) | (a % 65521);
+    _totalIn += static_cast<unsigned long>(len);
+
+    while (len > 0) {
+        size_t room = BLOCK_INPUT - (_window.size() - _pending);
+        size_t take = std::min(room, len);
+        _window.append(data, take);
+        data += take;
+        len -= take;
+        if (_window.size() - _pending == BLOCK_INPUT)
+            compressBlock(false, out);
+    }
+}
+
+void Deflater::flush(std::string& out) {
+    if (_finished)
+        return;
+    if (!_headerDone)
+        writeHeader(out);
+    if (_pending < _window.size())
+        compressBlock(false, out);
+    // 빈 stored 블록: 바이트 경계 정렬 + 00 00 FF FF
+    putBits(0, 3, out);
+    alignToByte(out);
+    putBits(0x0000, 16, out);
+    putBits(0xFFFF, 16, out);
+}
+
+void Deflater::finish(std::string& out) {
+    if (_finished)
+        return;
+    if (!_headerDone)
+        writeHeader(out);
+    compressBlock(true, out);
+    alignToByte(out);
+
+    if (_format == FORMAT_GZIP) {
+        unsigned long crc = _crc ^ 0xFFFFFFFFUL;
+        for (int i = 0; i < 4; ++i)
+            out.push_back(static_cast<char>((crc >> (8 * i)) & 0xFF));
+        for (int i = 0; i < 4; ++i)
+            out.push_back(static_cast<char>((_totalIn >> (8 * i)) & 0xFF));
+    } else {
+        for (int i = 3; i >= 0; --i)
+            out.push_back(static_cast<char>((_adler >> (8 * i)) & 0xFF));
+    }
+    _finished = true;
+    std::string().swap(_window);
+}
+
+void Deflater::writeHeader(std::string& out) {
+    if (_format == FORMAT_GZIP) {
+        // ID1 ID2 CM=deflate FLG=0 MTIME=0 XFL=0 OS=unix
+        static const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3 };
+        out.append(header, sizeof(header));
+    } else {
+        // CMF: deflate + 32KB 창, FLG: (CMF * 256 + FLG) % 31 == 0
+        out.push_back('\x78');
+        out.push_back('\x9c');
+    }
+    _headerDone = true;
+}
+
+// 압축하지 않은 입력 전부를 블록 하나로
+void Deflater::compressBlock(bool final, std::string& out) {
+    size_t begin = _pending;
+    size_t end = _window.size();
+    findSymbols(begin, end);
+    emitBlock(final, begin, end - begin, out);
+    _pending = end;
+
+    // 다음 블록이 참조할 최근 32KB만 남긴다
+    if (_pending > WINDOW_SIZE) {
+        size_t drop = _pending - WINDOW_SIZE;
+        _window.erase(0, drop);
+        _windowStart += drop;
+        _pending -= drop;
+    }
+}
+
+// [_hashed, absLimit) 위치를 해시 체인에 넣는다 (3바이트가 있는 위치만)
+void Deflater::insertUpTo(size_t absLimit) {
+    const unsigned char* w = reinterpret_cast<const unsigned char*>(_window.data());
+    const size_t absEnd = _windowStart + _window.size();
+    if (_hashed < _windowStart)
+        _hashed = _windowStart;
+    while (_hashed < absLimit && _hashed + 2 < absEnd) {
+        size_t h = hashAt(w + (_hashed - _windowStart));
+        _prev[_hashed & WINDOW_MASK] = _head[h];
+        _head[h] = _hashed + 1;
+        _hashed++;
+    }
+}
+
+// _window[pos]에서 시작하는 가장 긴 이전 일치 (end를 넘지 않음). 없으면 0
+size_t Deflater::longestMatch(size_t pos, size_t end, size_t& dist) const {
+    size_t maxLen = std::min(end - pos, MAX_MATCH);
+    if (maxLen < MIN_MATCH)
+        return 0;
+
+    const unsigned char* w = reinterpret_cast<const unsigned char*>(_window.data());
+    const unsigned char* cur = w + pos;
+    const size_t absPos = _windowStart + pos;
+    size_t best = MIN_MATCH - 1;
+    size_t cand = _head[hashAt(cur)];
+    int chain = _maxChain;
+
+    while (cand != 0 && chain-- > 0) {
+        size_t c = cand - 1;
+        if (c >= absPos || absPos - c > WINDOW_SIZE || c < _windowStart)
+            break;
+        const unsigned char* m = w + (c - _windowStart);
+        if (m[best] == cur[best] && m[0] == cur[0] && m[1] == cur[1]) {
+            size_t len = 2;
+            while (len < maxLen && m[len] == cur[len])
+                len++;
+            if (len > best) {
+                best = len;
+                dist = absPos - c;
+                if (len >= _niceLength || len == maxLen)
+                    break;
+            }
+        }
+        size_t next = _prev[c & WINDOW_MASK];
+        if (next == 0 || next - 1 >= c)
+            break;
+        cand = next;
+    }
+    if (best < MIN_MATCH || (best == MIN_MATCH && dist > TOO_FAR))
+        return 0;
+    return best;
+}
+
+void Deflater::findSymbols(size_t begin, size_t end) {
+    _symbols.clear();
+    const unsigned char* w = reinterpret_cast<const unsigned char*>(_window.data());
+    size_t nextLen = 0;
+    size_t nextDist = 0;
+    bool haveNext = false;
+
+    size_t i = begin;
+    while (i < end) {
+        size_t len;
+        size_t dist = 0;
+        if (haveNext) {
+            len = nextLen;
+            dist = nextDist;
+            haveNext = false;
+        } else {
+            insertUpTo(_windowStart + i);
+            len = longestMatch(i, end, dist);
+        }
+
+        // lazy: 한 칸 뒤에서 더 긴 일치가 나오면 지금 바이트는 literal로
+        if (_lazy && len >= MIN_MATCH && len < _niceLength && i + 1 < end) {
+            insertUpTo(_windowStart + i + 1);
+            nextDist = 0;
+            nextLen = longestMatch(i + 1, end, nextDist);
+            if (nextLen > len) {
+                Symbol s = { w[i], 0 };
+                _symbols.push_back(s);
+                i++;
+                haveNext = true;
+                continue;
+            }
+        }
+
+        if (len >= MIN_MATCH) {
+            Symbol s = { static_cast<unsigned short>(len), static_cast<unsigned short>(dist) };
+            _symbols.push_back(s);
+            i += len;
+        } else {
+            Symbol s = { w[i], 0 };
+            _symbols.push_back(s);
+            i++;
+        }
+    }
+    insertUpTo(_windowStart + end);
+}
+
+void Deflater::emitBlock(bool final, size_t rawBegin, size_t rawLen, std::string& out) {
+    const Tables& t = tables();
+
+    unsigned long litFreq[LITLEN_CODES] = { 0 };
+    unsigned long distFreq[DIST_CODES] = { 0 };
+    unsigned long extraBits = 0;
+    for (size_t i = 0; i < _symbols.size(); ++i) {
+        const Symbol& s = _symbols[i];
+        if (s.dist == 0) {
+            litFreq[s.litLen]++;
+        } else {
+            int lc = t.lengthCode[s.litLen];
+            int dc = distCodeOf(s.dist);
+            litFreq[257 + lc]++;
+            distFreq[dc]++;
+            extraBits += LENGTH_EXTRA[lc] + DIST_EXTRA[dc];
+        }
+    }
+    litFreq[END_OF_BLOCK] = 1;
+
+    // dynamic 트리
+    unsigned char litLens[LITLEN_CODES];
+    unsigned char distLens[DIST_CODES];
+    buildLengths(litFreq, LITLEN_CODES, 15, litLens);
+    buildLengths(distFreq, DIST_CODES, 15, distLens);
+
+    int hlit = LITLEN_CODES;
+    while (hlit > 257 && litLens[hlit - 1] == 0) hlit--;
+    int hdist = DIST_CODES;
+    while (hdist > 1 && distLens[hdist - 1] == 0) hdist--;
+
+    // 코드 길이 배열 런 길이 부호화: 16 = 이전 값 3~6번, 17 = 0을 3~10번, 18 = 0을 11~138번
+    unsigned char all[LITLEN_CODES + DIST_CODES];
+    std::copy(litLens, litLens + hlit, all);
+    std::copy(distLens, distLens + hdist, all + hlit);
+    const int total = hlit + hdist;
+    std::vector<std::pair<unsigned char, unsigned char> > rle;
+    for (int i = 0; i < total; ) {
+        unsigned char v = all[i];
+        int run = 1;
+        while (i + run < total && all[i + run] == v)
+            run++;
+        i += run;
+        if (v == 0) {
+            while (run >= 11) {
+                int r = std::min(run, 138);
+                rle.push_back(std::make_pair(static_cast<unsigned char>(18), static_cast<unsigned char>(r - 11)));
+                run -= r;
+            }
+            if (run >= 3) {
+                rle.push_back(std::make_pair(static_cast<unsigned char>(17), static_cast<unsigned char>(run - 3)));
+                run = 0;
+            }
+        } else {
+            rle.push_back(std::make_pair(v, static_cast<unsigned char>(0)));
+            run--;
+            while (run >= 3) {
+                int r = std::min(run, 6);
+                rle.push_back(std::make_pair(static_cast<unsigned char>(16), static_cast<unsigned char>(r - 3)));
+                run -= r;
+            }
+        }
+        while (run-- > 0)
+            rle.push_back(std::make_pair(v, static_cast<unsigned char>(0)));
+    }
+
+    unsigned long clFreq[CODELEN_CODES] = { 0 };
+    for (size_t i = 0; i < rle.size(); ++i)
+        clFreq[rle[i].first]++;
+    unsigned char clLens[CODELEN_CODES];
+    buildLengths(clFreq, CODELEN_CODES, 7, clLens);
+    int hclen = CODELEN_CODES;
+    while (hclen > 4 && clLens[CODELEN_ORDER[hclen - 1]] == 0) hclen--;
+
+    // 블록 종류별 비트 수 비교
+    unsigned long dynBits = 3 + 14 + 3 * static_cast<unsigned long>(hclen) + extraBits;
+    for (size_t i = 0; i < rle.size(); ++i) {
+        unsigned char sym = rle[i].first;
+        dynBits += clLens[sym] + ((sym == 16) ? 2 : (sym == 17) ? 3 : (sym == 18) ? 7 : 0);
+    }
+    unsigned long fixedBits = 3 + extraBits;
+    for (int i = 0; i < LITLEN_CODES; ++i) {
+        dynBits += litFreq[i] * litLens[i];
+        fixedBits += litFreq[i] * t.fixedLitLens[i];
+    }
+    for (int i = 0; i < DIST_CODES; ++i) {
+        dynBits += distFreq[i] * distLens[i];
+        fixedBits += distFreq[i] * 5;
+    }
+    unsigned long storedBits = 3 + ((8 - (_bitCount + 3) % 8) % 8) + 32 + 8 * static_cast<unsigned long>(rawLen);
+
+    if (storedBits <= dynBits && storedBits <= fixedBits) {
+        putBits(final ? 1 : 0, 1, out);
+        putBits(0, 2, out);
+        alignToByte(out);
+        putBits(static_cast<unsigned int>(rawLen), 16, out);
+        putBits(static_cast<unsigned int>(~rawLen) & 0xFFFF, 16, out);
+        out.append(_window, rawBegin, rawLen);
+        return;
+    }
+
+    if (fixedBits <= dynBits) {
+        putBits(final ? 1 : 0, 1, out);
+        putBits(1, 2, out);
+        emitSymbols(t.fixedLitCodes, t.fixedLitLens, t.fixedDistCodes, t.fixedDistLens, out);
+        return;
+    }
+
+    unsigned short litCodes[LITLEN_CODES];
+    unsigned short distCodes[DIST_CODES];
+    unsigned short clCodes[CODELEN_CODES];
+    buildCodes(litLens, LITLEN_CODES, litCodes);
+    buildCodes(distLens, DIST_CODES, distCodes);
+    buildCodes(clLens, CODELEN_CODES, clCodes);
+
+    putBits(final ? 1 : 0, 1, out);
+    putBits(2, 2, out);
+    putBits(static_cast<unsigned int>(hlit - 257), 5, out);
+    putBits(static_cast<unsigned int>(hdist - 1), 5, out);
+    putBits(static_cast<unsigned int>(hclen - 4), 4, out);
+    for (int i = 0; i < hclen; ++i)
+        putBits(clLens[CODELEN_ORDER[i]], 3, out);
+    for (size_t i = 0; i < rle.size(); ++i) {
+        unsigned char sym = rle[i].first;
+        putBits(clCodes[sym], clLens[sym], out);
+        if (sym == 16)
+            putBits(rle[i].second, 2, out);
+        else if (sym == 17)
+            putBits(rle[i].second, 3, out);
+        else if (sym == 18)
+            putBits(rle[i].second, 7, out);
+    }
+    emitSymbols(litCodes, litLens, distCodes, distLens, out);
+}
+
+void Deflater::emitSymbols(const unsigned short* litCodes, const unsigned char* litLens,
+                           const unsigned short* distCodes, const unsigned char* distLens,
+                           std::string& out) {
+    const Tables& t = tables();
+    for (size_t i = 0; i < _symbols.size(); ++i) {
+        const Symbol& s = _symbols[i];
+        if (s.dist == 0) {
+            putBits(litCodes[s.litLen], litLens[s.litLen], out);
+            continue;
+        }
+        int lc = t.lengthCode[s.litLen];
+        putBits(litCodes[257 + lc], litLens[257 + lc], out);
+        if (LENGTH_EXTRA[lc])
+            putBits(s.litLen - LENGTH_BASE[lc], LENGTH_EXTRA[lc], out);
+        int dc = distCodeOf(s.dist);
+        putBits(distCodes[dc], distLens[dc], out);
+        if (DIST_EXTRA[dc])
+            putBits(s.dist - DIST_BASE[dc], DIST_EXTRA[dc], out);
+    }
+    putBits(litCodes[END_OF_BLOCK], litLens[END_OF_BLOCK], out);
+}
+
+void Deflater::putBits(unsigned int bits, int count, std::string& out) {
+    _bitBuf |= static_cast<unsigned long>(bits) << _bitCount;
+    _bitCount += count;
+    while (_bitCount >= 8) {
+        out.push_back(static_cast<char>(_bitBuf & 0xFF));
+        _bitBuf >>= 8;
+        _bitCount -= 8;
+    }
+}
+
+void Deflater::alignToByte(std::string& out) {
+    if (_bitCount > 0)
+        putBits(0, 8 - _bitCount, out);
+}
@@ -128,6 +128,7 @@ std::string ErrorHandler::getErrorMessage(int code) {
         case 200: return "OK";
         case 201: return "Created";
         case 204: return "No Content";
+        case 206: return "Partial Content";
         
         // 3xx Redirection
         case 301: return "Moved Permanently";
@@ -146,9 +147,11 @@ std::string ErrorHandler::getErrorMessage(int code) {
         case 409: return "Conflict";
         case 410: return "Gone";
         case 411: return "Length Required";
+        case 412: return "Precondition Failed";
         case 413: return "Payload Too Large";
         case 414: return "URI Too Long";
         case 415: return "Unsupported Media Type";
+        case 416: return "Range Not Satisfiable";
         case 429: return "Too Many Requests";
         
         // 5xx Server Error
@@ -0,0 +1,78 @@
+#include "ErrorPageCache.hpp"
+#include "ErrorHandler.hpp"
+#include "Deflater.hpp"
+#include <sstream>
+#include <sys/stat.h>
+
+ErrorPageCache::ErrorPageCache() {}
+
+ErrorPageCache::Entry& ErrorPageCache::refresh(int code, const std::string& pagePath) {
+    const std::pair<std::string, int> key(pagePath, code);
+    const time_t now = std::time(NULL);
+
+    std::map<std::pair<std::string, int>, Entry>::iterator it = _entries.find(key);
+    if (it != _entries.end() && it->second.checkedAt == now)
+        return it->second;
+
+    struct stat st;
+    bool found = !pagePath.empty() && stat(pagePath.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    if (it != _entries.end()) {
+        Entry& e = it->second;
+        e.checkedAt = now;
+        if (found == e.found && (!found || (e.dev == st.st_dev && e.ino == st.st_ino
+                                            && e.mtime == st.st_mtime && e.size == st.st_size)))
+            return e;
+    }
+
+    // 처음이거나 페이지가 생김/바뀜/사라짐: 다시 만든다
+    Entry& e = _entries[key];
+    e.found = found;
+    e.dev = found ? st.st_dev : 0;
+    e.ino = found ? st.st_ino : 0;
+    e.mtime = found ? st.st_mtime : 0;
+    e.size = found ? st.st_size : 0;
+    e.checkedAt = now;
+    e.variants.clear();
+
+    std::string body;
+    if (found)
+        body = ErrorHandler::readErrorPage(pagePath);
+    if (body.empty())
+        body = ErrorHandler::getDefaultErrorPage(code, ErrorHandler::getErrorMessage(code));
+    e.body = SharedBuffer::adopt(body);
+    return e;
+}
+
+HttpResponse ErrorPageCache::build(int code, const std::string& pagePath,
+                                   const GzipFilter& gzip, const std::string& acceptEncoding) {
+    Entry& e = refresh(code, pagePath);
+
+    HttpResponse response;
+    response.setStatus(code);
+    response.setContentType("text/html");
+
+    const SharedBuffer* body = &e.body;
+    if (gzip.matches("text/html", e.body.size())) {
+        response.setHeader("Vary", "Accept-Encoding");
+        const char* coding = gzip.negotiate(acceptEncoding);
+        if (coding) {
+            std::ostringstream key;
+            key << coding << "/" << gzip.level();
+            body = NULL;
+            for (size_t i = 0; i < e.variants.size() && body == NULL; ++i) {
+                if (e.variants[i].first == key.str())
+                    body = &e.variants[i].second;
+            }
+            if (body == NULL) {
+                std::string packed;
+                Deflater::compress(GzipFilter::formatOf(coding), gzip.level(),
+                                   e.body.data(), e.body.size(), packed);
+                e.variants.push_back(std::make_pair(key.str(), SharedBuffer::adopt(packed)));
+                body = &e.variants.back().second;
+            }
+            response.setHeader("Content-Encoding", coding);
+        }
+    }
+    response.setBody(*body);
+    return response;
+}
@@ -0,0 +1,91 @@
+#include "FastCgi.hpp"
+
+static const unsigned char FCGI_VERSION_1 = 1;
+static const size_t FCGI_HEADER_LEN = 8;
+static const size_t FCGI_MAX_CONTENT = 65535;
+static const unsigned char FCGI_RESPONDER = 1;
+static const unsigned char FCGI_KEEP_CONN = 1;
+
+void FastCgi::appendHeader(std::string& out, unsigned char type, unsigned short requestId,
+                           size_t contentLength, unsigned char padding) {
+    char h[FCGI_HEADER_LEN];
+    h[0] = static_cast<char>(FCGI_VERSION_1);
+    h[1] = static_cast<char>(type);
+    h[2] = static_cast<char>((requestId >> 8) & 0xff);
+    h[3] = static_cast<char>(requestId & 0xff);
+    h[4] = static_cast<char>((contentLength >> 8) & 0xff);
+    h[5] = static_cast<char>(contentLength & 0xff);
+    h[6] = static_cast<char>(padding);
+    h[7] = 0;
+    out.append(h, FCGI_HEADER_LEN);
+}
+
+void FastCgi::appendBeginRequest(std::string& out, unsigned short requestId, bool keepConn) {
+    appendHeader(out, BEGIN_REQUEST, requestId, 8, 0);
+    char body[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    body[1] = static_cast<char>(FCGI_RESPONDER);
+    body[2] = static_cast<char>(keepConn ? FCGI_KEEP_CONN : 0);
+    out.append(body, sizeof(body));
+}
+
+// name-value 길이: 127 이하는 1바이트, 그 이상은 최상위 비트를 켠 4바이트
+void FastCgi::appendLength(std::string& out, size_t len) {
+    if (len < 128) {
+        out += static_cast<char>(len);
+        return;
+    }
+    out += static_cast<char>(((len >> 24) & 0x7f) | 0x80);
+    out += static_cast<char>((len >> 16) & 0xff);
+    out += static_cast<char>((len >> 8) & 0xff);
+    out += static_cast<char>(len & 0xff);
+}
+
+void FastCgi::appendParams(std::string& out, unsigned short requestId,
+                           const std::map<std::string, std::string>& params) {
+    std::string encoded;
+    for (std::map<std::string, std::string>::const_iterator it = params.begin();
+         it != params.end(); ++it) {
+        appendLength(encoded, it->first.size());
+        appendLength(encoded, it->second.size());
+        encoded.append(it->first);
+        encoded.append(it->second);
+    }
+    if (!encoded.empty())
+        appendStream(out, PARAMS, requestId, encoded.data(), encoded.size());
+    appendStream(out, PARAMS, requestId, NULL, 0);
+}
+
+void FastCgi::appendStream(std::string& out, unsigned char type, unsigned short requestId,
+                           const char* data, size_t len) {
+    if (len == 0) {
+        appendHeader(out, type, requestId, 0, 0);
+        return;
+    }
+    // 레코드를 8바이트 경계로 맞추면 서버 쪽 파싱이 정렬된 읽기를 할 수 있다
+    while (len > 0) {
+        size_t n = (len > FCGI_MAX_CONTENT) ? FCGI_MAX_CONTENT : len;
+        unsigned char padding = static_cast<unsigned char>((8 - (n % 8)) % 8);
+        appendHeader(out, type, requestId, n, padding);
+        out.append(data, n);
+        out.append(padding, '\0');
+        data += n;
+        len -= n;
+    }
+}
+
+bool FastCgi::nextRecord(const std::string& buf, size_t& pos, Record& rec) {
+    if (buf.size() - pos < FCGI_HEADER_LEN)
+        return false;
+    const unsigned char* h = reinterpret_cast<const unsigned char*>(buf.data() + pos);
+    size_t contentLength = (static_cast<size_t>(h[4]) << 8) | h[5];
+    size_t total = FCGI_HEADER_LEN + contentLength + h[6];
+    if (buf.size() - pos < total)
+        return false;
+
+    rec.type = h[1];
+    rec.requestId = static_cast<unsigned short>((h[2] << 8) | h[3]);
+    rec.contentOffset = pos + FCGI_HEADER_LEN;
+    rec.contentLength = contentLength;
+    pos += total;
+    return true;
+}
@@ -0,0 +1,110 @@
+#include "FileCache.hpp"
+
+FileCache::FileCache(size_t maxBytes, size_t maxEntrySize)
+: _maxBytes(maxBytes), _maxEntrySize(maxEntrySize), _bytes(0),
+  _hits(0), _misses(0), _evictions(0) {}
+
+const FileCache::Entry* FileCache::lookup(const std::string& path, const struct stat& st) {
+    std::map<std::string, LruList::iterator>::iterator it = _index.find(path);
+    if (it == _index.end()) {
+        ++_misses;
+        return NULL;
+    }
+
+    LruList::iterator e = it->second;
+    if (e->dev != st.st_dev || e->ino != st.st_ino
+        || e->mtime != st.st_mtime || e->size != st.st_size) {
+        // 파일이 교체/수정됨: 오래된 내용은 버리고 다시 읽게 한다
+        erase(e);
+        ++_misses;
+        return NULL;
+    }
+
+    _lru.splice(_lru.begin(), _lru, e);
+    ++_hits;
+    return &*e;
+}
+
+bool FileCache::admits(size_t size) const {
+    return size <= _maxEntrySize && size <= _maxBytes;
+}
+
+const FileCache::Entry* FileCache::insert(const std::string& path, const struct stat& st,
+                                          std::string& body, const std::string& contentType,
+                                          const std::string& lastModified) {
+    if (!admits(body.size()))
+        return NULL;
+
+    std::map<std::string, LruList::iterator>::iterator old = _index.find(path);
+    if (old != _index.end())
+        erase(old->second);
+
+    while (!_lru.empty() && _bytes + body.size() > _maxBytes)
+        evictOne();
+
+    _lru.push_front(Entry());
+    Entry& e = _lru.front();
+    e.path = path;
+    e.dev = st.st_dev;
+    e.ino = st.st_ino;
+    e.mtime = st.st_mtime;
+    e.size = st.st_size;
+    e.body = SharedBuffer::adopt(body);
+    e.contentType = contentType;
+    e.lastModified = lastModified;
+
+    _index[path] = _lru.begin();
+    _bytes += e.body.size();
+    return &e;
+}
+
+const SharedBuffer* FileCache::variant(const Entry* entry, const std::string& coding) const {
+    for (size_t i = 0; i < entry->variants.size(); ++i) {
+        if (entry->variants[i].first == coding)
+            return &entry->variants[i].second;
+    }
+    return NULL;
+}
+
+const SharedBuffer* FileCache::addVariant(const Entry* entry, const std::string& coding,
+                                          std::string& bytes) {
+    std::map<std::string, LruList::iterator>::iterator it = _index.find(entry->path);
+    if (it == _index.end() || &*it->second != entry || bytes.size() > _maxBytes)
+        return NULL;
+
+    // 방금 조회한 항목은 맨 앞: 뒤쪽부터 밀어내되 자기 자신은 남긴다
+    LruList::iterator e = it->second;
+    _lru.splice(_lru.begin(), _lru, e);
+    while (_bytes + bytes.size() > _maxBytes && _lru.size() > 1)
+        evictOne();
+    if (_bytes + bytes.size() > _maxBytes)
+        return NULL;
+
+    _bytes += bytes.size();
+    e->variants.push_back(std::make_pair(coding, SharedBuffer::adopt(bytes)));
+    return &e->variants.back().second;
+}
+
+void FileCache::evictOne() {
+    erase(--_lru.end());
+    ++_evictions;
+}
+
+// 전송 중인 응답이 body를 참조하고 있어도 SharedBuffer 카운트로 안전하게 해제
+void FileCache::erase(LruList::iterator it) {
+    _bytes -= it->body.size();
+    for (size_t i = 0; i < it->variants.size(); ++i)
+        _bytes -= it->variants[i].second.size();
+    _index.erase(it->path);
+    _lru.erase(it);
+}
+
+FileCache::Stats FileCache::stats() const {
+    Stats s;
+    s.hits = _hits;
+    s.misses = _misses;
+    s.evictions = _evictions;
+    s.entries = _lru.size();
+    s.bytes = _bytes;
+    return s;
+}
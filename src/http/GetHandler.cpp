@@ -11,13 +11,160 @@
 /* ************************************************************************** */
 
 #include "GetHandler.hpp"
+#include "Deflater.hpp"
 #include <sys/stat.h>
 #include <dirent.h>
 #include <fstream>
 #include <sstream>
 #include <cctype>
 #include <cstdlib>
+#include <cstring>
+#include <strings.h>
 #include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctime>
+#include <cstdio>
+
+// If-Match / If-None-Match 목록에 etag가 있는지
+// weak: W/ 접두어를 무시하고 비교 (If-None-Match), strong: 둘 다 strong이고 같아야 함 (If-Match)
+static bool etagListMatches(const std::string& list, const std::string& etag, bool weak) {
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+            comma = list.size();
+        size_t a = pos;
+        size_t b = comma;
+        while (a < b && std::isspace(static_cast<unsigned char>(list[a]))) a++;
+        while (b > a && std::isspace(static_cast<unsigned char>(list[b-1]))) b--;
+        std::string tag = list.substr(a, b - a);
+        pos = comma + 1;
+
+        if (tag == "*")
+            return true;
+        if (tag.compare(0, 2, "W/") == 0) {
+            if (!weak)
+                continue;
+            tag.erase(0, 2);
+        }
+        if (tag == etag)
+            return true;
+    }
+    return false;
+}
+
+static const std::string* findHeader(const HttpRequest& request, const char* name) {
+    const std::map<std::string, std::string>& h = request.getHeaders();
+    std::map<std::string, std::string>::const_iterator it = h.find(name);
+    return (it == h.end()) ? NULL : &it->second;
+}
+
+// gzip_static: path.br / path.gz 중 클라이언트가 받을 수 있는 첫 파일 (br 우선)
+// 원본보다 오래된 압축 파일은 내용이 다를 수 있으므로 쓰지 않는다
+static const char* findPrecompressed(const HttpRequest& request, const std::string& path,
+                                     const struct stat& st, std::string& outPath,
+                                     struct stat& outSt) {
+    static const char* const codings[][2] = {
+        { "br", ".br" },
+        { "gzip", ".gz" }
+    };
+    const std::string* accept = findHeader(request, "accept-encoding");
+    if (accept == NULL)
+        return NULL;
+    for (size_t i = 0; i < sizeof(codings) / sizeof(codings[0]); ++i) {
+        if (!GzipFilter::acceptsEncoding(*accept, codings[i][0]))
+            continue;
+        std::string candidate = path + codings[i][1];
+        struct stat cst;
+        if (stat(candidate.c_str(), &cst) == 0 && S_ISREG(cst.st_mode)
+            && cst.st_mtime >= st.st_mtime) {
+            outPath = candidate;
+            outSt = cst;
+            return codings[i][0];
+        }
+    }
+    return NULL;
+}
+
+// "bytes=a-b, c-, -n" 파싱. 만족 가능한 구간만 [first, last]로 out에 넣는다
+// 숫자 문자열 -> off_t. off_t를 넘는 값은 최댓값으로 (suffix면 파일 전체, start면 만족 불가 구간)
+static off_t parseRangeOffset(const std::string& digits) {
+    const off_t maxOffset = std::numeric_limits<off_t>::max();
+    off_t n = 0;
+    for (size_t i = 0; i < digits.size(); ++i) {
+        off_t d = digits[i] - '0';
+        if (n > (maxOffset - d) / 10)
+            return maxOffset;
+        n = n * 10 + d;
+    }
+    return n;
+}
+
+// 반환: false면 문법 오류 (Range 헤더를 무시하고 전체 응답)
+static bool parseByteRanges(const std::string& value, off_t size,
+                            std::vector<std::pair<off_t, off_t> >& out) {
+    static const size_t MAX_RANGES = 32;    // 잘게 쪼갠 구간으로 응답을 부풀리는 요청 방지
+
+    if (value.size() < 6 || strncasecmp(value.c_str(), "bytes=", 6) != 0)
+        return false;
+    size_t pos = 6;
+    size_t count = 0;
+    while (pos <= value.size()) {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos)
+            comma = value.size();
+        size_t a = pos;
+        size_t b = comma;
+        pos = comma + 1;
+        while (a < b && std::isspace(static_cast<unsigned char>(value[a]))) a++;
+        while (b > a && std::isspace(static_cast<unsigned char>(value[b-1]))) b--;
+        if (a == b)
+            continue;               // 빈 항목 (", ,") 허용
+        if (++count > MAX_RANGES)
+            return false;
+
+        std::string spec = value.substr(a, b - a);
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos)
+            return false;
+        std::string first = spec.substr(0, dash);
+        std::string last = spec.substr(dash + 1);
+        if (first.find_first_not_of("0123456789") != std::string::npos
+            || last.find_first_not_of("0123456789") != std::string::npos
+            || (first.empty() && last.empty()))
+            return false;
+
+        off_t start;
+        off_t end;
+        if (first.empty()) {
+            // suffix: 마지막 n 바이트
+            off_t n = parseRangeOffset(last);
+            if (n == 0 || size == 0)
+                continue;
+            start = (n < size) ? size - n : 0;
+            end = size - 1;
+        } else {
+            start = parseRangeOffset(first);
+            if (!last.empty()) {
+                end = parseRangeOffset(last);
+                if (end < start)
+                    return false;
+            } else {
+                end = size - 1;
+            }
+            if (start >= size)
+                continue;           // 만족 불가 구간
+            if (end >= size)
+                end = size - 1;
+        }
+        out.push_back(std::make_pair(start, end));
+    }
+    return count > 0;
+}
+
+GETHandler::GETHandler(FileCache* fileCache, const GzipFilter* gzipFilter)
+: cache(fileCache), gzip(gzipFilter) {}
 
 /* ================= Main ================= */
 
@@ -43,17 +190,17 @@ HttpResponse GETHandler::handle(const HttpRequest& request,
 
     // 디렉토리인 경우
     if (S_ISDIR(st.st_mode)) {
-        return handleDirectory(path, request.getURI(), location);
+        return handleDirectory(request, path, location);
     }
 
     // 일반 파일인 경우
-    return handleFile(path, st);
+    return handleFile(request, path, st, location);
 }
 
 /* ================= Directory Handling ================= */
 
-HttpResponse GETHandler::handleDirectory(const std::string& path,
-                                        const std::string& uri,
+HttpResponse GETHandler::handleDirectory(const HttpRequest& request,
+                                        const std::string& path,
                                         const LocationConfig& location) {
     HttpResponse response;
     const std::vector<std::string> emptyIndex;
@@ -69,13 +216,13 @@ HttpResponse GETHandler::handleDirectory(const std::string& path,
 
         struct stat st;
         if (stat(indexPath.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
-            return handleFile(indexPath, st);
+            return handleFile(request, indexPath, st, location);
         }
     }
 
     // index 파일이 없고 autoindex가 활성화되어 있으면
     if (location.hasAutoindex() && location.getAutoindex()) {
-        std::string body = generateAutoIndex(path, uri);
+        std::string body = generateAutoIndex(path, request.getURI());
         response.setBody(body);
         response.setContentType("text/html");
         return response;
@@ -89,39 +236,238 @@ HttpResponse GETHandler::handleDirectory(const std::string& path,
 
 /* ================= File Handling ================= */
 
-HttpResponse GETHandler::handleFile(const std::string& path,
-                                   const struct stat& st) {
+HttpResponse GETHandler::handleFile(const HttpRequest& request,
+                                   const std::string& path,
+                                   const struct stat& st,
+                                   const LocationConfig& location) {
+    // Content-Type은 항상 원본 파일 기준 (app.js.gz도 application/javascript)
+    const std::string mime = getMimeType(path);
+    if (!location.getGzipStatic())
+        return serveFile(request, path, st, mime, true);
+
+    // 미리 압축된 파일은 별개의 표현: ETag / 조건부 요청 / Range 모두 그 파일의 stat으로 판단
+    std::string encodedPath;
+    struct stat encodedSt;
+    const char* encoding = findPrecompressed(request, path, st, encodedPath, encodedSt);
+    HttpResponse response = encoding
+        ? serveFile(request, encodedPath, encodedSt, mime, false)
+        : serveFile(request, path, st, mime, true);
+
+    // Accept-Encoding에 따라 응답이 달라지므로 원본을 보낼 때도 Vary (공유 캐시가 섞지 않도록)
+    response.setHeader("Vary", "Accept-Encoding");
+    if (encoding && (response.getStatusCode() == 200 || response.getStatusCode() == 206))
+        response.setHeader("Content-Encoding", encoding);
+    return response;
+}
+
+HttpResponse GETHandler::serveFile(const HttpRequest& request,
+                                   const std::string& path,
+                                   const struct stat& st,
+                                   const std::string& mime,
+                                   bool mayCompress) {
     HttpResponse response;
+    size_t size = static_cast<size_t>(st.st_size);
+
+    // gzip: 캐시에 들어갈 수 있는 파일만 (압축본을 캐시 항목에 붙여 재사용)
+    // Range 요청은 원본 파일 구간으로 응답하므로 압축하지 않는다
+    bool vary = false;
+    const char* coding = NULL;
+    if (mayCompress && gzip && cache && cache->admits(size) && gzip->matches(mime, size)) {
+        vary = true;
+        const std::string* accept = findHeader(request, "accept-encoding");
+        if (accept && !findHeader(request, "range"))
+            coding = gzip->negotiate(*accept);
+    }
 
-    // 파일 크기 제한 (예: 100MB)
-    const size_t MAX_FILE_SIZE = 100 * 1024 * 1024;
-    if (static_cast<size_t>(st.st_size) > MAX_FILE_SIZE) {
-        response.setStatus(413);
-        response.setBody("<h1>413 Payload Too Large</h1>");
+    // 조건부 요청: stat 결과만으로 판단하므로 304 / 412는 파일을 열지도 않는다
+    // 압축본은 다른 표현이라 ETag에 coding을 붙인다
+    std::string etag = makeETag(st);
+    if (coding)
+        etag.insert(etag.size() - 1, std::string("-") + coding);
+    int precondition = evaluatePreconditions(request, st, etag);
+    if (precondition != 0) {
+        response.setStatus(precondition);
+        if (precondition == 304) {
+            response.setHeader("ETag", etag);
+            response.setHeader("Last-Modified", formatHttpDate(st.st_mtime));
+            if (vary)
+                response.setHeader("Vary", "Accept-Encoding");
+        }
         return response;
     }
 
-    // 파일 읽기
-    std::string body = readFile(path);
-    if (body.empty() && st.st_size > 0) {
-        // 파일이 존재하지만 읽을 수 없음 (권한 문제)
-        response.setStatus(403);
-        response.setBody("<h1>403 Forbidden</h1>");
+    // Range: 파일 구간만 sendfile로 (캐시된 바디 대신 파일에서 바로)
+    if (applyRange(request, path, st, etag, mime, response)) {
+        if (vary)
+            response.setHeader("Vary", "Accept-Encoding");
         return response;
     }
 
-    response.setBody(body);
-    response.setContentType(getMimeType(path));
+    // 작은 파일은 메모리 캐시에서 바로 (stat 결과로 변경 여부 확인)
+    if (cache) {
+        const FileCache::Entry* entry = cache->lookup(path, st);
+        if (!entry && cache->admits(size)) {
+            std::string body;
+            if (readWhole(path, size, body))
+                entry = cache->insert(path, st, body, mime, formatHttpDate(st.st_mtime));
+        }
+        if (entry) {
+            const SharedBuffer* body = &entry->body;
+            if (coding) {
+                const SharedBuffer* packed = cache->variant(entry, coding);
+                if (packed == NULL) {
+                    std::string bytes;
+                    Deflater::compress(GzipFilter::formatOf(coding), gzip->level(),
+                                       entry->body.data(), entry->body.size(), bytes);
+                    packed = cache->addVariant(entry, coding, bytes);
+                }
+                if (packed) {
+                    body = packed;
+                    response.setHeader("Content-Encoding", coding);
+                } else {
+                    etag = makeETag(st);    // 캐시에 못 넣으면 원본으로
+                }
+            }
+            response.setBody(*body);
+            response.setContentType(entry->contentType);
+            response.setHeader("Last-Modified", entry->lastModified);
+            response.setHeader("ETag", etag);
+            if (!coding)
+                response.setHeader("Accept-Ranges", "bytes");
+            if (vary)
+                response.setHeader("Vary", "Accept-Encoding");
+            return response;
+        }
+    }
+
+    // 파일 내용은 읽지 않는다: 전송 단계에서 sendfile로 커널 -> 소켓 직접 전송
+    // (크기 제한 없이 큰 파일도 메모리 사용량 일정)
+    response.setFileBody(path, size);
+    response.setContentType(mime);
     
     // Last-Modified 헤더 추가 (캐싱 지원)
-    char timeBuf[100];
-    struct tm* tm = gmtime(&st.st_mtime);
-    strftime(timeBuf, sizeof(timeBuf), "%a, %d %b %Y %H:%M:%S GMT", tm);
-    response.setHeader("Last-Modified", std::string(timeBuf));
+    response.setHeader("Last-Modified", formatHttpDate(st.st_mtime));
+    response.setHeader("ETag", makeETag(st));
+    response.setHeader("Accept-Ranges", "bytes");
     
     return response;
 }
 
+// Range 요청이면 206 / 416 응답을 만들고 true. 무시해야 하면 false (전체 200 응답)
+bool GETHandler::applyRange(const HttpRequest& request, const std::string& path,
+                            const struct stat& st, const std::string& etag,
+                            const std::string& mime, HttpResponse& response) const {
+    const std::string* range = findHeader(request, "range");
+    if (range == NULL)
+        return false;
+
+    // If-Range: 클라이언트가 가진 버전과 같을 때만 구간 응답 (ETag는 strong 비교, 날짜는 정확히 일치)
+    const std::string* ifRange = findHeader(request, "if-range");
+    if (ifRange) {
+        if (!ifRange->empty() && ((*ifRange)[0] == '"' || ifRange->compare(0, 2, "W/") == 0)) {
+            if (*ifRange != etag)
+                return false;
+        } else {
+            time_t date;
+            if (!HttpResponse::parseHttpDate(*ifRange, date) || date != st.st_mtime)
+                return false;
+        }
+    }
+
+    const off_t size = st.st_size;
+    std::vector<std::pair<off_t, off_t> > ranges;
+    if (!parseByteRanges(*range, size, ranges))
+        return false;
+
+    std::ostringstream total;
+    total << "/" << size;
+
+    if (ranges.empty()) {
+        response.setStatus(416);
+        response.setHeader("Content-Range", "bytes *" + total.str());
+        return true;
+    }
+
+    response.setStatus(206);
+    response.setFileBody(path, static_cast<size_t>(size));
+    response.setHeader("Last-Modified", formatHttpDate(st.st_mtime));
+    response.setHeader("ETag", etag);
+    response.setHeader("Accept-Ranges", "bytes");
+
+    if (ranges.size() == 1) {
+        std::ostringstream cr;
+        cr << "bytes " << ranges[0].first << "-" << ranges[0].second << total.str();
+        response.setContentType(mime);
+        response.setHeader("Content-Range", cr.str());
+        response.addFileSegment("", ranges[0].first,
+                                static_cast<size_t>(ranges[0].second - ranges[0].first + 1));
+        return true;
+    }
+
+    // multipart/byteranges: part마다 헤더 + 파일 구간, 마지막에 닫는 구분자
+    std::ostringstream boundary;
+    boundary << "webserv_range_" << std::hex << static_cast<unsigned long>(st.st_ino)
+             << static_cast<unsigned long>(std::time(NULL));
+    response.setContentType("multipart/byteranges; boundary=" + boundary.str());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        std::ostringstream part;
+        if (i > 0)
+            part << "\r\n";
+        part << "--" << boundary.str() << "\r\n"
+             << "Content-Type: " << mime << "\r\n"
+             << "Content-Range: bytes " << ranges[i].first << "-" << ranges[i].second
+             << total.str() << "\r\n\r\n";
+        response.addFileSegment(part.str(), ranges[i].first,
+                                static_cast<size_t>(ranges[i].second - ranges[i].first + 1));
+    }
+    response.setFileSuffix("\r\n--" + boundary.str() + "--\r\n");
+    return true;
+}
+
+// strong ETag: inode-크기-mtime (16진수). 내용이 바뀌면 셋 중 하나는 바뀐다
+std::string GETHandler::makeETag(const struct stat& st) const {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx\"",
+                  static_cast<unsigned long>(st.st_ino),
+                  static_cast<unsigned long>(st.st_size),
+                  static_cast<unsigned long>(st.st_mtime));
+    return std::string(buf);
+}
+
+// RFC 9110 13.2.2 순서: If-Match -> If-Unmodified-Since -> If-None-Match -> If-Modified-Since
+// 반환: 0 (그대로 200 응답), 304, 412
+int GETHandler::evaluatePreconditions(const HttpRequest& request, const struct stat& st,
+                                      const std::string& etag) const {
+    time_t date;
+
+    const std::string* ifMatch = findHeader(request, "if-match");
+    if (ifMatch) {
+        if (!etagListMatches(*ifMatch, etag, false))
+            return 412;
+    } else {
+        const std::string* ifUnmodified = findHeader(request, "if-unmodified-since");
+        if (ifUnmodified && HttpResponse::parseHttpDate(*ifUnmodified, date) && st.st_mtime > date)
+            return 412;
+    }
+
+    const std::string* ifNoneMatch = findHeader(request, "if-none-match");
+    if (ifNoneMatch)
+        return etagListMatches(*ifNoneMatch, etag, true) ? 304 : 0;
+
+    // If-None-Match가 있으면 날짜는 보지 않는다 (ETag가 더 정확함)
+    const std::string* ifModified = findHeader(request, "if-modified-since");
+    if (ifModified && HttpResponse::parseHttpDate(*ifModified, date) && st.st_mtime <= date)
+        return 304;
+    return 0;
+}
+
+std::string GETHandler::formatHttpDate(time_t t) const {
+    char timeBuf[100];
+    struct tm* tm = gmtime(&t);
+    strftime(timeBuf, sizeof(timeBuf), "%a, %d %b %Y %H:%M:%S GMT", tm);
+    return std::string(timeBuf);
+}
+
 /* ================= Utils ================= */
 
 std::string GETHandler::buildPath(const std::string& uri,
@@ -227,6 +573,28 @@ std::string GETHandler::readFile(const std::string& path) const {
     return content;
 }
 
+// 캐시용: stat 크기만큼 정확히 읽혔을 때만 true (읽는 도중 파일이 바뀌면 캐시하지 않음)
+bool GETHandler::readWhole(const std::string& path, size_t size, std::string& out) const {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    out.resize(size);
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, &out[got], size - got);
+        if (n <= 0)
+            break;
+        got += static_cast<size_t>(n);
+    }
+    char extra;
+    bool exact = (got == size && read(fd, &extra, 1) == 0);
+    close(fd);
+    if (!exact)
+        out.clear();
+    return exact;
+}
+
 /* ================= Autoindex ================= */
 
 std::string GETHandler::generateAutoIndex(const std::string& path,
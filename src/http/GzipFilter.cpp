@@ -0,0 +1,130 @@
+#include "GzipFilter.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+GzipFilter::GzipFilter(const ServerConfig& cfg) : _cfg(cfg) {}
+
+bool GzipFilter::acceptsEncoding(const std::string& header, const char* coding) {
+    int exact = -1;
+    int wildcard = -1;
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t comma = header.find(',', pos);
+        if (comma == std::string::npos)
+            comma = header.size();
+        size_t semi = header.find(';', pos);
+        size_t a = pos;
+        size_t b = (semi < comma) ? semi : comma;
+        while (a < b && std::isspace(static_cast<unsigned char>(header[a]))) a++;
+        while (b > a && std::isspace(static_cast<unsigned char>(header[b-1]))) b--;
+        std::string name = header.substr(a, b - a);
+
+        int allowed = 1;
+        if (semi < comma) {
+            std::string params = header.substr(semi + 1, comma - semi - 1);
+            size_t q = params.find("q=");
+            if (q == std::string::npos)
+                q = params.find("Q=");
+            if (q != std::string::npos && std::strtod(params.c_str() + q + 2, NULL) <= 0.0)
+                allowed = 0;
+        }
+        pos = comma + 1;
+
+        if (strcasecmp(name.c_str(), coding) == 0)
+            exact = allowed;
+        else if (name == "*")
+            wildcard = allowed;
+    }
+    if (exact >= 0)
+        return exact == 1;
+    return wildcard == 1;
+}
+
+Deflater::Format GzipFilter::formatOf(const char* coding) {
+    return (std::strcmp(coding, "deflate") == 0) ? Deflater::FORMAT_ZLIB : Deflater::FORMAT_GZIP;
+}
+
+void GzipFilter::addVary(HttpResponse& response) {
+    std::string vary = response.getHeader("Vary");
+    size_t pos = 0;
+    while (pos < vary.size()) {
+        size_t comma = vary.find(',', pos);
+        if (comma == std::string::npos)
+            comma = vary.size();
+        size_t a = pos;
+        size_t b = comma;
+        while (a < b && std::isspace(static_cast<unsigned char>(vary[a]))) a++;
+        while (b > a && std::isspace(static_cast<unsigned char>(vary[b-1]))) b--;
+        std::string name = vary.substr(a, b - a);
+        // 이미 있거나 "*"(모든 요청이 다름)이면 더할 필요 없음
+        if (name == "*" || strcasecmp(name.c_str(), "Accept-Encoding") == 0)
+            return;
+        pos = comma + 1;
+    }
+    response.setHeader("Vary", vary.empty() ? "Accept-Encoding" : vary + ", Accept-Encoding");
+}
+
+bool GzipFilter::enabled() const { return _cfg.getGzip(); }
+
+int GzipFilter::level() const { return _cfg.getGzipCompLevel(); }
+
+bool GzipFilter::matchesType(const std::string& contentType) const {
+    if (!_cfg.getGzip())
+        return false;
+    // 파라미터(charset 등) 제외, 대소문자 무시
+    size_t end = contentType.find(';');
+    if (end == std::string::npos)
+        end = contentType.size();
+    while (end > 0 && std::isspace(static_cast<unsigned char>(contentType[end - 1])))
+        end--;
+    std::string type = contentType.substr(0, end);
+    for (size_t i = 0; i < type.size(); ++i)
+        type[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(type[i])));
+
+    const std::vector<std::string>& types = _cfg.getGzipTypes();
+    for (size_t i = 0; i < types.size(); ++i) {
+        if (types[i] == "*" || strcasecmp(types[i].c_str(), type.c_str()) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool GzipFilter::matches(const std::string& contentType, size_t size) const {
+    return size >= _cfg.getGzipMinLength() && matchesType(contentType);
+}
+
+const char* GzipFilter::negotiate(const std::string& acceptEncoding) const {
+    if (!_cfg.getGzip() || acceptEncoding.empty())
+        return NULL;
+    if (acceptsEncoding(acceptEncoding, "gzip"))
+        return "gzip";
+    if (acceptsEncoding(acceptEncoding, "deflate"))
+        return "deflate";
+    return NULL;
+}
+
+void GzipFilter::apply(const std::string& acceptEncoding, HttpResponse& response) const {
+    int status = response.getStatusCode();
+    if (status < 200 || status == 204 || status == 206 || status == 304)
+        return;
+    if (response.hasFileBody() || response.hasSharedBody()
+        || !response.getHeader("Content-Encoding").empty())
+        return;
+    if (!matches(response.getContentType(), response.getBodySize()))
+        return;
+
+    // 이 응답은 Accept-Encoding에 따라 달라진다 (압축하지 않는 경우에도)
+    addVary(response);
+    const char* coding = negotiate(acceptEncoding);
+    if (coding == NULL)
+        return;
+
+    std::string body;
+    response.takeBody(body);
+    std::string compressed;
+    Deflater::compress(formatOf(coding), level(), body.data(), body.size(), compressed);
+    response.setBody(SharedBuffer::adopt(compressed));
+    response.setHeader("Content-Encoding", coding);
+}
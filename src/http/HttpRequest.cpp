@@ -11,75 +11,94 @@
 /* ************************************************************************** */
 
 #include "HttpRequest.hpp"
+#include "MultipartParser.hpp"
 #include <sstream>
 #include <cstdlib>
 #include <cctype>
+#include <cstring>
+#include <unistd.h>
+
+// 큰 요청 바디를 담을 임시 파일 (생성 직후 unlink: 프로세스가 죽어도 남지 않는다)
+static const char BODY_TEMP_TEMPLATE[] = "/tmp/webserv_body_XXXXXX";
 
 // 기본 생성자: 각 플래그와 상태값을 초기화한다.
 HttpRequest::HttpRequest()
-    : headersParsed(false),
+    : bodySize(0),
+      bodyFd(-1),
+      multipart(NULL),
+      bodyPolicySet(false),
+      maxBodySize(MAX_REQUEST_SIZE),
+      bodyBufferSize(DEFAULT_BODY_BUFFER_SIZE),
+      headersParsed(false),
       bodyParsed(false),
       complete(false),
       error(false),
       errorType(ERROR_NONE),
       contentLength(0),
       chunked(false),
-      bodyStart(0),
+      headerScanPos(0),
+      chunkState(CHUNK_SIZE),
+      chunkRemaining(0),
       lastActivityTime(std::time(NULL)),
       consumedLength(0) {}
 
-// 소켓에서 새로 읽은 데이터를 rawBuffer에 이어 붙이고,
-// 헤더/바디를 순차적으로 파싱한다.
-// complete가 true가 되면 하나의 HTTP 요청이 완성된 것.
-bool HttpRequest::appendData(const std::string& data) {
-    rawBuffer += data;
+HttpRequest::~HttpRequest() {
+    if (bodyFd != -1)
+        ::close(bodyFd);
+    delete multipart;
+}
 
-    // CHECK) 전체 요청 크기 제한 검사
-    if (rawBuffer.size() > MAX_REQUEST_SIZE)
-    {
-        error = true;
-        setError(ERROR_REQUEST_TOO_LARGE);
-        return false;
-    }
+// 연결 버퍼 in에서 이 요청에 속한 바이트만 소비한다.
+// 이미 검사한 바이트는 다시 보지 않으므로 큰 요청도 전체 비용이 선형이다.
+// complete가 true가 되면 하나의 HTTP 요청이 완성된 것.
+bool HttpRequest::consume(std::string& in) {
+    if (complete || error)
+        return complete;
 
     // 아직 헤더를 다 읽지 못했다면, 헤더 끝("\r\n\r\n")을 찾는다.
+    // 헤더 바이트는 완성될 때까지 in에 그대로 두고, 검색 위치만 기억한다.
     if (!headersParsed) {
-        size_t pos = rawBuffer.find("\r\n\r\n");
-        
-        // CHECK)
-        if (pos != std::string::npos)
+        size_t pos = in.find("\r\n\r\n", headerScanPos);
+
+        if (pos == std::string::npos)
         {
-            if (pos > MAX_HEADER_SIZE)
+            // CHECK) 종료 패턴 없이 헤더 제한을 넘으면 더 기다릴 필요 없음
+            if (in.size() > MAX_HEADER_SIZE + 3)
             {
-                error = true;
                 setError(ERROR_HEADER_TOO_LARGE);
                 return false;
             }
-
-            parseHeaders(rawBuffer.substr(0, pos));
-
-            if (error)
-                return false;
-            
-            bodyStart = pos + 4;
-            headersParsed = true;
+            // 경계에 걸친 "\r\n\r\n"을 놓치지 않도록 3바이트 겹쳐서 재개
+            headerScanPos = (in.size() > 3) ? in.size() - 3 : 0;
+            return false;
         }
-        else
+
+        // CHECK)
+        if (pos > MAX_HEADER_SIZE)
+        {
+            setError(ERROR_HEADER_TOO_LARGE);
             return false;
+        }
 
-        //if (pos == std::string::npos)
-            //return false;
+        parseHeaders(in.substr(0, pos));
+        if (error)
+            return false;
 
-        // 헤더 블록(첫 줄 + 헤더들)을 잘라서 파싱
-        //parseHeaders(rawBuffer.substr(0, pos));
-        //bodyStart = pos + 4;
-        //headersParsed = true;
+        in.erase(0, pos + 4);
+        consumedLength = pos + 4;
+        headersParsed = true;
     }
 
+    // 바디 정책이 정해질 때까지 바디 바이트는 in에 남겨 둔다
+    if (awaitingBodyPolicy())
+        return false;
+
     // 헤더 파싱이 끝난 이후에는 바디를 파싱
     if (!bodyParsed) {
-        if (!parseBody())
+        if (!parseBody(in))
             return false;
+        if (multipart)
+            multipart->finish();
     }
 
     return complete;
@@ -209,102 +228,225 @@ void HttpRequest::parseHeaders(const std::string& block) {
 
 /* ================= Body ================= */
 
-// Content-Length 또는 chunked 여부에 따라 body를 파싱
-bool HttpRequest::parseBody() {
-    if (chunked)
-        return parseChunkedBody();
+bool HttpRequest::hasBody() const {
+    return chunked || contentLength > 0;
+}
 
-    if (contentLength > 0) {
-        if (rawBuffer.size() < bodyStart + contentLength)
-            return false;
+bool HttpRequest::awaitingBodyPolicy() const {
+    return headersParsed && !bodyParsed && !error && !bodyPolicySet && hasBody();
+}
 
-        body = rawBuffer.substr(bodyStart, contentLength);
-        // CHECK)
-        consumedLength = bodyStart + contentLength;
-    }
-    // CHECK)
-    else
-        consumedLength = bodyStart;
+void HttpRequest::setBodyPolicy(size_t maxBody, size_t bufferSize) {
+    bodyPolicySet = true;
+    maxBodySize = maxBody;
+    bodyBufferSize = bufferSize;
 
-    bodyParsed = true;
-    complete = true;
-    return true;
+    // CHECK) 전체 요청 크기 제한: Content-Length만 보고 미리 판단 (바디를 받기 전에 413)
+    if (!chunked && contentLength > maxBodySize) {
+        setError(ERROR_REQUEST_TOO_LARGE);
+        return;
+    }
+    if (multipart)
+        return;
+    if (!chunked && contentLength > bodyBufferSize) {
+        if (!spoolBodyToFile())
+            setError(ERROR_BODY_STORAGE);
+    } else if (!chunked && contentLength > 0) {
+        body.reserve(contentLength);
+    }
 }
 
-/* ================= Chunked ================= */
-
-bool HttpRequest::parseChunkedBody() {
-    size_t pos = bodyStart;
+// 지금까지 메모리에 모은 바디를 임시 파일로 옮기고 이후 바이트는 파일에 바로 쓴다
+bool HttpRequest::spoolBodyToFile() {
+    char path[sizeof(BODY_TEMP_TEMPLATE)];
+    std::memcpy(path, BODY_TEMP_TEMPLATE, sizeof(BODY_TEMP_TEMPLATE));
+    int fd = ::mkstemp(path);
+    if (fd < 0)
+        return false;
+    ::unlink(path);
 
-    while (true) {
-        size_t crlf = rawBuffer.find("\r\n", pos);
-        if (crlf == std::string::npos)
+    size_t off = 0;
+    while (off < body.size()) {
+        ssize_t n = ::write(fd, body.data() + off, body.size() - off);
+        if (n <= 0) {
+            ::close(fd);
             return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    std::string().swap(body);
+    bodyFd = fd;
+    return true;
+}
 
-        std::string hexSize = rawBuffer.substr(pos, crlf - pos);
+void HttpRequest::streamMultipart(const std::string& boundary, const std::string& uploadDir) {
+    delete multipart;
+    multipart = new MultipartParser(boundary, uploadDir, chunked ? 0 : contentLength);
+}
 
-        // CHECK) 빈 size는 에러
-        if (hexSize.empty())
-        {
-            error = true;
+bool HttpRequest::appendBody(const char* data, size_t len) {
+    if (multipart) {
+        multipart->feed(data, len);
+        bodySize += len;
+        return true;
+    }
+    if (bodyFd == -1 && bodySize + len > bodyBufferSize) {
+        if (!spoolBodyToFile()) {
+            setError(ERROR_BODY_STORAGE);
             return false;
         }
-
-        // CHECK) 16진수 검사
-        for (size_t i = 0; i < hexSize.size(); ++i)
-        {
-            if (!std::isxdigit(hexSize[i]))
-            {
-                error = true;
+    }
+    if (bodyFd == -1) {
+        body.append(data, len);
+    } else {
+        // 일반 파일 write: 디스크가 가득 찬 경우 외에는 전부 써진다
+        size_t off = 0;
+        while (off < len) {
+            ssize_t n = ::write(bodyFd, data + off, len - off);
+            if (n <= 0) {
+                setError(ERROR_BODY_STORAGE);
                 return false;
             }
+            off += static_cast<size_t>(n);
         }
-        
-        // CEHCK) hex -> size_t 변환
-        std::istringstream  iss(hexSize);
-        size_t  chunkSize;
-        iss >> std::hex >> chunkSize;
+    }
+    bodySize += len;
+    return true;
+}
 
-        if (iss.fail())
-        {
-            error = true;
+// Content-Length 또는 chunked 여부에 따라 body를 파싱
+// 새로 들어온 바이트만 body로 옮기고 in에서 제거한다.
+bool HttpRequest::parseBody(std::string& in) {
+    if (chunked)
+        return parseChunkedBody(in);
+
+    if (bodySize < contentLength) {
+        size_t need = contentLength - bodySize;
+        size_t take = (in.size() < need) ? in.size() : need;
+        if (!appendBody(in.data(), take))
             return false;
-        }
+        if (take == in.size())
+            in.clear();
+        else
+            in.erase(0, take);
+        consumedLength += take;
+        if (bodySize < contentLength)
+            return false;
+    }
 
-        //size_t chunkSize = std::strtoul(hexSize.c_str(), NULL, 16);
+    bodyParsed = true;
+    complete = true;
+    return true;
+}
 
-        pos = crlf + 2;
+/* ================= Chunked ================= */
+
+// chunk 단위 상태 머신: 어느 위치에서 read가 끊겨도 다음 호출에서 이어서 진행
+bool HttpRequest::parseChunkedBody(std::string& in) {
+    size_t pos = 0;
+    bool done = false;
+
+    while (!done && !error) {
+        if (chunkState == CHUNK_SIZE) {
+            size_t crlf = in.find("\r\n", pos);
+            if (crlf == std::string::npos) {
+                // CHECK) size 줄이 비정상적으로 길면 에러
+                if (in.size() - pos > MAX_LINE_LENGTH)
+                    setError(ERROR_MALFORMED_CHUNKED);
+                break;
+            }
 
-        if (chunkSize == 0) {
-            // CHECK) 반드시 마지막 CRLF 존재해야 함
-            if (rawBuffer.size() < (pos + 2))
-                return false; // 아직 다 안 들어옴
+            std::string hexSize = in.substr(pos, crlf - pos);
 
-            if (rawBuffer.substr(pos, 2) != "\r\n")
+            // CHECK) 빈 size는 에러
+            if (hexSize.empty())
             {
-                error = true;
-                return false;
+                setError(ERROR_MALFORMED_CHUNKED);
+                break;
             }
 
-            consumedLength = pos + 2; // 마지막 CRLF 포함 (0\r\n 까지 읽은 위치 -> 하지만 chunked는 0\r\n\r\n으로 끝나므로 마지막 \r\n 2바이트를 더 포함)
-            bodyParsed = true;
-            complete = true;
-            return true;
-        }
+            // CHECK) 16진수 검사
+            for (size_t i = 0; i < hexSize.size(); ++i)
+            {
+                if (!std::isxdigit(static_cast<unsigned char>(hexSize[i])))
+                {
+                    setError(ERROR_MALFORMED_CHUNKED);
+                    break;
+                }
+            }
+            if (error)
+                break;
 
-        if (rawBuffer.size() < pos + chunkSize + 2)
-            return false;
+            // CEHCK) hex -> size_t 변환
+            std::istringstream  iss(hexSize);
+            size_t  chunkSize;
+            iss >> std::hex >> chunkSize;
 
-        // CHECK) chunk 데이터 뒤 CRLF 검사
-        if (rawBuffer.substr(pos + chunkSize, 2) != "\r\n")
-        {
-            error = true;
-            return false;
+            if (iss.fail())
+            {
+                setError(ERROR_MALFORMED_CHUNKED);
+                break;
+            }
+
+            pos = crlf + 2;
+            if (chunkSize == 0) {
+                chunkState = CHUNK_LAST_END;
+            } else {
+                // CHECK) 전체 요청 크기 제한
+                if (chunkSize > maxBodySize || bodySize + chunkSize > maxBodySize)
+                {
+                    setError(ERROR_REQUEST_TOO_LARGE);
+                    break;
+                }
+                chunkRemaining = chunkSize;
+                chunkState = CHUNK_DATA;
+            }
+        }
+        else if (chunkState == CHUNK_DATA) {
+            size_t avail = in.size() - pos;
+            if (avail == 0)
+                break;
+            size_t take = (avail < chunkRemaining) ? avail : chunkRemaining;
+            if (!appendBody(in.data() + pos, take))
+                break;
+            pos += take;
+            chunkRemaining -= take;
+            if (chunkRemaining == 0)
+                chunkState = CHUNK_DATA_END;
+        }
+        else {
+            // CHECK) chunk 데이터 뒤 / 마지막 chunk 뒤에는 반드시 CRLF
+            if (in.size() - pos < 2)
+                break; // 아직 다 안 들어옴
+            if (in[pos] != '\r' || in[pos + 1] != '\n')
+            {
+                setError(ERROR_MALFORMED_CHUNKED);
+                break;
+            }
+            pos += 2;
+            if (chunkState == CHUNK_LAST_END)
+                done = true;
+            else
+                chunkState = CHUNK_SIZE;
         }
-            
-        body.append(rawBuffer.substr(pos, chunkSize));
-        pos += chunkSize + 2; // skip data + CRLF
     }
+
+    if (error)
+        return false;
+
+    // 이번 호출에서 처리한 바이트만 제거
+    if (pos == in.size())
+        in.clear();
+    else if (pos > 0)
+        in.erase(0, pos);
+    consumedLength += pos;
+
+    if (!done)
+        return false;
+
+    bodyParsed = true;
+    complete = true;
+    return true;
 }
 
 /* ================= Utils ================= */
@@ -337,6 +479,10 @@ const std::string& HttpRequest::getURI() const { return uri; }
 const std::string& HttpRequest::getVersion() const { return version; }
 const std::map<std::string, std::string>& HttpRequest::getHeaders() const { return headers; }
 const std::string& HttpRequest::getBody() const { return body; }
+size_t HttpRequest::getBodySize() const { return bodySize; }
+bool HttpRequest::isBodyInFile() const { return bodyFd != -1; }
+int HttpRequest::getBodyFd() const { return bodyFd; }
+const MultipartParser* HttpRequest::getMultipart() const { return multipart; }
 size_t HttpRequest::getConsumedLength() const { return consumedLength; }
 
 HttpRequest::ErrorType HttpRequest::getErrorType() const { return errorType; }
@@ -350,6 +496,7 @@ std::string HttpRequest::getErrorMessage() const {
         case ERROR_INVALID_HEADER: return "invalid header";
         case ERROR_TIMEOUT: return "request timeout";
         case ERROR_MALFORMED_CHUNKED: return "malformed chunked body";
+        case ERROR_BODY_STORAGE: return "cannot store request body";
         case ERROR_NONE:
         default:
             return "";
@@ -363,12 +510,25 @@ bool HttpRequest::checkTimeout(int timeoutSeconds) const {
 }
 
 void HttpRequest::reset() {
-    rawBuffer.clear();
     method.clear();
     uri.clear();
     version.clear();
     headers.clear();
-    body.clear();
+    // 큰 업로드 후에는 버퍼 용량까지 반납 (keep-alive 연결이 메모리를 붙잡지 않도록)
+    if (body.capacity() > 64 * 1024)
+        std::string().swap(body);
+    else
+        body.clear();
+    bodySize = 0;
+    if (bodyFd != -1) {
+        ::close(bodyFd);
+        bodyFd = -1;
+    }
+    delete multipart;
+    multipart = NULL;
+    bodyPolicySet = false;
+    maxBodySize = MAX_REQUEST_SIZE;
+    bodyBufferSize = DEFAULT_BODY_BUFFER_SIZE;
     headersParsed = false;
     bodyParsed = false;
     complete = false;
@@ -376,7 +536,9 @@ void HttpRequest::reset() {
     errorType = ERROR_NONE;
     contentLength = 0;
     chunked = false;
-    bodyStart = 0;
+    headerScanPos = 0;
+    chunkState = CHUNK_SIZE;
+    chunkRemaining = 0;
     consumedLength = 0;
     lastActivityTime = std::time(NULL);
 }
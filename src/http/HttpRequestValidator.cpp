@@ -85,6 +85,8 @@ HttpParseResult	HttpRequestValidator::validate(const HttpRequest& request)
     if (request.hasError()) {
         if (request.getErrorType() == HttpRequest::ERROR_REQUEST_TOO_LARGE)
             return HttpParseResult(HttpParseResult::PARSE_ERROR, 413, 0);
+        if (request.getErrorType() == HttpRequest::ERROR_BODY_STORAGE)
+            return HttpParseResult(HttpParseResult::PARSE_ERROR, 500, 0);
         return HttpParseResult(HttpParseResult::PARSE_ERROR, 400, 0);
     }
 
@@ -92,6 +94,18 @@ HttpParseResult	HttpRequestValidator::validate(const HttpRequest& request)
     if (!request.isComplete())
         return HttpParseResult(HttpParseResult::PARSE_NEED_MORE, 0, 0);
 
+    HttpParseResult	headerResult = validateHeaders(request);
+    if (headerResult.getStatus() == HttpParseResult::PARSE_ERROR)
+        return headerResult;
+
+    // 모든 검사 통과
+    return HttpParseResult(HttpParseResult::PARSE_COMPLETE, 0, request.getConsumedLength()); // 여기에서 HttpRequest가 계산한 consumedLength를 result._consumedLength값에 반환/저장
+}
+
+/* 요청줄 + 헤더만으로 하는 검사 (3 ~ 7)
+	바디를 받기 전에도 호출: 업로드를 upload_store에 쓰기 시작하기 전에 거부할 요청을 거른다 */
+HttpParseResult	HttpRequestValidator::validateHeaders(const HttpRequest& request)
+{
     // 3) HTTP 버전 검사: HTTP/1.1이 아니면 505 HTTP Version Not Supported
     if (request.getVersion() != "HTTP/1.1")
         return HttpParseResult(HttpParseResult::PARSE_ERROR, 505, 0);
@@ -101,9 +115,9 @@ HttpParseResult	HttpRequestValidator::validate(const HttpRequest& request)
     if (headers.count("host") == 0) // key("host")가 map안에 존재하면 1, 없으면 0 반환 [HTTP/1.1은 반드시 Host 필요. 없으면 400 Bad Request], 헤더 이름을 강제로 소문자로 저장해서 "host"로 검사
         return HttpParseResult(HttpParseResult::PARSE_ERROR, 400, 0);
 
-    // 5) Method 검사 (필수 구현 3개)
+    // 5) Method 검사 (필수 구현 3개 + HEAD: GET과 같은 헤더, 바디 없음)
     std::string	method = request.getMethod();
-    if (method != "GET" && method != "POST" && method != "DELETE")
+    if (method != "GET" && method != "HEAD" && method != "POST" && method != "DELETE")
         return HttpParseResult(HttpParseResult::PARSE_ERROR, 501, 0); // 그외 메서드 501
     
     // POST인데 Content-Length도 없고 chunked도 아님 -> 411
@@ -124,7 +138,5 @@ HttpParseResult	HttpRequestValidator::validate(const HttpRequest& request)
 	if (teResult.getStatus() == HttpParseResult::PARSE_ERROR) // 501
     	return teResult;
 
-    // 모든 검사 통과
-    return HttpParseResult(HttpParseResult::PARSE_COMPLETE, 0, request.getConsumedLength()); // 여기에서 HttpRequest가 계산한 consumedLength를 result._consumedLength값에 반환/저장
-
+    return HttpParseResult(HttpParseResult::PARSE_COMPLETE, 0, 0);
 }
@@ -11,187 +11,391 @@
 /* ************************************************************************** */
 
 #include "HttpResponse.hpp"
-#include <sstream>
 #include <ctime>
+#include <cctype>
+#include <cstring>
+
+/* ================= Static helpers ================= */
+
+// 상태줄 전체를 상수로: 응답마다 숫자/문구를 조립하지 않는다
+static const char* statusLine(int code) {
+    switch (code) {
+        case 200: return "HTTP/1.1 200 OK\r\n";
+        case 201: return "HTTP/1.1 201 Created\r\n";
+        case 204: return "HTTP/1.1 204 No Content\r\n";
+        case 206: return "HTTP/1.1 206 Partial Content\r\n";
+        case 301: return "HTTP/1.1 301 Moved Permanently\r\n";
+        case 302: return "HTTP/1.1 302 Found\r\n";
+        case 304: return "HTTP/1.1 304 Not Modified\r\n";
+        case 307: return "HTTP/1.1 307 Temporary Redirect\r\n";
+        case 308: return "HTTP/1.1 308 Permanent Redirect\r\n";
+        case 400: return "HTTP/1.1 400 Bad Request\r\n";
+        case 401: return "HTTP/1.1 401 Unauthorized\r\n";
+        case 403: return "HTTP/1.1 403 Forbidden\r\n";
+        case 404: return "HTTP/1.1 404 Not Found\r\n";
+        case 405: return "HTTP/1.1 405 Method Not Allowed\r\n";
+        case 408: return "HTTP/1.1 408 Request Timeout\r\n";
+        case 409: return "HTTP/1.1 409 Conflict\r\n";
+        case 410: return "HTTP/1.1 410 Gone\r\n";
+        case 411: return "HTTP/1.1 411 Length Required\r\n";
+        case 412: return "HTTP/1.1 412 Precondition Failed\r\n";
+        case 413: return "HTTP/1.1 413 Payload Too Large\r\n";
+        case 414: return "HTTP/1.1 414 URI Too Long\r\n";
+        case 415: return "HTTP/1.1 415 Unsupported Media Type\r\n";
+        case 416: return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+        case 429: return "HTTP/1.1 429 Too Many Requests\r\n";
+        case 500: return "HTTP/1.1 500 Internal Server Error\r\n";
+        case 501: return "HTTP/1.1 501 Not Implemented\r\n";
+        case 502: return "HTTP/1.1 502 Bad Gateway\r\n";
+        case 503: return "HTTP/1.1 503 Service Unavailable\r\n";
+        case 504: return "HTTP/1.1 504 Gateway Timeout\r\n";
+        case 505: return "HTTP/1.1 505 HTTP Version Not Supported\r\n";
+        default:  return NULL;
+    }
+}
+
+static void appendNumber(std::string& out, unsigned long n) {
+    char buf[24];
+    size_t i = sizeof(buf);
+    do {
+        buf[--i] = static_cast<char>('0' + (n % 10));
+        n /= 10;
+    } while (n != 0);
+    out.append(buf + i, sizeof(buf) - i);
+}
+
+static void appendHex(std::string& out, unsigned long n) {
+    static const char digits[] = "0123456789abcdef";
+    char buf[24];
+    size_t i = sizeof(buf);
+    do {
+        buf[--i] = digits[n & 0xf];
+        n >>= 4;
+    } while (n != 0);
+    out.append(buf + i, sizeof(buf) - i);
+}
+
+static void appendField(std::string& out, const char* name, const std::string& value) {
+    out.append(name);
+    out.append(": ", 2);
+    out.append(value);
+    out.append("\r\n", 2);
+}
+
+static bool equalsIgnoreCase(const std::string& a, const char* b) {
+    size_t i = 0;
+    for (; i < a.size() && b[i]; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != b[i])
+            return false;
+    }
+    return i == a.size() && b[i] == '\0';
+}
+
+/* ================= HttpResponse ================= */
 
 HttpResponse::HttpResponse() 
     : statusCode(200),
-      statusMessage("OK"),
+      fileLength(0),
+      fileFd(-1),
+      declaredLength(0),
+      hasDeclaredLength(false),
       keepAlive(false),
+      connectionSet(false),
+      keepAliveTimeout(0),
+      keepAliveMax(0),
       chunked(false) {}
 
 void HttpResponse::setStatus(int code) {
     statusCode = code;
-    statusMessage = getStatusMessage(code);
 }
 
+// 전용 필드가 있는 헤더는 그쪽으로, 길이/전송 방식처럼 응답이 직접 계산하는 헤더는 무시
 void HttpResponse::setHeader(const std::string& key, const std::string& value) {
-    headers[key] = value;
+    if (equalsIgnoreCase(key, "content-type")) {
+        contentType = value;
+        return;
+    }
+    if (equalsIgnoreCase(key, "content-length") || equalsIgnoreCase(key, "transfer-encoding")
+        || equalsIgnoreCase(key, "connection") || equalsIgnoreCase(key, "keep-alive"))
+        return;
+
+    for (size_t i = 0; i < extraHeaders.size(); ++i) {
+        if (extraHeaders[i].first.size() == key.size()) {
+            bool same = true;
+            for (size_t k = 0; k < key.size() && same; ++k)
+                same = std::tolower(static_cast<unsigned char>(key[k]))
+                    == std::tolower(static_cast<unsigned char>(extraHeaders[i].first[k]));
+            if (same) {
+                extraHeaders[i].second = value;
+                return;
+            }
+        }
+    }
+    extraHeaders.push_back(HeaderField(key, value));
+}
+
+void HttpResponse::addHeader(const std::string& key, const std::string& value) {
+    if (getHeader(key).empty()) {
+        setHeader(key, value);
+        return;
+    }
+    extraHeaders.push_back(HeaderField(key, value));
+}
+
+std::string HttpResponse::getHeader(const std::string& key) const {
+    for (size_t i = 0; i < extraHeaders.size(); ++i) {
+        const std::string& name = extraHeaders[i].first;
+        if (name.size() != key.size())
+            continue;
+        bool same = true;
+        for (size_t k = 0; k < key.size() && same; ++k)
+            same = std::tolower(static_cast<unsigned char>(key[k]))
+                == std::tolower(static_cast<unsigned char>(name[k]));
+        if (same)
+            return extraHeaders[i].second;
+    }
+    return "";
+}
+
+const std::vector<std::pair<std::string, std::string> >& HttpResponse::getHeaders() const {
+    return extraHeaders;
 }
 
 void HttpResponse::setContentType(const std::string& type) {
-    headers["Content-Type"] = type;
+    contentType = type;
+}
+
+std::string HttpResponse::getContentType() const {
+    return contentType.empty() ? std::string("text/html; charset=utf-8") : contentType;
 }
 
 void HttpResponse::setBody(const std::string& b) {
     body = b;
-    
-    // chunked가 아니면 Content-Length 설정
-    if (!chunked) {
-        std::ostringstream oss;
-        oss << body.size();
-        headers["Content-Length"] = oss.str();
-    }
+    sharedBody = SharedBuffer();
+    filePath.clear();
+    fileLength = 0;
+    fileFd = -1;
+}
+
+void HttpResponse::setBody(const SharedBuffer& b) {
+    body.clear();
+    sharedBody = b;
+    filePath.clear();
+    fileLength = 0;
+    fileFd = -1;
+}
+
+bool HttpResponse::hasSharedBody() const { return !sharedBody.isNull(); }
+const SharedBuffer& HttpResponse::getSharedBody() const { return sharedBody; }
+
+void HttpResponse::takeBody(std::string& out) {
+    out.clear();
+    out.swap(body);
+}
+
+size_t HttpResponse::getBodySize() const {
+    return hasSharedBody() ? sharedBody.size() : body.size();
+}
+
+void HttpResponse::setFileBody(const std::string& path, size_t length) {
+    body.clear();
+    sharedBody = SharedBuffer();
+    filePath = path;
+    fileLength = length;
+    fileFd = -1;
+    fileSegments.clear();
+    fileSuffix.clear();
 }
 
+void HttpResponse::setFileBody(int fd, size_t length) {
+    body.clear();
+    sharedBody = SharedBuffer();
+    filePath.clear();
+    fileLength = length;
+    fileFd = fd;
+    fileSegments.clear();
+    fileSuffix.clear();
+}
+
+void HttpResponse::addFileSegment(const std::string& prefix, off_t offset, size_t length) {
+    FileSegment seg;
+    seg.prefix = prefix;
+    seg.offset = offset;
+    seg.length = length;
+    fileSegments.push_back(seg);
+}
+
+void HttpResponse::setFileSuffix(const std::string& suffix) { fileSuffix = suffix; }
+const std::vector<HttpResponse::FileSegment>& HttpResponse::getFileSegments() const { return fileSegments; }
+const std::string& HttpResponse::getFileSuffix() const { return fileSuffix; }
+
+bool HttpResponse::hasFileBody() const { return !filePath.empty() || fileFd != -1; }
+const std::string& HttpResponse::getFilePath() const { return filePath; }
+int HttpResponse::getFileFd() const { return fileFd; }
+size_t HttpResponse::getFileLength() const { return fileLength; }
+
 void HttpResponse::setKeepAlive(bool enable, int timeout, int max) {
     keepAlive = enable;
-    
-    if (enable) {
-        std::ostringstream oss;
-        oss << "timeout=" << timeout << ", max=" << max;
-        headers["Keep-Alive"] = oss.str();
-        headers["Connection"] = "keep-alive";
-    } else {
-        headers["Connection"] = "close";
-        headers.erase("Keep-Alive");
-    }
+    connectionSet = true;
+    keepAliveTimeout = timeout;
+    keepAliveMax = max;
 }
 
 void HttpResponse::setChunked(bool enable) {
     chunked = enable;
-    
-    if (enable) {
-        headers["Transfer-Encoding"] = "chunked";
-        headers.erase("Content-Length");
-    } else {
-        headers.erase("Transfer-Encoding");
-    }
 }
 
-std::string HttpResponse::getStatusMessage(int code) const {
-    switch (code) {
-        case 200: return "OK";
-        case 201: return "Created";
-        case 204: return "No Content";
-        case 301: return "Moved Permanently";
-        case 302: return "Found";
-        case 304: return "Not Modified";
-        case 307: return "Temporary Redirect";
-        case 308: return "Permanent Redirect";
-        case 400: return "Bad Request";
-        case 401: return "Unauthorized";
-        case 403: return "Forbidden";
-        case 404: return "Not Found";
-        case 405: return "Method Not Allowed";
-        case 408: return "Request Timeout";
-        case 409: return "Conflict";
-        case 410: return "Gone";
-        case 411: return "Length Required";
-        case 413: return "Payload Too Large";
-        case 414: return "URI Too Long";
-        case 415: return "Unsupported Media Type";
-        case 429: return "Too Many Requests";
-        case 500: return "Internal Server Error";
-        case 501: return "Not Implemented";
-        case 502: return "Bad Gateway";
-        case 503: return "Service Unavailable";
-        case 504: return "Gateway Timeout";
-        case 505: return "HTTP Version Not Supported";
-        default:  return "Unknown";
+void HttpResponse::setContentLength(size_t length) {
+    declaredLength = length;
+    hasDeclaredLength = true;
+}
+
+void HttpResponse::dropBody() {
+    if (!chunked)
+        setContentLength(contentLength());
+    std::string().swap(body);
+    sharedBody = SharedBuffer();
+    filePath.clear();
+    fileFd = -1;
+    fileLength = 0;
+    fileSegments.clear();
+    fileSuffix.clear();
+}
+
+size_t HttpResponse::contentLength() const {
+    if (hasDeclaredLength)
+        return declaredLength;
+    if (!hasFileBody())
+        return getBodySize();
+    if (fileSegments.empty())
+        return fileLength;
+    size_t total = fileSuffix.size();
+    for (size_t i = 0; i < fileSegments.size(); ++i)
+        total += fileSegments[i].prefix.size() + fileSegments[i].length;
+    return total;
+}
+
+bool HttpResponse::parseHttpDate(const std::string& value, time_t& out) {
+    static const char* const formats[] = {
+        "%a, %d %b %Y %H:%M:%S GMT",
+        "%A, %d-%b-%y %H:%M:%S GMT",
+        "%a %b %e %H:%M:%S %Y"
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+        struct tm tm;
+        std::memset(&tm, 0, sizeof(tm));
+        const char* end = strptime(value.c_str(), formats[i], &tm);
+        if (end != NULL && *end == '\0') {
+            out = timegm(&tm);
+            return out != static_cast<time_t>(-1);
+        }
     }
+    return false;
 }
 
-void HttpResponse::ensureHeaders() {
-    // Date 헤더 추가
-    if (headers.find("Date") == headers.end()) {
-        time_t now = time(NULL);
+// 같은 초 안에서는 마지막으로 만든 문자열을 그대로 쓴다
+const std::string& HttpResponse::currentDate() {
+    static std::string cached;
+    static time_t cachedAt = 0;
+
+    time_t now = time(NULL);
+    if (now != cachedAt || cached.empty()) {
+        char buf[64];
         struct tm* tm = gmtime(&now);
-        char buf[100];
         strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", tm);
-        headers["Date"] = std::string(buf);
+        cached = buf;
+        cachedAt = now;
     }
+    return cached;
+}
 
-    // Server 헤더 추가
-    if (headers.find("Server") == headers.end()) {
-        headers["Server"] = "webserv/1.0";
+void HttpResponse::appendHeaders(std::string& out) const {
+    // Status line
+    const char* line = statusLine(statusCode);
+    if (line) {
+        out.append(line);
+    } else {
+        out.append("HTTP/1.1 ", 9);
+        appendNumber(out, static_cast<unsigned long>(statusCode));
+        out.append(" Unknown\r\n", 10);
     }
 
-    // Content-Length 확인 (chunked가 아니고 body가 있으면)
-    if (!chunked && headers.find("Content-Length") == headers.end()) {
-        std::ostringstream oss;
-        oss << body.size();
-        headers["Content-Length"] = oss.str();
+    appendField(out, "Date", currentDate());
+    out.append("Server: webserv/1.0\r\n", 21);
+    // 304는 바디가 없다: Content-Type / Content-Length를 보내면 캐시된 표현의 값으로 오해된다
+    if (statusCode != 304) {
+        appendField(out, "Content-Type", contentType.empty() ? std::string("text/html; charset=utf-8")
+                                                             : contentType);
+        if (chunked) {
+            out.append("Transfer-Encoding: chunked\r\n", 28);
+        } else {
+            out.append("Content-Length: ", 16);
+            appendNumber(out, static_cast<unsigned long>(contentLength()));
+            out.append("\r\n", 2);
+        }
     }
 
-    // Content-Type 기본값
-    if (headers.find("Content-Type") == headers.end()) {
-        headers["Content-Type"] = "text/html; charset=utf-8";
+    for (size_t i = 0; i < extraHeaders.size(); ++i) {
+        out.append(extraHeaders[i].first);
+        out.append(": ", 2);
+        out.append(extraHeaders[i].second);
+        out.append("\r\n", 2);
     }
 
-    // Connection 기본값
-    if (headers.find("Connection") == headers.end()) {
-        headers["Connection"] = keepAlive ? "keep-alive" : "close";
+    if (keepAlive) {
+        out.append("Connection: keep-alive\r\n", 24);
+        if (connectionSet) {
+            out.append("Keep-Alive: timeout=", 20);
+            appendNumber(out, static_cast<unsigned long>(keepAliveTimeout));
+            out.append(", max=", 6);
+            appendNumber(out, static_cast<unsigned long>(keepAliveMax));
+            out.append("\r\n", 2);
+        }
+    } else {
+        out.append("Connection: close\r\n", 19);
     }
-}
 
-std::string HttpResponse::toString() {
-    ensureHeaders();
-
-    std::ostringstream oss;
-    
-    // Status line
-    oss << "HTTP/1.1 " << statusCode << " " << statusMessage << "\r\n";
+    // 헤더와 바디 사이 빈 줄
+    out.append("\r\n", 2);
+}
 
-    // Headers
-    for (std::map<std::string, std::string>::const_iterator it = headers.begin();
-         it != headers.end(); ++it) {
-        oss << it->first << ": " << it->second << "\r\n";
-    }
+std::string HttpResponse::toHeaderString() const {
+    std::string out;
+    out.reserve(256);
+    appendHeaders(out);
+    return out;
+}
 
-    // 헤더와 바디 사이 빈 줄
-    oss << "\r\n";
+std::string HttpResponse::toString() const {
+    std::string out = toHeaderString();
 
     // Body (chunked가 아닌 경우만)
-    if (!chunked) {
-        oss << body;
-    }
+    if (!chunked)
+        out += hasSharedBody() ? sharedBody.str() : body;
 
-    return oss.str();
+    return out;
 }
 
 // Chunked encoding을 위한 메서드
-std::string HttpResponse::toChunkedString() {
+std::string HttpResponse::toChunkedString() const {
     if (!chunked)
         return toString();
 
-    ensureHeaders();
-
-    std::ostringstream oss;
-    
-    // Status line
-    oss << "HTTP/1.1 " << statusCode << " " << statusMessage << "\r\n";
-
-    // Headers
-    for (std::map<std::string, std::string>::const_iterator it = headers.begin();
-         it != headers.end(); ++it) {
-        oss << it->first << ": " << it->second << "\r\n";
-    }
-
-    oss << "\r\n";
+    std::string out = toHeaderString();
+    const std::string& b = hasSharedBody() ? sharedBody.str() : body;
 
     // Body를 chunk로 전송
-    if (!body.empty()) {
-        std::ostringstream chunkSize;
-        chunkSize << std::hex << body.size();
-        oss << chunkSize.str() << "\r\n";
-        oss << body << "\r\n";
+    if (!b.empty()) {
+        appendHex(out, static_cast<unsigned long>(b.size()));
+        out.append("\r\n", 2);
+        out += b;
+        out.append("\r\n", 2);
     }
 
     // Last chunk (0)
-    oss << "0\r\n\r\n";
+    out.append("0\r\n\r\n", 5);
 
-    return oss.str();
+    return out;
 }
 
 bool HttpResponse::isKeepAlive() const {
@@ -0,0 +1,498 @@
+#include "MultipartParser.hpp"
+#include <sstream>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string trim(const std::string& s) {
+    size_t a = 0;
+    while (a < s.size() && std::isspace(static_cast<unsigned char>(s[a]))) a++;
+    size_t b = s.size();
+    while (b > a && std::isspace(static_cast<unsigned char>(s[b-1]))) b--;
+    return s.substr(a, b-a);
+}
+
+static std::string toLower(const std::string& s) {
+    std::string r;
+    for (size_t i=0;i<s.size();++i) r += static_cast<char>(std::tolower(static_cast<unsigned char>(s[i])));
+    return r;
+}
+
+// content-disposition 의 key="value" 추출
+static bool dispositionParam(const std::string& v, const std::string& key, std::string& out) {
+    size_t kpos = v.find(key);
+    if (kpos == std::string::npos)
+        return false;
+    size_t start = v.find('"', kpos);
+    size_t end = (start!=std::string::npos)? v.find('"', start+1) : std::string::npos;
+    if (start==std::string::npos || end==std::string::npos)
+        return false;
+    out = v.substr(start+1, end-start-1);
+    return true;
+}
+
+/* ---------------- 파일명 & 경로 보안 ---------------- */
+
+static std::string sanitizeFilename(const std::string& name) {
+    std::string safe;
+
+    for (size_t i = 0; i < name.size(); ++i) {
+        char c = name[i];
+
+        // 허용: 알파벳, 숫자, 점, 언더스코어, 하이픈
+        if (std::isalnum(static_cast<unsigned char>(c)) ||
+            c == '.' || c == '_' || c == '-') {
+            safe += c;
+        } else {
+            safe += '_'; // 특수문자는 언더스코어로 치환
+        }
+    }
+
+    // ".." 제거 (path traversal 방지)
+    size_t pos;
+    while ((pos = safe.find("..")) != std::string::npos) {
+        safe.erase(pos, 2);
+    }
+
+    // 앞뒤 공백/점 제거
+    while (!safe.empty() && (safe[0] == '.' || safe[0] == ' '))
+        safe.erase(0, 1);
+    while (!safe.empty() && (safe[safe.size()-1] == '.' || safe[safe.size()-1] == ' '))
+        safe.erase(safe.size()-1);
+
+    // 최대 길이 제한 (255자)
+    if (safe.size() > 255)
+        safe = safe.substr(0, 255);
+
+    return safe;
+}
+
+static std::string joinPath(const std::string& dir, const std::string& name) {
+    std::string path = dir;
+    if (path[path.size() - 1] != '/')
+        path += "/";
+    return path + name;
+}
+
+static std::string generateUniqueFilename(const std::string& dir, const std::string& name) {
+    // 파일이 없으면 그대로 사용
+    struct stat st;
+    if (stat(joinPath(dir, name).c_str(), &st) != 0)
+        return name;
+
+    // 중복이면 타임스탬프 추가
+    std::ostringstream oss;
+    oss << std::time(NULL) << "_" << name;
+    return oss.str();
+}
+
+static bool isPathSafe(const std::string& fullPath, const std::string& baseDir) {
+    // fullPath가 baseDir로 시작하는지 확인
+    if (fullPath.compare(0, baseDir.size(), baseDir) != 0)
+        return false;
+
+    // ".." 가 있으면 거부
+    if (fullPath.find("..") != std::string::npos)
+        return false;
+
+    return true;
+}
+
+/* ---------------- MultipartParser ---------------- */
+
+MultipartParser::MultipartParser(const std::string& boundary, const std::string& uploadDir,
+                                 size_t expectedLength)
+: _needle("\r\n--" + boundary), _uploadDir(uploadDir), _dirReady(false),
+  _expected(expectedLength),
+  _state(STATE_DATA), _carry("\r\n"), _inPart(false), _fileFd(-1), _allocated(0) {
+    // 바디 맨 앞의 첫 구분자도 같은 패턴으로 찾도록 "\r\n"을 앞에 붙인 것처럼 시작
+
+    const size_t m = _needle.size();
+    for (size_t i = 0; i < 256; ++i)
+        _skip[i] = m;
+    for (size_t i = 0; i + 1 < m; ++i)
+        _skip[static_cast<unsigned char>(_needle[i])] = m - 1 - i;
+
+    // 업로드 디렉토리 확인 및 생성
+    struct stat st;
+    if (!_uploadDir.empty()) {
+        if (stat(_uploadDir.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            _dirReady = true;
+        else
+            _dirReady = (mkdir(_uploadDir.c_str(), 0755) == 0);
+    }
+}
+
+MultipartParser::~MultipartParser() {
+    // 끝까지 받지 못한 요청 (연결 끊김 등): 반쯤 쓴 파일을 남기지 않는다
+    if (_state != STATE_DONE && _state != STATE_FAILED)
+        fail();
+}
+
+bool MultipartParser::boundaryFromContentType(const std::string& contentType, std::string& boundary) {
+    std::string lower = toLower(contentType);
+    if (lower.find("multipart/form-data") == std::string::npos)
+        return false;
+    size_t bpos = lower.find("boundary=");
+    if (bpos == std::string::npos)
+        return false;
+    std::string b = contentType.substr(bpos + 9);
+    size_t semi = b.find(';');
+    if (semi != std::string::npos && (b.empty() || b[0] != '"'))
+        b.erase(semi);
+    b = trim(b);
+    if (b.size() >= 2 && b[0] == '"') {
+        size_t close = b.find('"', 1);
+        if (close == std::string::npos)
+            return false;
+        b = b.substr(1, close - 1);
+    }
+    // RFC 2046: 1~70자
+    if (b.empty() || b.size() > 70)
+        return false;
+    boundary = b;
+    return true;
+}
+
+bool MultipartParser::isComplete() const { return _state == STATE_DONE; }
+bool MultipartParser::isMalformed() const { return _state == STATE_FAILED; }
+bool MultipartParser::uploadDirReady() const { return _dirReady; }
+const std::vector<MultipartParser::Part>& MultipartParser::parts() const { return _parts; }
+
+void MultipartParser::feed(const char* data, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        size_t n = 0;
+        switch (_state) {
+        case STATE_DATA:
+            n = feedData(data + pos, len - pos);
+            break;
+        case STATE_DELIMITER_TAIL:
+            n = feedDelimiterTail(data + pos, len - pos);
+            break;
+        case STATE_HEADERS:
+            n = feedHeaders(data + pos, len - pos);
+            break;
+        case STATE_DONE:        // 끝 구분자 뒤 epilogue는 버린다
+        case STATE_FAILED:
+            return;
+        }
+        pos += n;
+    }
+}
+
+void MultipartParser::finish() {
+    if (_state != STATE_DONE && _state != STATE_FAILED)
+        fail();
+}
+
+// Horspool: 패턴 마지막 글자에 맞춘 바이트로 이동 거리를 정한다
+size_t MultipartParser::search(const char* hay, size_t len) const {
+    const size_t m = _needle.size();
+    const char* needle = _needle.data();
+    size_t i = 0;
+    while (i + m <= len) {
+        unsigned char last = static_cast<unsigned char>(hay[i + m - 1]);
+        if (last == static_cast<unsigned char>(needle[m - 1])
+            && std::memcmp(hay + i, needle, m - 1) == 0)
+            return i;
+        i += _skip[last];
+    }
+    return std::string::npos;
+}
+
+// 구분자를 찾으면 그 앞까지 part 데이터로 넘기고 STATE_DELIMITER_TAIL로
+// 반환값: data에서 소비한 바이트 수
+size_t MultipartParser::feedData(const char* data, size_t len) {
+    const size_t m = _needle.size();
+
+    if (!_carry.empty()) {
+        // 이전 조각 꼬리(< m 바이트)에서 시작하는 구분자: 새 조각 앞 m-1 바이트만 붙여 보면 충분
+        size_t take = (len < m - 1) ? len : m - 1;
+        std::string edge = _carry;
+        edge.append(data, take);
+        size_t hit = search(edge.data(), edge.size());
+        if (hit != std::string::npos) {
+            size_t carried = _carry.size();
+            emit(edge.data(), hit);
+            _carry.clear();
+            endPart();
+            _state = STATE_DELIMITER_TAIL;
+            return hit + m - carried;
+        }
+        if (take == len) {
+            // 새 조각이 짧아 아직 판단 불가: 마지막 m-1 바이트만 남긴다
+            size_t keep = (edge.size() < m - 1) ? edge.size() : m - 1;
+            emit(edge.data(), edge.size() - keep);
+            _carry.assign(edge, edge.size() - keep, keep);
+            return len;
+        }
+        // 꼬리에서 시작하는 구분자는 없음
+        emit(_carry.data(), _carry.size());
+        _carry.clear();
+    }
+
+    size_t hit = search(data, len);
+    if (hit != std::string::npos) {
+        emit(data, hit);
+        endPart();
+        _state = STATE_DELIMITER_TAIL;
+        return hit + m;
+    }
+    size_t keep = (len < m - 1) ? len : m - 1;
+    emit(data, len - keep);
+    _carry.assign(data + len - keep, keep);
+    return len;
+}
+
+// 구분자 바로 뒤 2바이트: "--"면 마지막 구분자, "\r\n"이면 다음 part 헤더
+size_t MultipartParser::feedDelimiterTail(const char* data, size_t len) {
+    size_t take = 2 - _pending.size();
+    if (take > len)
+        take = len;
+    _pending.append(data, take);
+    if (_pending.size() < 2)
+        return take;
+
+    if (_pending == "--") {
+        _state = STATE_DONE;
+    } else if (_pending == "\r\n") {
+        _state = STATE_HEADERS;
+    } else {
+        fail();
+    }
+    _pending.clear();
+    return take;
+}
+
+// part 헤더 블록: 빈 줄까지 모은 뒤 한 번에 해석
+size_t MultipartParser::feedHeaders(const char* data, size_t len) {
+    size_t scanFrom = (_pending.size() > 3) ? _pending.size() - 3 : 0;
+    _pending.append(data, len);
+
+    // 헤더 없는 part: 구분자 바로 뒤가 빈 줄
+    size_t end;
+    size_t blockLen;
+    if (_pending.compare(0, 2, "\r\n") == 0) {
+        end = 2;
+        blockLen = 0;
+    } else {
+        size_t hit = _pending.find("\r\n\r\n", scanFrom);
+        if (hit == std::string::npos) {
+            if (_pending.size() > HEADER_BLOCK_MAX)
+                fail();
+            return len;
+        }
+        end = hit + 4;
+        blockLen = hit;
+    }
+
+    // 블록 뒤에 붙어 온 바이트는 데이터: 이번 조각에서 돌려준다
+    size_t consumed = len - (_pending.size() - end);
+    std::string block = _pending.substr(0, blockLen);
+    _pending.clear();
+    beginPart(block);
+    if (_state != STATE_FAILED)
+        _state = STATE_DATA;
+    return consumed;
+}
+
+void MultipartParser::beginPart(const std::string& headerBlock) {
+    Part part;
+
+    std::istringstream iss(headerBlock);
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (!line.empty() && line[line.size()-1] == '\r')
+            line.erase(line.size()-1);
+        size_t c = line.find(':');
+        if (c == std::string::npos) continue;
+
+        std::string k = toLower(trim(line.substr(0,c)));
+        if (k != "content-disposition")
+            continue;
+        std::string v = trim(line.substr(c+1));
+        // filename= 안에도 name= 이 들어 있으므로 " name=" / ";name=" 형태를 먼저 본다
+        size_t npos = v.find(" name=");
+        if (npos == std::string::npos) npos = v.find(";name=");
+        if (npos != std::string::npos)
+            dispositionParam(v.substr(npos), "name=", part.name);
+        else
+            dispositionParam(v, "name=", part.name);
+        dispositionParam(v, "filename=", part.filename);
+    }
+
+    _parts.push_back(part);
+    _inPart = true;
+    if (!_parts.back().filename.empty())
+        openPartFile(_parts.back());
+}
+
+// 파일 part: upload_store 안의 이름 없는 임시 파일에 쓰고, part가 끝나면 최종 이름으로 link
+// - 쓰는 중인 파일은 다른 요청(GET / autoindex)에 보이지 않는다
+// - Content-Length를 알면 남은 바디 크기만큼 미리 할당해 조각나지 않게 하고 끝에 실제 크기로 자른다
+void MultipartParser::openPartFile(Part& part) {
+    std::string safeName = sanitizeFilename(part.filename);
+    if (safeName.empty()) {
+        part.result = Part::INVALID_NAME;
+        return;
+    }
+    if (!_dirReady) {
+        part.result = Part::SAVE_FAILED;
+        return;
+    }
+
+    // Path traversal 최종 검증
+    if (!isPathSafe(joinPath(_uploadDir, safeName), _uploadDir)) {
+        part.result = Part::UNSAFE_PATH;
+        return;
+    }
+
+    if (!openTempFile()) {
+        part.result = Part::SAVE_FAILED;
+        return;
+    }
+    _fileName = safeName;
+    _allocated = 0;
+    part.result = Part::SAVED;
+}
+
+// part 파일을 end 바이트까지 쓰기 전에: 조각나지 않게 PREALLOC_STEP 앞까지 미리 잡는다
+// Content-Length (바디 전체)가 상한. 지원하지 않는 파일시스템이면 그냥 순서대로 늘어난다
+void MultipartParser::reserve(size_t end) {
+#ifdef __linux__
+    if (end <= _allocated || _expected == 0)
+        return;
+    size_t target = end + PREALLOC_STEP;
+    if (target > _expected)
+        target = _expected;
+    if (target <= _allocated)
+        return;
+    if (::fallocate(_fileFd, 0, static_cast<off_t>(_allocated),
+                    static_cast<off_t>(target - _allocated)) == 0)
+        _allocated = target;
+    else
+        _expected = 0;      // 다시 시도하지 않음
+#else
+    (void)end;
+#endif
+}
+
+bool MultipartParser::openTempFile() {
+#ifdef O_TMPFILE
+    _fileFd = ::open(_uploadDir.c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0644);
+    if (_fileFd != -1) {
+        _tempPath.clear();
+        return true;
+    }
+#endif
+    // O_TMPFILE을 지원하지 않는 커널 / 파일시스템: 숨김 임시 파일
+    std::string path = joinPath(_uploadDir, ".upload_XXXXXX");
+    std::vector<char> buf(path.begin(), path.end());
+    buf.push_back('\0');
+    _fileFd = ::mkstemp(&buf[0]);
+    if (_fileFd == -1)
+        return false;
+    ::fchmod(_fileFd, 0644);
+    ::fcntl(_fileFd, F_SETFD, FD_CLOEXEC);
+    _tempPath = &buf[0];
+    return true;
+}
+
+// 완성된 임시 파일을 겹치지 않는 이름으로 연결: 이미 있는 파일은 절대 덮어쓰지 않는다
+bool MultipartParser::linkTempFile(std::string& savedName) {
+    std::string name = generateUniqueFilename(_uploadDir, _fileName);
+    for (int attempt = 1; attempt <= 16; ++attempt) {
+        std::string dst = joinPath(_uploadDir, name);
+        int rc;
+        if (_tempPath.empty()) {
+            std::ostringstream src;
+            src << "/proc/self/fd/" << _fileFd;
+            rc = ::linkat(AT_FDCWD, src.str().c_str(), AT_FDCWD, dst.c_str(), AT_SYMLINK_FOLLOW);
+        } else {
+            rc = ::link(_tempPath.c_str(), dst.c_str());
+        }
+        if (rc == 0) {
+            savedName = name;
+            return true;
+        }
+        if (errno != EEXIST)
+            return false;
+        // 동시에 같은 이름으로 올라온 업로드: 번호를 붙여 다시
+        std::ostringstream oss;
+        oss << std::time(NULL) << "_" << attempt << "_" << _fileName;
+        name = oss.str();
+    }
+    return false;
+}
+
+void MultipartParser::emit(const char* data, size_t len) {
+    if (!_inPart || len == 0)
+        return;
+    Part& part = _parts.back();
+    part.size += len;
+
+    if (part.filename.empty()) {
+        if (part.value.size() < FIELD_PREVIEW_MAX) {
+            size_t room = FIELD_PREVIEW_MAX - part.value.size();
+            part.value.append(data, (len < room) ? len : room);
+        }
+        return;
+    }
+    if (_fileFd == -1)
+        return;
+
+    reserve(part.size);
+    // 일반 파일 write: 디스크가 가득 찬 경우 외에는 전부 써진다
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = ::write(_fileFd, data + off, len - off);
+        if (n <= 0) {
+            closePartFile(false);
+            part.result = Part::SAVE_FAILED;
+            return;
+        }
+        off += static_cast<size_t>(n);
+    }
+}
+
+// commit: 실제 크기로 자르고 최종 이름으로 link. 아니면 임시 파일만 버린다
+void MultipartParser::closePartFile(bool commit) {
+    if (_fileFd == -1)
+        return;
+    Part& part = _parts.back();
+    if (commit) {
+        bool ok = true;
+        if (_allocated > part.size)
+            ok = (::ftruncate(_fileFd, static_cast<off_t>(part.size)) == 0);
+        if (!ok || !linkTempFile(part.savedName))
+            part.result = Part::SAVE_FAILED;
+    }
+    ::close(_fileFd);
+    _fileFd = -1;
+    if (!_tempPath.empty()) {
+        ::unlink(_tempPath.c_str());
+        _tempPath.clear();
+    }
+}
+
+void MultipartParser::endPart() {
+    closePartFile(true);
+    _inPart = false;
+}
+
+// 형식 오류 / 불완전한 바디: 이 요청으로 만든 파일은 모두 지운다
+void MultipartParser::fail() {
+    closePartFile(false);
+    _inPart = false;
+    for (size_t i = 0; i < _parts.size(); ++i) {
+        if (_parts[i].result == Part::SAVED && !_parts[i].savedName.empty())
+            ::unlink(joinPath(_uploadDir, _parts[i].savedName).c_str());
+    }
+    _state = STATE_FAILED;
+}
@@ -11,14 +11,30 @@
 /* ************************************************************************** */
 
 #include "PostHandler.hpp"
+#include "MultipartParser.hpp"
 #include <sstream>
-#include <fstream>
 #include <cstdlib>
 #include <cctype>
-#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <unistd.h>
-#include <ctime>
+
+// urlencoded 바디 한도: 키 / 값을 전부 메모리에 풀어 두므로 client_max_body_size와 별도로 제한
+// (이보다 큰 폼은 multipart로 보내야 한다)
+static const size_t URLENCODED_BODY_MAX = 1024 * 1024;
+
+// 임시 파일로 받은 바디를 메모리로 읽어 온다 (URLENCODED_BODY_MAX 이하 urlencoded 바디 전용)
+static bool readSpooledBody(const HttpRequest& request, std::string& out) {
+    out.resize(request.getBodySize());
+    size_t off = 0;
+    while (off < out.size()) {
+        ssize_t n = ::pread(request.getBodyFd(), &out[off], out.size() - off, off);
+        if (n <= 0)
+            return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
 
 POSTHandler::POSTHandler(size_t maxBodySizeBytes) : maxBodySize(maxBodySizeBytes) {}
 
@@ -40,17 +56,12 @@ HttpResponse POSTHandler::handle(const HttpRequest& request,
 
     // multipart/form-data; boundary=----WebKitFormBoundary...
     if (lower.find("multipart/form-data") != std::string::npos) {
-        size_t bpos = lower.find("boundary=");
-        if (bpos == std::string::npos) {
+        std::string boundary;
+        if (!MultipartParser::boundaryFromContentType(ct, boundary)) {
             res.setStatus(400);
             res.setBody("<h1>400 Bad Request</h1>");
             return res;
         }
-        std::string boundary = ct.substr(bpos + 9);
-        boundary = trim(boundary);
-        if (boundary.size() >= 2 && boundary[0] == '"' && boundary[boundary.size()-1] == '"')
-            boundary = boundary.substr(1, boundary.size()-2);
-
         return handleMultipart(request, location, boundary);
     }
 
@@ -59,16 +70,19 @@ HttpResponse POSTHandler::handle(const HttpRequest& request,
         return handleFormUrlEncoded(request, location);
     }
 
-    // 그 외: raw body
+    // 그 외: raw body (임시 파일에 있으면 그 파일을 그대로 응답 바디로)
     res.setStatus(200);
     res.setContentType("text/plain");
-    res.setBody(request.getBody());
+    if (request.isBodyInFile())
+        res.setFileBody(request.getBodyFd(), request.getBodySize());
+    else
+        res.setBody(request.getBody());
     return res;
 }
 
 bool POSTHandler::checkBodySize(const HttpRequest& request, HttpResponse& res) const {
     if (maxBodySize == 0) return true;
-    if (request.getBody().size() > maxBodySize) {
+    if (request.getBodySize() > maxBodySize) {
         res.setStatus(413);
         res.setBody("<h1>413 Payload Too Large</h1>");
         return false;
@@ -83,7 +97,20 @@ HttpResponse POSTHandler::handleFormUrlEncoded(const HttpRequest& request,
     (void)location;
     HttpResponse res;
 
-    std::map<std::string,std::string> kv = parseUrlEncoded(request.getBody());
+    if (request.getBodySize() > URLENCODED_BODY_MAX) {
+        res.setStatus(413);
+        res.setBody("<h1>413 Payload Too Large</h1>");
+        return res;
+    }
+
+    std::string spooled;
+    if (request.isBodyInFile() && !readSpooledBody(request, spooled)) {
+        res.setStatus(500);
+        res.setBody("<h1>500 Internal Server Error</h1>");
+        return res;
+    }
+    std::map<std::string,std::string> kv =
+        parseUrlEncoded(request.isBodyInFile() ? spooled : request.getBody());
 
     std::ostringstream oss;
     oss << "Parsed x-www-form-urlencoded:\n";
@@ -142,267 +169,96 @@ HttpResponse POSTHandler::handleMultipart(const HttpRequest& request,
         return res;
     }
 
-    std::vector< std::map<std::string,std::string> > parts;
-    if (!parseMultipart(request.getBody(), boundary, parts)) {
+    // 보통은 바디를 받는 동안 이미 파싱/저장이 끝나 있다 (Server가 streamMultipart 호출)
+    const MultipartParser* streamed = request.getMultipart();
+    if (streamed != NULL)
+        return buildMultipartResponse(*streamed, location);
+
+    // 스트리밍 없이 모인 바디: 같은 파서에 한 번에 넘긴다
+    // 임시 파일에 있는 바디는 mmap: 페이지 캐시를 그대로 읽고 힙에 올리지 않는다
+    const char* body = request.getBody().data();
+    size_t bodyLen = request.getBodySize();
+    void* mapped = MAP_FAILED;
+    if (request.isBodyInFile() && bodyLen > 0) {
+        mapped = ::mmap(NULL, bodyLen, PROT_READ, MAP_PRIVATE, request.getBodyFd(), 0);
+        if (mapped == MAP_FAILED) {
+            res.setStatus(500);
+            res.setBody("<h1>500 Internal Server Error</h1>");
+            return res;
+        }
+        body = static_cast<const char*>(mapped);
+    }
+    MultipartParser parser(boundary, location.getUploadStore(), bodyLen);
+    parser.feed(body, bodyLen);
+    parser.finish();
+    if (mapped != MAP_FAILED)
+        ::munmap(mapped, bodyLen);
+    return buildMultipartResponse(parser, location);
+}
+
+HttpResponse POSTHandler::buildMultipartResponse(const MultipartParser& parser,
+                                                 const LocationConfig& location) const {
+    HttpResponse res;
+
+    if (parser.isMalformed()) {
         res.setStatus(400);
         res.setBody("<h1>400 Bad Request</h1><p>Malformed multipart</p>");
         return res;
     }
 
-    // 업로드 디렉토리 확인 및 생성
-    std::string uploadDir = location.getUploadStore();
-    if (uploadDir.empty()) {
+    // 업로드 디렉토리 확인 (파서가 생성까지 시도함)
+    if (location.getUploadStore().empty()) {
         res.setStatus(500);
         res.setBody("<h1>500 Internal Server Error</h1><p>Upload directory not configured</p>");
         return res;
     }
-
-    // 디렉토리 존재 확인
-    struct stat st;
-    if (stat(uploadDir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
-        // 디렉토리 생성 시도
-        if (mkdir(uploadDir.c_str(), 0755) != 0) {
-            res.setStatus(500);
-            res.setBody("<h1>500 Internal Server Error</h1><p>Cannot create upload directory</p>");
-            return res;
-        }
+    if (!parser.uploadDirReady()) {
+        res.setStatus(500);
+        res.setBody("<h1>500 Internal Server Error</h1><p>Cannot create upload directory</p>");
+        return res;
     }
 
     std::ostringstream result;
     int filesUploaded = 0;
 
-    // parts 순회하며 파일 저장
+    const std::vector<MultipartParser::Part>& parts = parser.parts();
     for (size_t i = 0; i < parts.size(); ++i) {
-        std::map<std::string,std::string>& part = parts[i];
-        
-        // filename이 있으면 파일 part
-        if (part.count("filename") && !part["filename"].empty()) {
-            std::string originalName = part["filename"];
-            std::string safeName = sanitizeFilename(originalName);
-            
-            if (safeName.empty()) {
-                result << "Skipped invalid filename: " << originalName << "\n";
-                continue;
-            }
-
-            // 중복 방지를 위해 타임스탬프 추가
-            std::string finalName = generateUniqueFilename(uploadDir, safeName);
-            std::string fullPath = uploadDir;
-            if (fullPath[fullPath.size() - 1] != '/')
-                fullPath += "/";
-            fullPath += finalName;
-
-            // Path traversal 최종 검증
-            if (!isPathSafe(fullPath, uploadDir)) {
-                result << "Rejected unsafe path: " << originalName << "\n";
-                continue;
-            }
-
-            // 파일 저장
-            if (saveFile(fullPath, part["data"])) {
-                result << "Uploaded: " << finalName << " (" << part["data"].size() << " bytes)\n";
-                filesUploaded++;
-            } else {
-                result << "Failed to save: " << originalName << "\n";
-            }
-        } else {
+        const MultipartParser::Part& part = parts[i];
+
+        switch (part.result) {
+        case MultipartParser::Part::SAVED:
+            result << "Uploaded: " << part.savedName << " (" << part.size << " bytes)\n";
+            filesUploaded++;
+            break;
+        case MultipartParser::Part::SAVE_FAILED:
+            result << "Failed to save: " << part.filename << "\n";
+            break;
+        case MultipartParser::Part::INVALID_NAME:
+            result << "Skipped invalid filename: " << part.filename << "\n";
+            break;
+        case MultipartParser::Part::UNSAFE_PATH:
+            result << "Rejected unsafe path: " << part.filename << "\n";
+            break;
+        case MultipartParser::Part::FIELD:
             // 일반 필드
-            if (part.count("name")) {
-                result << "Field '" << part["name"] << "': ";
-                result << part["data"].substr(0, 100);
-                if (part["data"].size() > 100) result << "...";
+            if (!part.name.empty()) {
+                result << "Field '" << part.name << "': ";
+                result << part.value.substr(0, 100);
+                if (part.size > 100) result << "...";
                 result << "\n";
             }
+            break;
         }
     }
 
-    if (filesUploaded > 0) {
-        res.setStatus(201); // Created
-        res.setContentType("text/plain");
-        res.setBody(result.str());
-    } else {
-        res.setStatus(200);
-        res.setContentType("text/plain");
-        res.setBody(result.str());
-    }
-
+    res.setStatus(filesUploaded > 0 ? 201 : 200); // 201 Created
+    res.setContentType("text/plain");
+    res.setBody(result.str());
     return res;
 }
 
-/* ---------------- 파일 저장 & 보안 ---------------- */
-
-bool POSTHandler::saveFile(const std::string& path, const std::string& data) const {
-    std::ofstream ofs(path.c_str(), std::ios::binary);
-    if (!ofs.is_open())
-        return false;
-    
-    ofs.write(data.c_str(), data.size());
-    ofs.close();
-    
-    return ofs.good();
-}
-
-std::string POSTHandler::sanitizeFilename(const std::string& name) const {
-    std::string safe;
-    
-    for (size_t i = 0; i < name.size(); ++i) {
-        char c = name[i];
-        
-        // 허용: 알파벳, 숫자, 점, 언더스코어, 하이픈
-        if (std::isalnum(static_cast<unsigned char>(c)) || 
-            c == '.' || c == '_' || c == '-') {
-            safe += c;
-        } else {
-            safe += '_'; // 특수문자는 언더스코어로 치환
-        }
-    }
-    
-    // ".." 제거 (path traversal 방지)
-    size_t pos;
-    while ((pos = safe.find("..")) != std::string::npos) {
-        safe.erase(pos, 2);
-    }
-    
-    // 앞뒤 공백/점 제거
-    while (!safe.empty() && (safe[0] == '.' || safe[0] == ' '))
-        safe.erase(0, 1);
-    while (!safe.empty() && (safe[safe.size()-1] == '.' || safe[safe.size()-1] == ' '))
-        safe.erase(safe.size()-1);
-    
-    // 최대 길이 제한 (255자)
-    if (safe.size() > 255)
-        safe = safe.substr(0, 255);
-    
-    return safe;
-}
-
-std::string POSTHandler::generateUniqueFilename(const std::string& dir,
-                                               const std::string& name) const {
-    std::string testPath = dir;
-    if (testPath[testPath.size() - 1] != '/')
-        testPath += "/";
-    testPath += name;
-    
-    // 파일이 없으면 그대로 사용
-    struct stat st;
-    if (stat(testPath.c_str(), &st) != 0)
-        return name;
-    
-    // 중복이면 타임스탬프 추가
-    std::ostringstream oss;
-    oss << std::time(NULL) << "_" << name;
-    return oss.str();
-}
-
-bool POSTHandler::isPathSafe(const std::string& fullPath,
-                             const std::string& baseDir) const {
-    // Canonical path 비교를 통한 검증
-    // 실제로는 realpath() 사용이 더 안전하지만 C++98 제약으로 간단히 구현
-    
-    // fullPath가 baseDir로 시작하는지 확인
-    if (fullPath.compare(0, baseDir.size(), baseDir) != 0)
-        return false;
-    
-    // ".." 가 있으면 거부
-    if (fullPath.find("..") != std::string::npos)
-        return false;
-    
-    return true;
-}
-
-/* ---------------- multipart 파싱 ---------------- */
-
-bool POSTHandler::parseMultipart(const std::string& body,
-                                 const std::string& boundary,
-                                 std::vector< std::map<std::string,std::string> >& parts) const {
-    std::string delim = "--" + boundary;
-    std::string close = "--" + boundary + "--";
-
-    size_t pos = 0;
-
-    size_t first = body.find(delim, pos);
-    if (first == std::string::npos) return false;
-    pos = first;
-
-    while (true) {
-        if (body.compare(pos, close.size(), close) == 0)
-            return true;
-
-        if (body.compare(pos, delim.size(), delim) != 0)
-            return false;
-
-        pos += delim.size();
-
-        if (pos + 2 > body.size() || body.substr(pos, 2) != "\r\n")
-            return false;
-        pos += 2;
-
-        size_t hdrEnd = body.find("\r\n\r\n", pos);
-        if (hdrEnd == std::string::npos) return false;
-
-        std::string hdrBlock = body.substr(pos, hdrEnd - pos);
-        pos = hdrEnd + 4;
-
-        size_t next = body.find("\r\n" + delim, pos);
-        if (next == std::string::npos) {
-            next = body.find("\r\n" + close, pos);
-            if (next == std::string::npos) return false;
-        }
-
-        std::string data = body.substr(pos, next - pos);
-        pos = next + 2;
-
-        std::map<std::string,std::string> part;
-        part["data"] = data;
-
-        std::istringstream iss(hdrBlock);
-        std::string line;
-        while (std::getline(iss, line)) {
-            if (!line.empty() && line[line.size()-1] == '\r')
-                line.erase(line.size()-1);
-            size_t c = line.find(':');
-            if (c == std::string::npos) continue;
-
-            std::string k = toLower(trim(line.substr(0,c)));
-            std::string v = trim(line.substr(c+1));
-            part[k] = v;
-
-            if (k == "content-disposition") {
-                part["disposition"] = v;
-                size_t npos = v.find("name=");
-                if (npos != std::string::npos) {
-                    size_t start = v.find('"', npos);
-                    size_t end = (start!=std::string::npos)? v.find('"', start+1) : std::string::npos;
-                    if (start!=std::string::npos && end!=std::string::npos)
-                        part["name"] = v.substr(start+1, end-start-1);
-                }
-                size_t fpos = v.find("filename=");
-                if (fpos != std::string::npos) {
-                    size_t start = v.find('"', fpos);
-                    size_t end = (start!=std::string::npos)? v.find('"', start+1) : std::string::npos;
-                    if (start!=std::string::npos && end!=std::string::npos)
-                        part["filename"] = v.substr(start+1, end-start-1);
-                }
-            }
-        }
-
-        parts.push_back(part);
-
-        if (body.compare(pos, close.size(), close) == 0)
-            return true;
-    }
-}
-
 /* ---------------- utils ---------------- */
 
-std::string POSTHandler::trim(const std::string& s) const {
-    size_t a = 0;
-    while (a < s.size() && std::isspace(static_cast<unsigned char>(s[a]))) a++;
-    size_t b = s.size();
-    while (b > a && std::isspace(static_cast<unsigned char>(s[b-1]))) b--;
-    return s.substr(a, b-a);
-}
-
 std::string POSTHandler::toLower(const std::string& s) const {
     std::string r;
     for (size_t i=0;i<s.size();++i) r += static_cast<char>(std::tolower(static_cast<unsigned char>(s[i])));
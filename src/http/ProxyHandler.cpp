@@ -0,0 +1,365 @@
+#include "ProxyHandler.hpp"
+#include "HttpRequest.hpp"
+#include "LocationConfig.hpp"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <strings.h>
+
+// upstream 응답 헤더 전체 / chunk 크기 줄 하나의 한도
+static const size_t PROXY_HEADER_MAX = 64 * 1024;
+static const size_t PROXY_LINE_MAX = 8 * 1024;
+
+// 헤더 끝 (빈 줄 다음) 위치. "\n\n"만 쓰는 upstream도 받아 준다
+static size_t findHeadEnd(const std::string& buf) {
+    size_t crlf = buf.find("\r\n\r\n");
+    size_t lf = buf.find("\n\n");
+    if (crlf != std::string::npos && (lf == std::string::npos || crlf < lf))
+        return crlf + 4;
+    if (lf != std::string::npos)
+        return lf + 2;
+    return std::string::npos;
+}
+
+static std::string trim(const std::string& s) {
+    size_t a = 0;
+    size_t b = s.size();
+    while (a < b && std::isspace(static_cast<unsigned char>(s[a]))) a++;
+    while (b > a && std::isspace(static_cast<unsigned char>(s[b - 1]))) b--;
+    return s.substr(a, b - a);
+}
+
+// 쉼표로 나뉜 토큰 목록에 token이 있는지 (대소문자 무시)
+static bool hasToken(const std::string& list, const char* token) {
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+            comma = list.size();
+        if (strcasecmp(trim(list.substr(pos, comma - pos)).c_str(), token) == 0)
+            return true;
+        pos = comma + 1;
+    }
+    return false;
+}
+
+// 요청 헤더는 소문자로 저장되어 있으므로 보낼 때 "Content-Type" 형태로 되돌린다
+static std::string canonicalName(const std::string& name) {
+    std::string out(name);
+    bool upper = true;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (upper)
+            out[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(out[i])));
+        upper = (out[i] == '-');
+    }
+    return out;
+}
+
+ProxyHandler::ProxyHandler() {
+    reset(false);
+}
+
+bool ProxyHandler::isHopByHop(const std::string& name) {
+    static const char* names[] = {
+        "connection", "keep-alive", "proxy-connection", "te", "trailer",
+        "transfer-encoding", "upgrade", NULL
+    };
+    for (size_t i = 0; names[i]; ++i) {
+        if (strcasecmp(name.c_str(), names[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool ProxyHandler::passResponseHeader(const std::string& name) {
+    return !isHopByHop(name) && strcasecmp(name.c_str(), "date") != 0
+        && strcasecmp(name.c_str(), "server") != 0;
+}
+
+void ProxyHandler::buildRequestHead(const HttpRequest& request, const LocationConfig& location,
+                                    std::string& out) {
+    // proxy_pass에 URI가 있으면 location 경로 부분을 그 URI로 바꾼다 (nginx와 같은 규칙)
+    std::string uri = request.getURI();
+    if (!location.getProxyPassUri().empty()) {
+        size_t prefix = location.getPath().size();
+        uri = location.getProxyPassUri() + (prefix < uri.size() ? uri.substr(prefix) : std::string());
+    }
+
+    out.append(request.getMethod());
+    out.append(" ", 1);
+    out.append(uri);
+    out.append(" HTTP/1.1\r\n", 11);
+
+    // 기본 포트면 Host에 붙이지 않는다
+    std::string host = location.getProxyPass();
+    if (host.size() > 3 && host.compare(host.size() - 3, 3, ":80") == 0)
+        host.erase(host.size() - 3);
+    out.append("Host: " + host + "\r\n");
+    out.append("Connection: keep-alive\r\n", 24);
+
+    const std::map<std::string, std::string>& headers = request.getHeaders();
+    std::map<std::string, std::string>::const_iterator connIt = headers.find("connection");
+    for (std::map<std::string, std::string>::const_iterator it = headers.begin();
+         it != headers.end(); ++it) {
+        // 길이는 아래에서 다시 쓰고, Expect는 이미 클라이언트 쪽에서 처리됨
+        if (it->first == "host" || it->first == "content-length" || it->first == "expect"
+            || isHopByHop(it->first))
+            continue;
+        // Connection에 나열된 헤더도 이 연결에만 해당
+        if (connIt != headers.end() && hasToken(connIt->second, it->first.c_str()))
+            continue;
+        out.append(canonicalName(it->first));
+        out.append(": ", 2);
+        out.append(it->second);
+        out.append("\r\n", 2);
+    }
+    std::map<std::string, std::string>::const_iterator hostIt = headers.find("host");
+    if (hostIt != headers.end())
+        out.append("X-Forwarded-Host: " + hostIt->second + "\r\n");
+    out.append("X-Forwarded-Proto: http\r\n", 25);
+
+    if (request.getBodySize() > 0 || request.getMethod() == "POST") {
+        char len[32];
+        std::snprintf(len, sizeof(len), "%lu", static_cast<unsigned long>(request.getBodySize()));
+        out.append("Content-Length: ");
+        out.append(len);
+        out.append("\r\n", 2);
+    }
+    out.append("\r\n", 2);
+}
+
+void ProxyHandler::reset(bool headRequest) {
+    _state = HEAD;
+    _headRequest = headRequest;
+    _head.clear();
+    _status = 0;
+    _headers.clear();
+    _keepAlive = false;
+    _hasLength = false;
+    _length = 0;
+    _framing = FRAME_NONE;
+    _chunkState = CHUNK_SIZE;
+    _remaining = 0;
+    _excess = false;
+}
+
+ProxyHandler::State ProxyHandler::feed(const char* data, size_t len, std::string& body) {
+    if (_state == DONE) {
+        if (len > 0)
+            _excess = true;
+        return _state;
+    }
+    if (_state == FAILED)
+        return _state;
+    if (_state == BODY) {
+        feedBody(data, len, body);
+        return _state;
+    }
+
+    _head.append(data, len);
+    while (_state == HEAD) {
+        size_t end = findHeadEnd(_head);
+        if (end == std::string::npos) {
+            if (_head.size() > PROXY_HEADER_MAX)
+                _state = FAILED;
+            return _state;
+        }
+        if (!parseHead(end)) {
+            _state = FAILED;
+            return _state;
+        }
+        std::string rest = _head.substr(end);
+        _head.clear();
+
+        // 100 Continue 같은 중간 응답은 버리고 다음 응답을 기다린다
+        if (_status < 200) {
+            _head.swap(rest);
+            continue;
+        }
+        if (_framing == FRAME_NONE || (_framing == FRAME_LENGTH && _length == 0)) {
+            _state = DONE;
+            _excess = !rest.empty();
+            return _state;
+        }
+        _state = BODY;
+        _remaining = _length;
+        feedBody(rest.data(), rest.size(), body);
+    }
+    return _state;
+}
+
+ProxyHandler::State ProxyHandler::closed() {
+    if (_state == BODY && _framing == FRAME_CLOSE)
+        _state = DONE;
+    else if (_state != DONE)
+        _state = FAILED;
+    return _state;
+}
+
+bool ProxyHandler::parseHead(size_t headerEnd) {
+    size_t pos = 0;
+    bool first = true;
+    bool transferEncoding = false;
+    bool chunked = false;
+
+    _headers.clear();
+    _hasLength = false;
+    _length = 0;
+    while (pos < headerEnd) {
+        size_t nl = _head.find('\n', pos);
+        if (nl == std::string::npos || nl >= headerEnd)
+            nl = headerEnd;
+        std::string line = _head.substr(pos, nl - pos);
+        pos = nl + 1;
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        if (line.empty())
+            break;
+
+        if (first) {
+            // "HTTP/1.x 200 OK"
+            first = false;
+            if (line.size() < 12 || line.compare(0, 7, "HTTP/1.") != 0 || line[8] != ' '
+                || !std::isdigit(static_cast<unsigned char>(line[9]))
+                || !std::isdigit(static_cast<unsigned char>(line[10]))
+                || !std::isdigit(static_cast<unsigned char>(line[11])))
+                return false;
+            _status = std::atoi(line.c_str() + 9);
+            _keepAlive = (line[7] != '0');
+            continue;
+        }
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos || colon == 0
+            || std::isspace(static_cast<unsigned char>(line[0])))
+            return false;
+        std::string name = line.substr(0, colon);
+        std::string value = trim(line.substr(colon + 1));
+
+        if (strcasecmp(name.c_str(), "content-length") == 0) {
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+                return false;
+            size_t length = static_cast<size_t>(std::strtoul(value.c_str(), NULL, 10));
+            if (_hasLength && length != _length)
+                return false;
+            _hasLength = true;
+            _length = length;
+        } else if (strcasecmp(name.c_str(), "transfer-encoding") == 0) {
+            transferEncoding = true;
+            size_t comma = value.rfind(',');
+            std::string last = trim(comma == std::string::npos ? value : value.substr(comma + 1));
+            chunked = (strcasecmp(last.c_str(), "chunked") == 0);
+        } else if (strcasecmp(name.c_str(), "connection") == 0) {
+            if (hasToken(value, "close"))
+                _keepAlive = false;
+            else if (hasToken(value, "keep-alive"))
+                _keepAlive = true;
+        }
+        _headers.push_back(Header(name, value));
+    }
+    if (first)
+        return false;
+    // 업그레이드는 지원하지 않는다 (Upgrade 헤더를 보내지 않으므로 오지 않아야 함)
+    if (_status == 101)
+        return false;
+
+    if (_headRequest || _status < 200 || _status == 204 || _status == 304) {
+        _framing = FRAME_NONE;
+    } else if (transferEncoding) {
+        // Transfer-Encoding이 있으면 Content-Length는 무시 (RFC 9112 6.3)
+        _framing = chunked ? FRAME_CHUNKED : FRAME_CLOSE;
+        _hasLength = false;
+    } else if (_hasLength) {
+        _framing = FRAME_LENGTH;
+    } else {
+        _framing = FRAME_CLOSE;
+    }
+    if (_framing == FRAME_CLOSE)
+        _keepAlive = false;
+    _chunkState = CHUNK_SIZE;
+    return true;
+}
+
+// _head에 '\n'까지 모은다: 한 줄이 완성되면 true ('\r\n'은 떼어냄)
+bool ProxyHandler::takeLine(const char* data, size_t len, size_t& pos) {
+    size_t start = pos;
+    while (pos < len && data[pos] != '\n')
+        pos++;
+    _head.append(data + start, pos - start);
+    if (pos == len) {
+        if (_head.size() > PROXY_LINE_MAX)
+            _state = FAILED;
+        return false;
+    }
+    pos++;
+    if (!_head.empty() && _head[_head.size() - 1] == '\r')
+        _head.erase(_head.size() - 1);
+    return true;
+}
+
+void ProxyHandler::feedBody(const char* data, size_t len, std::string& body) {
+    size_t pos = 0;
+    while (pos < len && _state == BODY) {
+        if (_framing == FRAME_CLOSE) {
+            body.append(data + pos, len - pos);
+            return;
+        }
+        if (_framing == FRAME_LENGTH || _chunkState == CHUNK_DATA) {
+            size_t take = len - pos;
+            if (take > _remaining)
+                take = _remaining;
+            body.append(data + pos, take);
+            pos += take;
+            _remaining -= take;
+            if (_remaining == 0) {
+                if (_framing == FRAME_LENGTH)
+                    _state = DONE;
+                else
+                    _chunkState = CHUNK_DATA_END;
+            }
+            continue;
+        }
+
+        if (!takeLine(data, len, pos))
+            continue;
+        if (_chunkState == CHUNK_SIZE) {
+            // "1a3f;ext=..." : 확장은 무시
+            std::string size = trim(_head.substr(0, _head.find(';')));
+            if (size.empty() || size.size() > 15
+                || size.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+                _state = FAILED;
+                return;
+            }
+            _remaining = static_cast<size_t>(std::strtoul(size.c_str(), NULL, 16));
+            _chunkState = (_remaining == 0) ? CHUNK_TRAILER : CHUNK_DATA;
+        } else if (_chunkState == CHUNK_DATA_END) {
+            if (!_head.empty()) {
+                _state = FAILED;
+                return;
+            }
+            _chunkState = CHUNK_SIZE;
+        } else if (_head.empty()) {
+            // trailer 필드는 버리고 빈 줄에서 끝
+            _state = DONE;
+        }
+        _head.clear();
+    }
+    if (pos < len && _state == DONE)
+        _excess = true;
+}
+
+ProxyHandler::State ProxyHandler::state() const { return _state; }
+
+int ProxyHandler::status() const { return _status; }
+
+const std::vector<ProxyHandler::Header>& ProxyHandler::headers() const { return _headers; }
+
+bool ProxyHandler::hasBody() const { return _framing != FRAME_NONE; }
+
+bool ProxyHandler::hasLength() const { return _hasLength; }
+
+size_t ProxyHandler::length() const { return _length; }
+
+bool ProxyHandler::reusable() const {
+    return _state == DONE && _keepAlive && !_excess;
+}
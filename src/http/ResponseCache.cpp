@@ -0,0 +1,376 @@
+#include "ResponseCache.hpp"
+#include "HttpResponse.hpp"
+
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+// 항목 하나가 캐시 전체에서 차지할 수 있는 최대 비율 (큰 응답 하나가 캐시를 비우지 않게)
+static const size_t MAX_ENTRY_DIVISOR = 4;
+
+static std::string lowerAscii(const std::string& s) {
+    std::string out(s);
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(out[i])));
+    return out;
+}
+
+static std::string trim(const std::string& s) {
+    size_t b = 0;
+    size_t e = s.size();
+    while (b < e && (s[b] == ' ' || s[b] == '\t'))
+        ++b;
+    while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t'))
+        --e;
+    return s.substr(b, e - b);
+}
+
+// "a, b,c" -> [a, b, c] (빈 항목 제외)
+static void splitList(const std::string& value, std::vector<std::string>& out) {
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos)
+            comma = value.size();
+        std::string item = trim(value.substr(pos, comma - pos));
+        if (!item.empty())
+            out.push_back(item);
+        pos = comma + 1;
+    }
+}
+
+// 캐시 파일 이름 ("pid-번호")인지: cache_path를 잘못 지정해도 다른 파일은 지우지 않는다
+// owner가 0이 아니면 그 pid의 파일만
+static bool isCacheFileName(const char* name, pid_t owner) {
+    const char* p = name;
+    if (!std::isdigit(static_cast<unsigned char>(*p)))
+        return false;
+    if (owner != 0 && std::atol(p) != static_cast<long>(owner))
+        return false;
+    while (std::isdigit(static_cast<unsigned char>(*p)))
+        ++p;
+    if (*p++ != '-' || !std::isdigit(static_cast<unsigned char>(*p)))
+        return false;
+    while (std::isdigit(static_cast<unsigned char>(*p)))
+        ++p;
+    return *p == '\0';
+}
+
+bool ResponseCache::shareable(const std::vector<Header>& headers) {
+    for (size_t i = 0; i < headers.size(); ++i) {
+        const std::string& name = headers[i].first;
+        if (strcasecmp(name.c_str(), "set-cookie") == 0)
+            return false;
+        if (strcasecmp(name.c_str(), "vary") == 0 && trim(headers[i].second) == "*")
+            return false;
+        if (strcasecmp(name.c_str(), "cache-control") != 0)
+            continue;
+        std::vector<std::string> directives;
+        splitList(headers[i].second, directives);
+        for (size_t j = 0; j < directives.size(); ++j) {
+            std::string d = lowerAscii(directives[j]);
+            if (d == "no-store" || d == "private" || d.compare(0, 8, "private=") == 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool ResponseCache::sameVariant(const std::vector<Header>& headers, const RequestHeaders& a,
+                                const RequestHeaders& b) {
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (strcasecmp(headers[i].first.c_str(), "vary") != 0)
+            continue;
+        std::vector<std::string> names;
+        splitList(headers[i].second, names);
+        for (size_t j = 0; j < names.size(); ++j) {
+            std::string name = lowerAscii(names[j]);
+            RequestHeaders::const_iterator ia = a.find(name);
+            RequestHeaders::const_iterator ib = b.find(name);
+            bool hasA = (ia != a.end());
+            if (hasA != (ib != b.end()) || (hasA && ia->second != ib->second))
+                return false;
+        }
+    }
+    return true;
+}
+
+// 공유 캐시가 저장해도 되는 응답이면 유효 시간(초), 아니면 0
+static long freshnessLifetime(int status, const std::vector<ResponseCache::Header>& headers,
+                              int defaultValid, std::time_t now) {
+    // 명시적인 유효 시간이 있으면 저장할 수 있는 상태 코드 (RFC 9110 15.1 heuristically cacheable)
+    static const int cacheable[] = { 200, 203, 204, 300, 301, 308, 404, 405, 410, 414, 501 };
+    bool known = false;
+    for (size_t i = 0; i < sizeof(cacheable) / sizeof(cacheable[0]); ++i)
+        known = known || cacheable[i] == status;
+    if (!known || !ResponseCache::shareable(headers))
+        return 0;
+
+    long sMaxAge = -1;
+    long maxAge = -1;
+    bool hasExpires = false;
+    std::time_t expires = 0;
+    std::time_t date = now;
+    for (size_t i = 0; i < headers.size(); ++i) {
+        const std::string& name = headers[i].first;
+        const std::string& value = headers[i].second;
+        if (strcasecmp(name.c_str(), "date") == 0) {
+            HttpResponse::parseHttpDate(value, date);
+        } else if (strcasecmp(name.c_str(), "expires") == 0) {
+            // 해석할 수 없는 Expires는 이미 만료된 것으로 본다 (RFC 9111 5.3)
+            hasExpires = true;
+            if (!HttpResponse::parseHttpDate(value, expires))
+                expires = 0;
+        } else if (strcasecmp(name.c_str(), "cache-control") == 0) {
+            std::vector<std::string> directives;
+            splitList(value, directives);
+            for (size_t j = 0; j < directives.size(); ++j) {
+                std::string d = lowerAscii(directives[j]);
+                if (d == "no-cache" || d.compare(0, 9, "no-cache=") == 0)
+                    return 0;
+                if (d.compare(0, 9, "s-maxage=") == 0)
+                    sMaxAge = std::atol(d.c_str() + 9);
+                else if (d.compare(0, 8, "max-age=") == 0)
+                    maxAge = std::atol(d.c_str() + 8);
+            }
+        }
+    }
+
+    if (sMaxAge >= 0)
+        return sMaxAge;
+    if (maxAge >= 0)
+        return maxAge;
+    if (hasExpires)
+        return (expires > date) ? static_cast<long>(expires - date) : 0;
+    if (status == 200 || status == 203 || status == 301 || status == 308)
+        return defaultValid;
+    return 0;
+}
+
+void ResponseCache::Fill::write(const char* data, size_t len) {
+    if (failed || len == 0)
+        return;
+    if (size + len > maxSize) {
+        failed = true;
+        return;
+    }
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            failed = true;
+            return;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        size += static_cast<size_t>(n);
+    }
+}
+
+ResponseCache::ResponseCache(const std::string& dir, size_t maxBytes)
+: _dir(dir), _maxBytes(maxBytes), _bytes(0), _seq(0),
+  _hits(0), _misses(0), _stores(0), _evictions(0) {}
+
+ResponseCache::~ResponseCache() {
+    while (!_lru.empty())
+        erase(_lru.begin());
+}
+
+bool ResponseCache::purge(const std::string& dir, pid_t owner) {
+    // 없는 상위 디렉터리도 만든다 (mkdir -p)
+    for (size_t pos = 1; pos <= dir.size(); ++pos) {
+        if (pos < dir.size() && dir[pos] != '/')
+            continue;
+        std::string part = dir.substr(0, pos);
+        if (::mkdir(part.c_str(), 0700) < 0 && errno != EEXIST)
+            return false;
+    }
+
+    DIR* d = ::opendir(dir.c_str());
+    if (d == NULL)
+        return false;
+    struct dirent* ent;
+    while ((ent = ::readdir(d)) != NULL) {
+        if (isCacheFileName(ent->d_name, owner))
+            ::unlink((dir + "/" + ent->d_name).c_str());
+    }
+    ::closedir(d);
+    return ::access(dir.c_str(), W_OK | X_OK) == 0;
+}
+
+const std::string& ResponseCache::dir() const { return _dir; }
+
+std::string ResponseCache::variantKey(const std::string& key, const std::vector<std::string>& vary,
+                                      const RequestHeaders& requestHeaders) {
+    std::string out(key);
+    for (size_t i = 0; i < vary.size(); ++i) {
+        RequestHeaders::const_iterator it = requestHeaders.find(vary[i]);
+        out += '\n';
+        out += vary[i];
+        out += ':';
+        if (it != requestHeaders.end())
+            out += it->second;
+    }
+    return out;
+}
+
+const ResponseCache::Entry* ResponseCache::lookup(const std::string& key,
+                                                  const RequestHeaders& requestHeaders) {
+    std::map<std::string, std::vector<std::string> >::const_iterator v = _vary.find(key);
+    if (v == _vary.end()) {
+        ++_misses;
+        return NULL;
+    }
+    std::map<std::string, LruList::iterator>::iterator it =
+        _index.find(variantKey(key, v->second, requestHeaders));
+    if (it == _index.end()) {
+        ++_misses;
+        return NULL;
+    }
+    LruList::iterator e = it->second;
+    if (e->expires <= std::time(NULL)) {
+        erase(e);
+        ++_misses;
+        return NULL;
+    }
+    _lru.splice(_lru.begin(), _lru, e);
+    ++_hits;
+    return &*e;
+}
+
+void ResponseCache::invalidate(const Entry* entry) {
+    std::map<std::string, LruList::iterator>::iterator it = _index.find(entry->key);
+    if (it != _index.end())
+        erase(it->second);
+}
+
+ResponseCache::Fill* ResponseCache::begin(const std::string& key, const RequestHeaders& requestHeaders,
+                                          int status, const std::vector<Header>& headers,
+                                          int defaultValid) {
+    std::time_t now = std::time(NULL);
+    long lifetime = freshnessLifetime(status, headers, defaultValid, now);
+    if (lifetime <= 0)
+        return NULL;
+
+    std::vector<std::string> vary;
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (strcasecmp(headers[i].first.c_str(), "vary") != 0)
+            continue;
+        std::vector<std::string> names;
+        splitList(headers[i].second, names);
+        for (size_t j = 0; j < names.size(); ++j)
+            vary.push_back(lowerAscii(names[j]));
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%ld-%lu", static_cast<long>(::getpid()), ++_seq);
+    std::string file = _dir + name;
+    int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        std::cerr << "cache: cannot create " << file << ": " << std::strerror(errno) << std::endl;
+        return NULL;
+    }
+
+    Fill* fill = new Fill;
+    fill->key = variantKey(key, vary, requestHeaders);
+    fill->primaryKey = key;
+    fill->vary = vary;
+    fill->file = file;
+    fill->fd = fd;
+    fill->size = 0;
+    fill->maxSize = _maxBytes / MAX_ENTRY_DIVISOR;
+    fill->failed = false;
+    fill->status = status;
+    fill->headers = headers;
+    fill->storedAt = now;
+    fill->expires = now + lifetime;
+    return fill;
+}
+
+void ResponseCache::commit(Fill* fill) {
+    int rc = ::close(fill->fd);
+    fill->fd = -1;
+    if (fill->failed || rc < 0) {
+        abandon(fill);
+        return;
+    }
+
+    // backend가 Vary를 바꿨으면 이전 Vary로 나눈 항목은 다시 찾을 수 없다: 전부 버린다
+    std::map<std::string, std::vector<std::string> >::iterator v = _vary.find(fill->primaryKey);
+    if (v != _vary.end() && v->second != fill->vary)
+        eraseVariants(fill->primaryKey);
+    std::map<std::string, LruList::iterator>::iterator old = _index.find(fill->key);
+    if (old != _index.end())
+        erase(old->second);
+    while (!_lru.empty() && _bytes + fill->size > _maxBytes)
+        evictOne();
+
+    _lru.push_front(Entry());
+    Entry& e = _lru.front();
+    e.key = fill->key;
+    e.file = fill->file;
+    e.size = fill->size;
+    e.status = fill->status;
+    e.headers.swap(fill->headers);
+    e.storedAt = fill->storedAt;
+    e.expires = fill->expires;
+    _index[e.key] = _lru.begin();
+    _vary[fill->primaryKey] = fill->vary;
+    _bytes += e.size;
+    ++_stores;
+    delete fill;
+}
+
+void ResponseCache::abandon(Fill* fill) {
+    if (fill->fd != -1)
+        ::close(fill->fd);
+    ::unlink(fill->file.c_str());
+    delete fill;
+}
+
+void ResponseCache::evictOne() {
+    erase(--_lru.end());
+    ++_evictions;
+}
+
+void ResponseCache::erase(LruList::iterator it) {
+    // 이 파일로 전송 중인 응답은 이미 연 fd로 끝까지 보낸다
+    ::unlink(it->file.c_str());
+    _bytes -= it->size;
+    _index.erase(it->key);
+    _lru.erase(it);
+}
+
+void ResponseCache::eraseVariants(const std::string& key) {
+    // 변형 키는 "키" 또는 "키\n이름:값..." (Host / URI에는 줄바꿈이 없다)
+    std::map<std::string, LruList::iterator>::iterator it = _index.find(key);
+    if (it != _index.end())
+        erase(it->second);
+    std::string prefix = key + '\n';
+    it = _index.lower_bound(prefix);
+    while (it != _index.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        LruList::iterator e = it->second;
+        ++it;
+        erase(e);
+    }
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    Stats s;
+    s.hits = _hits;
+    s.misses = _misses;
+    s.stores = _stores;
+    s.evictions = _evictions;
+    s.entries = _lru.size();
+    s.bytes = _bytes;
+    return s;
+}
@@ -28,34 +28,60 @@
 // Router
 // - 여러 LocationConfig를 담고 있고
 // - URI에 가장 잘 매칭되는(location.path가 가장 긴 prefix) location을 찾아주는 역할
-Router::Router() {}
+Router::Router() : nodes(1) {}
 
-// 설정 파일 등에서 읽어온 location 설정을 내부 벡터에 추가
+Router::Router(const std::vector<LocationConfig>& locations) : nodes(1) {
+    for (size_t i = 0; i < locations.size(); ++i)
+        addLocation(locations[i]);
+}
+
+// location path를 한 글자씩 trie에 삽입 (설정 로드 시 한 번)
+// 같은 path가 여러 번 나오면 먼저 나온 location을 유지
 void Router::addLocation(const LocationConfig& loc) {
-    locations.push_back(loc);
+    const std::string& path = loc.getPath();
+    int cur = 0;
+
+    for (size_t i = 0; i < path.size(); ++i) {
+        unsigned char ch = static_cast<unsigned char>(path[i]);
+        int next = findChild(cur, ch);
+        if (next < 0) {
+            next = static_cast<int>(nodes.size());
+            nodes.push_back(Node());
+            Edge e;
+            e.ch = ch;
+            e.next = next;
+            nodes[cur].edges.push_back(e);
+        }
+        cur = next;
+    }
+    if (nodes[cur].loc == NULL)
+        nodes[cur].loc = &loc;
+}
+
+int Router::findChild(int node, unsigned char ch) const {
+    const std::vector<Edge>& edges = nodes[node].edges;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (edges[i].ch == ch)
+            return edges[i].next;
+    }
+    return -1;
 }
 
 /*
 ** Prefix matching
 **   예) /images/cat.png → /images
-** 여러 location 중에서 uri의 prefix로 가장 길게 매칭되는 location을 선택한다.
+** uri를 따라 trie를 내려가면서 마지막으로 지나친 location이 가장 긴 prefix.
 */
 const LocationConfig* Router::match(const std::string& uri) const {
-    const LocationConfig* best = NULL;
-    size_t bestLen = 0;
+    const LocationConfig* best = nodes[0].loc;
+    int cur = 0;
 
-    // 모든 location을 순회하면서 prefix 매칭 확인
-    for (size_t i = 0; i < locations.size(); i++) {
-        const std::string& path = locations[i].getPath();
-
-        // uri가 path로 시작하면(prefix) 후보로 본다.
-        if (uri.compare(0, path.size(), path) == 0) {
-            // 가장 긴 path를 가진 location을 선택 (more specific)
-            if (path.size() > bestLen) {
-                best = &locations[i];
-                bestLen = path.size();
-            }
-        }
+    for (size_t i = 0; i < uri.size(); ++i) {
+        cur = findChild(cur, static_cast<unsigned char>(uri[i]));
+        if (cur < 0)
+            break;
+        if (nodes[cur].loc != NULL)
+            best = nodes[cur].loc;
     }
     return best;
 }
@@ -73,12 +99,12 @@ bool Router::isMethodAllowed(const LocationConfig* loc,
     if (!loc)
         return false;
 
-    // 구현된 메서드만 허용 (GET, POST, DELETE)
-    if (method != "GET" && method != "POST" && method != "DELETE")
+    // 구현된 메서드만 허용 (GET, HEAD, POST, DELETE)
+    if (method != "GET" && method != "HEAD" && method != "POST" && method != "DELETE")
         return false;
 
-    // 1. GET은 항상 허용 ✅
-    if (method == "GET")
+    // 1. GET은 항상 허용 ✅ (HEAD는 GET을 따른다)
+    if (method == "GET" || method == "HEAD")
         return true;
 
     // 2. POST, DELETE는 config 확인
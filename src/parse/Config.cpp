@@ -26,6 +26,7 @@ void	Config::configParse()
 {
 	ParserContext ctx;
 	this->_servers.clear();
+	this->_upstreams.clear();
 
 	try
 	{
@@ -37,6 +38,8 @@ void	Config::configParse()
 				handleServerState(ctx);
 			else if (ctx.state == STATE_LOCATION)
 				handleLocationState(ctx);
+			else if (ctx.state == STATE_UPSTREAM)
+				handleUpstreamState(ctx);
 		}
 	}
 	catch (...) // 어떤 타입의 예외든 다 받겠다, cleanup용(자원 정리) : currentLocation은 포인터변수 -> location은 있을수도 있고, 없을 수도 있음(생성자 만들지 않음, 그래서 pointer 변수)
@@ -48,6 +51,10 @@ void	Config::configParse()
 		}
 		throw ;
 	}
+
+	// upstream 블록은 server 블록 뒤에 와도 되므로 proxy_pass 이름은 마지막에 해석
+	for (size_t i = 0; i < this->_servers.size(); ++i)
+		this->_servers[i].resolveUpstreams(this->_upstreams);
 }
 
 /* state handlers */
@@ -65,6 +72,24 @@ void	Config::handleGlobalState(ParserContext& ctx)
 		return ;
 	}
 
+	if (token.type == TOKEN_WORD && token.value == "upstream")
+	{
+		if ((ctx.i + 1) >= this->_tokens.size() || this->_tokens[ctx.i + 1].type != TOKEN_WORD)
+			throw ConfigSyntaxException("Error: upstream requires a name");
+
+		const std::string&	name = this->_tokens[ctx.i + 1].value;
+		for (size_t j = 0; j < this->_upstreams.size(); ++j)
+		{
+			if (this->_upstreams[j].getName() == name)
+				throw ConfigSemanticException("Error: duplicate upstream: " + name);
+		}
+		ctx.currentUpstream = UpstreamConfig(name);
+		ctx.upstreamOpened = false;
+		ctx.state = STATE_UPSTREAM;
+		ctx.i += 2; // upstream + name
+		return ;
+	}
+
 	if (token.type == TOKEN_EOF)
 	{
 		if (ctx.serverOpened)
@@ -185,6 +210,46 @@ void	Config::handleLocationState(ParserContext& ctx)
 	throw ConfigSyntaxException("Error: invalid token in LOCATION scope");
 }
 
+void	Config::handleUpstreamState(ParserContext& ctx)
+{
+	const Token	&token = this->_tokens[ctx.i];
+
+	if (token.type == TOKEN_LBRACE)
+	{
+		if (ctx.upstreamOpened)
+			throw ConfigSyntaxException("Error: unexpected '{' in upstream block");
+
+		ctx.upstreamOpened = true;
+		ctx.i++;
+		return ;
+	}
+
+	if (token.type == TOKEN_RBRACE)
+	{
+		if (!ctx.upstreamOpened)
+			throw ConfigSyntaxException("Error: '}' without matching '{' in upstream block");
+
+		ctx.currentUpstream.validateUpstreamBlock();
+		this->_upstreams.push_back(ctx.currentUpstream);
+
+		ctx.upstreamOpened = false;
+		ctx.state = STATE_GLOBAL;
+		ctx.i++;
+		return ;
+	}
+
+	if (token.type == TOKEN_WORD)
+	{
+		if (!ctx.upstreamOpened)
+			throw ConfigSyntaxException("Error: missing '{' after upstream name");
+
+		ctx.currentUpstream.parseDirective(this->_tokens, ctx.i);
+		return ;
+	}
+
+	throw ConfigSyntaxException("Error: invalid token in UPSTREAM scope");
+}
+
 /* 외부에서 _servers 접근 위한 함수 (나중에 Server쪽에서 사용) */
 const std::vector<ServerConfig>&	Config::getServers(void) const { return this->_servers; }
 
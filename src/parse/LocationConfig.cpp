@@ -11,9 +11,34 @@
 /* ************************************************************************** */
 
 #include "LocationConfig.hpp"
+#include <cstdlib>
+
+static const size_t	DEFAULT_FILE_CACHE_MAX_ENTRY = 1024 * 1024;		// 1MB
+static const size_t	MAX_FILE_CACHE_SIZE = 1024UL * 1024UL * 1024UL;	// 1GB
+static const size_t	DEFAULT_CACHE_MAX_SIZE = 256UL * 1024UL * 1024UL;	// 256MB
+static const size_t	MAX_CACHE_SIZE = 64UL * 1024UL * 1024UL * 1024UL;	// 64GB (디스크)
+static const long	MAX_CACHE_VALID = 365L * 24 * 3600;
+
+/* 바이트 단위 크기 값 (client_max_body_size와 같은 규칙: 양의 정수) */
+static size_t	parseByteSize(const Token& value, const std::string& directiveName, size_t maxValue)
+{
+	if (!isNumber(value.value))
+		throw ConfigSyntaxException("Error: " + directiveName + " must be a number");
+
+	long size = std::atol(value.value.c_str());
+	if (size <= 0)
+		throw ConfigSemanticException("Error: " + directiveName + " must be > 0");
+	if (static_cast<size_t>(size) > maxValue)
+		throw ConfigSemanticException("Error: " + directiveName + " too large");
+	return static_cast<size_t>(size);
+}
 
 LocationConfig::LocationConfig(const std::string &path) : _path(path), _root(""), _rootSet(false), _autoindex(false), _autoindexSet(false),
-	_hasMethods(false), _hasIndex(false), _hasRedirect(false), _hasAllowMethods(false), _uploadStore(""), _hasUploadStore(false), _hasCgiPass(false) {}
+	_hasMethods(false), _hasIndex(false), _hasRedirect(false), _hasAllowMethods(false), _uploadStore(""), _hasUploadStore(false), _hasCgiPass(false),
+	_fastCgiPass(""), _hasFastCgiPass(false), _proxyPass(""), _proxyPassUri(""), _proxyPassPortSet(false), _hasProxyPass(false),
+	_fileCacheSize(0), _hasFileCache(false), _fileCacheMaxEntry(DEFAULT_FILE_CACHE_MAX_ENTRY), _hasFileCacheMaxEntry(false),
+	_cachePath(""), _hasCachePath(false), _cacheValid(0), _hasCacheValid(false), _cacheMaxSize(DEFAULT_CACHE_MAX_SIZE), _hasCacheMaxSize(false),
+	_stubStatus(false), _hasStubStatus(false), _gzipStatic(false), _hasGzipStatic(false) {}
 
 LocationConfig::~LocationConfig() {}
 
@@ -230,6 +255,200 @@ void	LocationConfig::handleCgiPass(const std::vector<Token>& tokens, size_t& i)
 	this->_hasCgiPass = true;
 }
 
+/* 문법: fastcgi_pass unix:/run/php-fpm.sock;
+		fastcgi_pass 127.0.0.1:9000;
+	주소 형식만 검사 (host 해석은 서버 시작 시) */
+void	LocationConfig::handleFastCgiPass(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasFastCgiPass)
+		throw ConfigSemanticException("Error: duplicate fastcgi_pass directive");
+
+	const Token&	addrToken = directiveSyntaxCheck(tokens, i, "fastcgi_pass");
+	const std::string&	addr = addrToken.value;
+
+	if (addr.compare(0, 5, "unix:") == 0)
+	{
+		if (addr.size() <= 5 || addr[5] != '/')
+			throw ConfigSemanticException("Error: fastcgi_pass unix socket path must be absolute");
+	}
+	else
+	{
+		size_t	colon = addr.rfind(':');
+		if (colon == std::string::npos || colon == 0)
+			throw ConfigSyntaxException("Error: fastcgi_pass requires unix:/path or host:port");
+		std::string	port = addr.substr(colon + 1);
+		if (!isNumber(port))
+			throw ConfigSyntaxException("Error: fastcgi_pass port must be a number");
+		long	portNum = std::atol(port.c_str());
+		if (portNum <= 0 || portNum > 65535)
+			throw ConfigSemanticException("Error: fastcgi_pass port out of range");
+	}
+
+	this->_fastCgiPass = addr;
+	this->_hasFastCgiPass = true;
+}
+
+/* 문법: proxy_pass http://127.0.0.1:8000;
+		proxy_pass http://127.0.0.1:8000/app/;  (URI가 있으면 location 경로 부분을 그 URI로 바꿔 전달)
+		proxy_pass http://backend;  (upstream 블록 이름: port 없이)
+	port를 생략하면 80, host는 IPv4 주소 또는 localhost (서버 시작 시 해석) */
+void	LocationConfig::handleProxyPass(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasProxyPass)
+		throw ConfigSemanticException("Error: duplicate proxy_pass directive");
+
+	const Token&	urlToken = directiveSyntaxCheck(tokens, i, "proxy_pass");
+	const std::string&	url = urlToken.value;
+
+	if (url.compare(0, 7, "http://") != 0)
+		throw ConfigSyntaxException("Error: proxy_pass requires http://host[:port][/uri]");
+
+	size_t	slash = url.find('/', 7);
+	std::string	authority = url.substr(7, (slash == std::string::npos) ? std::string::npos : slash - 7);
+	std::string	host = authority;
+	std::string	port = "80";
+	size_t	colon = authority.rfind(':');
+	if (colon != std::string::npos)
+	{
+		host = authority.substr(0, colon);
+		port = authority.substr(colon + 1);
+		this->_proxyPassPortSet = true;
+	}
+	if (host.empty())
+		throw ConfigSyntaxException("Error: proxy_pass host is empty");
+	if (!isNumber(port))
+		throw ConfigSyntaxException("Error: proxy_pass port must be a number");
+	long	portNum = std::atol(port.c_str());
+	if (portNum <= 0 || portNum > 65535)
+		throw ConfigSemanticException("Error: proxy_pass port out of range");
+
+	this->_proxyPass = this->_proxyPassPortSet ? (host + ":" + port) : host;
+	if (slash != std::string::npos)
+		this->_proxyPassUri = url.substr(slash);
+	this->_hasProxyPass = true;
+}
+
+void	LocationConfig::resolveProxyPass(const std::vector<UpstreamConfig>& upstreams)
+{
+	if (!this->_hasProxyPass)
+		return;
+	if (!this->_proxyPassPortSet)
+	{
+		for (size_t i = 0; i < upstreams.size(); ++i)
+		{
+			if (upstreams[i].getName() == this->_proxyPass)
+			{
+				this->_upstream = upstreams[i];
+				return;
+			}
+		}
+		this->_proxyPass += ":80";
+	}
+	this->_upstream = UpstreamConfig::single(this->_proxyPass);
+}
+
+/* 문법: file_cache 67108864;  (캐시 전체 최대 바이트) */
+void	LocationConfig::handleFileCache(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasFileCache)
+		throw ConfigSemanticException("Error: duplicate file_cache directive");
+
+	const Token&	sizeValue = directiveSyntaxCheck(tokens, i, "file_cache");
+	this->_fileCacheSize = parseByteSize(sizeValue, "file_cache", MAX_FILE_CACHE_SIZE);
+	this->_hasFileCache = true;
+}
+
+/* 문법: file_cache_max_entry 1048576;  (이보다 큰 파일은 캐시하지 않고 sendfile) */
+void	LocationConfig::handleFileCacheMaxEntry(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasFileCacheMaxEntry)
+		throw ConfigSemanticException("Error: duplicate file_cache_max_entry directive");
+
+	const Token&	sizeValue = directiveSyntaxCheck(tokens, i, "file_cache_max_entry");
+	this->_fileCacheMaxEntry = parseByteSize(sizeValue, "file_cache_max_entry", MAX_FILE_CACHE_SIZE);
+	this->_hasFileCacheMaxEntry = true;
+}
+
+/* 문법: cache_path /var/cache/webserv;  (디렉터리가 없으면 시작할 때 만든다) */
+void	LocationConfig::handleCachePath(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasCachePath)
+		throw ConfigSemanticException("Error: duplicate cache_path directive");
+
+	const Token&	pathToken = directiveSyntaxCheck(tokens, i, "cache_path");
+	if (pathToken.value.empty() || pathToken.value[0] != '/')
+		throw ConfigSemanticException("Error: cache_path must be an absolute path");
+
+	this->_cachePath = pathToken.value;
+	while (this->_cachePath.size() > 1 && this->_cachePath[this->_cachePath.size() - 1] == '/')
+		this->_cachePath.erase(this->_cachePath.size() - 1);
+	this->_hasCachePath = true;
+}
+
+/* 문법: cache_valid 60;  (초. Cache-Control max-age / Expires가 있으면 그쪽이 우선) */
+void	LocationConfig::handleCacheValid(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasCacheValid)
+		throw ConfigSemanticException("Error: duplicate cache_valid directive");
+
+	const Token&	valueToken = directiveSyntaxCheck(tokens, i, "cache_valid");
+	if (!isNumber(valueToken.value))
+		throw ConfigSyntaxException("Error: cache_valid must be a number");
+	long	seconds = std::atol(valueToken.value.c_str());
+	if (seconds > MAX_CACHE_VALID)
+		throw ConfigSemanticException("Error: cache_valid too large");
+
+	this->_cacheValid = static_cast<int>(seconds);
+	this->_hasCacheValid = true;
+}
+
+/* 문법: cache_max_size 268435456;  (cache_path 하나의 디스크 사용량 한도, 넘으면 오래 안 쓴 항목부터 삭제)
+	worker마다 인덱스가 따로라 worker 수로 나눠 각자 자기 몫을 지킨다 */
+void	LocationConfig::handleCacheMaxSize(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasCacheMaxSize)
+		throw ConfigSemanticException("Error: duplicate cache_max_size directive");
+
+	const Token&	sizeValue = directiveSyntaxCheck(tokens, i, "cache_max_size");
+	this->_cacheMaxSize = parseByteSize(sizeValue, "cache_max_size", MAX_CACHE_SIZE);
+	this->_hasCacheMaxSize = true;
+}
+
+/* 문법: stub_status on; */
+void	LocationConfig::handleStubStatus(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasStubStatus)
+		throw ConfigSemanticException("Error: duplicate stub_status directive");
+
+	const Token&	valueToken = directiveSyntaxCheck(tokens, i, "stub_status");
+
+	if (valueToken.value == "on")
+		this->_stubStatus = true;
+	else if (valueToken.value == "off")
+		this->_stubStatus = false;
+	else
+		throw ConfigSyntaxException("Error: stub_status must be 'on' or 'off'");
+
+	this->_hasStubStatus = true;
+}
+
+void	LocationConfig::handleGzipStatic(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasGzipStatic)
+		throw ConfigSemanticException("Error: duplicate gzip_static directive");
+
+	const Token&	valueToken = directiveSyntaxCheck(tokens, i, "gzip_static");
+
+	if (valueToken.value == "on")
+		this->_gzipStatic = true;
+	else if (valueToken.value == "off")
+		this->_gzipStatic = false;
+	else
+		throw ConfigSyntaxException("Error: gzip_static must be 'on' or 'off'");
+
+	this->_hasGzipStatic = true;
+}
+
 void	LocationConfig::parseDirective(const std::vector<Token> &tokens, size_t &i)
 {
 	const std::string	&field = tokens[i].value;
@@ -250,6 +469,24 @@ void	LocationConfig::parseDirective(const std::vector<Token> &tokens, size_t &i)
 		handleUploadStore(tokens, i);
 	else if (field == "cgi_pass")
 		handleCgiPass(tokens, i);
+	else if (field == "fastcgi_pass")
+		handleFastCgiPass(tokens, i);
+	else if (field == "proxy_pass")
+		handleProxyPass(tokens, i);
+	else if (field == "file_cache")
+		handleFileCache(tokens, i);
+	else if (field == "file_cache_max_entry")
+		handleFileCacheMaxEntry(tokens, i);
+	else if (field == "cache_path")
+		handleCachePath(tokens, i);
+	else if (field == "cache_valid")
+		handleCacheValid(tokens, i);
+	else if (field == "cache_max_size")
+		handleCacheMaxSize(tokens, i);
+	else if (field == "stub_status")
+		handleStubStatus(tokens, i);
+	else if (field == "gzip_static")
+		handleGzipStatic(tokens, i);
 	else
 		throw ConfigSemanticException("Error: Unknown location directive: " + field);
 }
@@ -268,6 +505,13 @@ void	LocationConfig::validatePath() const
 void	LocationConfig::validateLocationBlock()
 {
 	validatePath();
+
+	if (this->_hasFileCacheMaxEntry && !this->_hasFileCache)
+		throw ConfigSemanticException("Error: file_cache_max_entry requires file_cache");
+	if ((this->_hasCacheValid || this->_hasCacheMaxSize) && !this->_hasCachePath)
+		throw ConfigSemanticException("Error: cache_valid / cache_max_size require cache_path");
+	if (this->_hasProxyPass && this->_hasFastCgiPass)
+		throw ConfigSemanticException("Error: proxy_pass and fastcgi_pass cannot be used together");
 }
 
 /* getters */
@@ -305,6 +549,36 @@ bool	LocationConfig::hasCgiPass(void) const { return this->_hasCgiPass; }
 
 const std::map<std::string, std::string>&	LocationConfig::getCgiPass(void) const { return this->_cgiPass; }
 
+bool	LocationConfig::hasFastCgiPass(void) const { return this->_hasFastCgiPass; }
+
+const std::string&	LocationConfig::getFastCgiPass(void) const { return this->_fastCgiPass; }
+
+bool	LocationConfig::hasProxyPass(void) const { return this->_hasProxyPass; }
+
+const std::string&	LocationConfig::getProxyPass(void) const { return this->_proxyPass; }
+
+const std::string&	LocationConfig::getProxyPassUri(void) const { return this->_proxyPassUri; }
+
+const UpstreamConfig&	LocationConfig::getUpstream(void) const { return this->_upstream; }
+
+bool	LocationConfig::hasFileCache(void) const { return this->_hasFileCache; }
+
+size_t	LocationConfig::getFileCacheSize(void) const { return this->_fileCacheSize; }
+
+size_t	LocationConfig::getFileCacheMaxEntry(void) const { return this->_fileCacheMaxEntry; }
+
+bool	LocationConfig::hasCachePath(void) const { return this->_hasCachePath; }
+
+const std::string&	LocationConfig::getCachePath(void) const { return this->_cachePath; }
+
+int	LocationConfig::getCacheValid(void) const { return this->_cacheValid; }
+
+size_t	LocationConfig::getCacheMaxSize(void) const { return this->_cacheMaxSize; }
+
+bool	LocationConfig::getStubStatus(void) const { return this->_stubStatus; }
+
+bool	LocationConfig::getGzipStatic(void) const { return this->_gzipStatic; }
+
 void	LocationConfig::inheritRootIfUnset(const std::string& serverRoot)
 {
 	if (!this->_rootSet)
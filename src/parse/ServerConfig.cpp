@@ -11,16 +11,22 @@
 /* ************************************************************************** */
 
 #include "ServerConfig.hpp"
+#include <algorithm>
 
 /* 임시 기본 경로/제한값 */
 static const std::string	DEFAULT_SERVER_ROOT = "./www";
 static const std::string	DEFAULT_ERROR_PAGE = "/errors/404.html";
 static const size_t			DEFAULT_CLIENT_MAX_BODY_SIZE = 10 * 1024 * 1024; // 10MB
-static const size_t			MAX_CLIENT_BODY_SIZE = 10 * 1024 * 1024; // 정책: 최대 10MB
+static const size_t			MAX_CLIENT_BODY_SIZE = static_cast<size_t>(16) * 1024 * 1024 * 1024; // 정책: 최대 16GB (큰 바디는 임시 파일로 받음)
+static const size_t			DEFAULT_CLIENT_BODY_BUFFER_SIZE = 16 * 1024; // 16KB
 static const int			DEFAULT_MAX_CONNECTIONS = 1024;
 static const int			DEFAULT_IDLE_TIMEOUT = 15;
 static const int			DEFAULT_WRITE_TIMEOUT = 10;
 static const int			DEFAULT_KEEPALIVE_MAX = 100;
+static const int			DEFAULT_WORKER_PROCESSES = 1;
+static const int			MAX_WORKER_PROCESSES = 256;
+static const int			DEFAULT_GZIP_COMP_LEVEL = 1;
+static const size_t			DEFAULT_GZIP_MIN_LENGTH = 256; // 이보다 작으면 gzip 헤더/트레일러 때문에 오히려 커지기 쉬움
 
 
 /* 공통 helper func */
@@ -51,9 +57,12 @@ static void	parseListenValue(const std::string& value, std::string& ip, int& por
 }
 
 ServerConfig::ServerConfig() : _root(""), _errorPage(""), _hasServerNames(false), _hasMethods(false), _clientMaxBodySize(0),
-	_hasClientMaxBodySize(false), _hasIndex(false), _hasRedirect(false), _hasAllowMethods(false),
+	_hasClientMaxBodySize(false), _clientBodyBufferSize(0), _hasClientBodyBufferSize(false), _hasIndex(false), _hasRedirect(false), _hasAllowMethods(false),
 	_maxConnections(0), _hasMaxConnections(false), _idleTimeout(0), _hasIdleTimeout(false),
-	_writeTimeout(0), _hasWriteTimeout(false), _keepAliveMax(0), _hasKeepAliveMax(false), _autoindex(false), _hasAutoindex(false) {}
+	_writeTimeout(0), _hasWriteTimeout(false), _keepAliveMax(0), _hasKeepAliveMax(false), _autoindex(false), _hasAutoindex(false),
+	_eventBackend(""), _hasEventBackend(false), _workerProcesses(0), _hasWorkerProcesses(false),
+	_gzip(false), _hasGzip(false), _gzipCompLevel(0), _hasGzipCompLevel(false), _gzipMinLength(0), _hasGzipMinLength(false),
+	_hasGzipTypes(false) {}
 
 ServerConfig::~ServerConfig() {}
 
@@ -74,6 +83,21 @@ void	ServerConfig::handleAutoIndex(const std::vector<Token>& tokens, size_t& i)
     this->_hasAutoindex = true;
 }
 
+/* 문법: event_backend epoll; | event_backend poll; */
+void	ServerConfig::handleEventBackend(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasEventBackend)
+		throw ConfigSemanticException("Error: duplicate event_backend directive");
+
+	const Token	&valueToken = directiveSyntaxCheck(tokens, i, "event_backend");
+
+	if (valueToken.value != "epoll" && valueToken.value != "poll")
+		throw ConfigSyntaxException("Error: event_backend must be 'epoll' or 'poll'");
+
+	this->_eventBackend = valueToken.value;
+	this->_hasEventBackend = true;
+}
+
 void	ServerConfig::handleListen(const std::vector<Token>& tokens, size_t& i)
 {
 	const Token& value = directiveSyntaxCheck(tokens, i, "listen");
@@ -214,6 +238,29 @@ void	ServerConfig::handleClientMaxBodySize(const std::vector<Token>& tokens, siz
 	this->_hasClientMaxBodySize = true;
 }
 
+/* 문법: client_body_buffer_size 16384;  (이보다 큰 요청 바디는 메모리 대신 임시 파일에 받는다) */
+void	ServerConfig::handleClientBodyBufferSize(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasClientBodyBufferSize)
+		throw ConfigSemanticException("Error: duplicate client_body_buffer_size");
+
+	const Token&	sizeValue = directiveSyntaxCheck(tokens, i, "client_body_buffer_size");
+
+	if (!isNumber(sizeValue.value))
+		throw ConfigSyntaxException("Error: client_body_buffer_size must be a number");
+
+	long size = std::atol(sizeValue.value.c_str());
+
+	if (size <= 0)
+		throw ConfigSemanticException("Error: client_body_buffer_size must be > 0");
+
+	if (static_cast<size_t>(size) > MAX_CLIENT_BODY_SIZE)
+		throw ConfigSemanticException("Error: client_body_buffer_size too large");
+
+	this->_clientBodyBufferSize = static_cast<size_t>(size);
+	this->_hasClientBodyBufferSize = true;
+}
+
 void	ServerConfig::handleIndex(const std::vector<Token>& tokens, size_t& i)
 {
 	this->_index.clear();
@@ -362,6 +409,24 @@ void ServerConfig::handleWriteTimeout(const std::vector<Token>& tokens, size_t&
 	_hasWriteTimeout = true;
 }
 
+/* 문법: worker_processes 4; | worker_processes auto;
+ * worker끼리 메모리를 나누지 않으므로 Server의 세션 저장소는 worker마다 따로다:
+ * 2 이상이면 다른 worker로 간 요청은 세션을 찾지 못한다
+ * (세션을 유지해야 하면 1로 두거나 tests/demo_www/session.py처럼 파일에 저장) */
+void ServerConfig::handleWorkerProcesses(const std::vector<Token>& tokens, size_t& i)
+{
+	if (_hasWorkerProcesses)
+		throw ConfigSemanticException("Error: duplicate worker_processes");
+	if ((i + 1) < tokens.size() && tokens[i + 1].type == TOKEN_WORD && tokens[i + 1].value == "auto")
+	{
+		directiveSyntaxCheck(tokens, i, "worker_processes");
+		_workerProcesses = 0;
+	}
+	else
+		_workerProcesses = parsePositiveIntDirective(tokens, i, "worker_processes", 1, MAX_WORKER_PROCESSES);
+	_hasWorkerProcesses = true;
+}
+
 void ServerConfig::handleKeepAliveMax(const std::vector<Token>& tokens, size_t& i)
 {
 	if (_hasKeepAliveMax)
@@ -370,6 +435,74 @@ void ServerConfig::handleKeepAliveMax(const std::vector<Token>& tokens, size_t&
 	_hasKeepAliveMax = true;
 }
 
+/* 문법: gzip on; | gzip off; */
+void	ServerConfig::handleGzip(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasGzip)
+		throw ConfigSemanticException("Error: duplicate gzip directive");
+
+	const Token	&valueToken = directiveSyntaxCheck(tokens, i, "gzip");
+
+	if (valueToken.value == "on")
+		this->_gzip = true;
+	else if (valueToken.value == "off")
+		this->_gzip = false;
+	else
+		throw ConfigSyntaxException("Error: gzip must be 'on' or 'off'");
+
+	this->_hasGzip = true;
+}
+
+void ServerConfig::handleGzipCompLevel(const std::vector<Token>& tokens, size_t& i)
+{
+	if (_hasGzipCompLevel)
+		throw ConfigSemanticException("Error: duplicate gzip_comp_level");
+	_gzipCompLevel = parsePositiveIntDirective(tokens, i, "gzip_comp_level", 1, 9);
+	_hasGzipCompLevel = true;
+}
+
+void ServerConfig::handleGzipMinLength(const std::vector<Token>& tokens, size_t& i)
+{
+	if (_hasGzipMinLength)
+		throw ConfigSemanticException("Error: duplicate gzip_min_length");
+	_gzipMinLength = static_cast<size_t>(parsePositiveIntDirective(tokens, i, "gzip_min_length", 1, 1024 * 1024 * 1024));
+	_hasGzipMinLength = true;
+}
+
+/* 문법: gzip_types text/css application/javascript ...; ("*"는 모든 타입) */
+void	ServerConfig::handleGzipTypes(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasGzipTypes)
+		throw ConfigSemanticException("Error: duplicate gzip_types directive");
+	this->_hasGzipTypes = true;
+
+	i++; // "gzip_types" 패스
+
+	while (i < tokens.size())
+	{
+		if (tokens[i].type == TOKEN_SEMICOLON)
+		{
+			if (this->_gzipTypes.empty())
+				throw ConfigSyntaxException("Error: gzip_types: missing value");
+			i++;
+			return;
+		}
+
+		if (tokens[i].type != TOKEN_WORD)
+			throw ConfigSyntaxException("Error: gzip_types: invalid token");
+
+		const std::string& type = tokens[i].value;
+
+		if (type != "*" && type.find('/') == std::string::npos)
+			throw ConfigSyntaxException("Error: gzip_types: invalid MIME type " + type);
+
+		this->_gzipTypes.push_back(type);
+		i++;
+	}
+
+	throw ConfigSyntaxException("Error: gzip_types: missing ';'");
+}
+
 void	ServerConfig::parseDirective(const std::vector<Token> &tokens, size_t &i)
 {
 	const std::string	&field = tokens[i].value;
@@ -384,6 +517,8 @@ void	ServerConfig::parseDirective(const std::vector<Token> &tokens, size_t &i)
 		handleServerName(tokens, i);
 	else if (field == "client_max_body_size")
 		handleClientMaxBodySize(tokens, i);
+	else if (field == "client_body_buffer_size")
+		handleClientBodyBufferSize(tokens, i);
 	else if (field == "index")
 		handleIndex(tokens, i);
 	else if (field == "return")
@@ -402,6 +537,18 @@ void	ServerConfig::parseDirective(const std::vector<Token> &tokens, size_t &i)
 		handleKeepAliveMax(tokens, i);
 	else if (field == "autoindex")
     	handleAutoIndex(tokens, i);
+	else if (field == "event_backend")
+		handleEventBackend(tokens, i);
+	else if (field == "worker_processes")
+		handleWorkerProcesses(tokens, i);
+	else if (field == "gzip")
+		handleGzip(tokens, i);
+	else if (field == "gzip_comp_level")
+		handleGzipCompLevel(tokens, i);
+	else if (field == "gzip_min_length")
+		handleGzipMinLength(tokens, i);
+	else if (field == "gzip_types")
+		handleGzipTypes(tokens, i);
 	else
 		throw ConfigSyntaxException("Error: unknown server directive: " + field);
 }
@@ -412,6 +559,12 @@ void	ServerConfig::addLocation(const LocationConfig &location)
 	this->_locations.push_back(location);
 }
 
+void	ServerConfig::resolveUpstreams(const std::vector<UpstreamConfig>& upstreams)
+{
+	for (size_t i = 0; i < this->_locations.size(); ++i)
+		this->_locations[i].resolveProxyPass(upstreams);
+}
+
 void	ServerConfig::checkDuplicateListen(const std::string& ip, int port) const
 {
 	for (size_t i = 0; i < _listen.size(); i++)
@@ -472,6 +625,11 @@ const std::string& ServerConfig::getErrorPage() const
 	return this->_errorPage;
 }
 
+const std::map<int, std::string>& ServerConfig::getErrorPages() const
+{
+	return this->_errorPages;
+}
+
 const std::vector<LocationConfig>& ServerConfig::getLocations() const
 {
 	return this->_locations;
@@ -487,6 +645,8 @@ void	ServerConfig::validateServerBlock()
 	applyDefaultErrorPage(); // 3) error_page 기본값
 	if (!this->_hasClientMaxBodySize) // 필수는 아니지만, 런타임에서 반드시 필요
 		this->_clientMaxBodySize = DEFAULT_CLIENT_MAX_BODY_SIZE;
+	if (!this->_hasClientBodyBufferSize)
+		this->_clientBodyBufferSize = DEFAULT_CLIENT_BODY_BUFFER_SIZE;
 	if (!this->_hasMaxConnections)
 		this->_maxConnections = DEFAULT_MAX_CONNECTIONS;
 	if (!this->_hasIdleTimeout)
@@ -495,6 +655,14 @@ void	ServerConfig::validateServerBlock()
 		this->_writeTimeout = DEFAULT_WRITE_TIMEOUT;
 	if (!this->_hasKeepAliveMax)
 		this->_keepAliveMax = DEFAULT_KEEPALIVE_MAX;
+	if (!this->_hasWorkerProcesses)
+		this->_workerProcesses = DEFAULT_WORKER_PROCESSES;
+	if (!this->_hasGzipCompLevel)
+		this->_gzipCompLevel = DEFAULT_GZIP_COMP_LEVEL;
+	if (!this->_hasGzipMinLength)
+		this->_gzipMinLength = DEFAULT_GZIP_MIN_LENGTH;
+	if (std::find(this->_gzipTypes.begin(), this->_gzipTypes.end(), "text/html") == this->_gzipTypes.end())
+		this->_gzipTypes.push_back("text/html");
 	for (size_t i = 0; i < this->_locations.size(); ++i)
 		this->_locations[i].inheritRootIfUnset(this->_root);
 	duplicateLocationPathCheck(); // 4) location path 중복 검사
@@ -513,6 +681,8 @@ bool	ServerConfig::hasClientMaxBodySize(void) const { return this->_hasClientMax
 
 size_t	ServerConfig::getClientMaxBodySize(void) const { return this->_clientMaxBodySize; }
 
+size_t	ServerConfig::getClientBodyBufferSize(void) const { return this->_clientBodyBufferSize; }
+
 bool	ServerConfig::hasRedirect(void) const { return this->_hasRedirect; }
 
 const Redirect&	ServerConfig::getRedirect(void) const { return this->_redirect; }
@@ -540,3 +710,19 @@ int		ServerConfig::getKeepAliveMax(void) const { return this->_keepAliveMax; }
 bool	ServerConfig::hasAutoindex(void) const { return this->_hasAutoindex; }
 
 bool	ServerConfig::getAutoindex(void) const { return this->_autoindex; }
+
+bool	ServerConfig::hasEventBackend(void) const { return this->_hasEventBackend; }
+
+const std::string&	ServerConfig::getEventBackend(void) const { return this->_eventBackend; }
+
+bool	ServerConfig::hasWorkerProcesses(void) const { return this->_hasWorkerProcesses; }
+
+int		ServerConfig::getWorkerProcesses(void) const { return this->_workerProcesses; }
+
+bool	ServerConfig::getGzip(void) const { return this->_gzip; }
+
+int		ServerConfig::getGzipCompLevel(void) const { return this->_gzipCompLevel; }
+
+size_t	ServerConfig::getGzipMinLength(void) const { return this->_gzipMinLength; }
+
+const std::vector<std::string>&	ServerConfig::getGzipTypes(void) const { return this->_gzipTypes; }
@@ -0,0 +1,151 @@
+#include "UpstreamConfig.hpp"
+#include <cstdlib>
+
+static const int	DEFAULT_MAX_FAILS = 1;
+static const int	DEFAULT_FAIL_TIMEOUT = 10;
+
+/* "host:port" 형식만 검사 (host 해석은 서버 시작 시) */
+static void	checkServerAddress(const std::string& addr)
+{
+	size_t	colon = addr.rfind(':');
+	if (colon == std::string::npos || colon == 0)
+		throw ConfigSyntaxException("Error: upstream server requires host:port: " + addr);
+	std::string	port = addr.substr(colon + 1);
+	if (!isNumber(port))
+		throw ConfigSyntaxException("Error: upstream server port must be a number: " + addr);
+	long	portNum = std::atol(port.c_str());
+	if (portNum <= 0 || portNum > 65535)
+		throw ConfigSemanticException("Error: upstream server port out of range: " + addr);
+}
+
+/* "weight=3" 같은 파라미터 값 */
+static int	parseServerParam(const std::string& param, size_t nameLen, int minValue, int maxValue)
+{
+	std::string	value = param.substr(nameLen);
+	if (!isNumber(value))
+		throw ConfigSyntaxException("Error: upstream server " + param.substr(0, nameLen - 1) + " must be a number");
+	long	n = std::atol(value.c_str());
+	if (n < minValue || n > maxValue)
+		throw ConfigSemanticException("Error: upstream server " + param.substr(0, nameLen - 1) + " out of range");
+	return static_cast<int>(n);
+}
+
+UpstreamConfig::UpstreamConfig(const std::string& name) : _name(name), _balance(BALANCE_ROUND_ROBIN),
+	_hasBalance(false), _hashKey("") {}
+
+UpstreamConfig::~UpstreamConfig(void) {}
+
+UpstreamConfig	UpstreamConfig::single(const std::string& address)
+{
+	UpstreamConfig	upstream(address);
+	Server			server;
+
+	server.address = address;
+	server.weight = 1;
+	server.maxFails = DEFAULT_MAX_FAILS;
+	server.failTimeout = DEFAULT_FAIL_TIMEOUT;
+	upstream._servers.push_back(server);
+	return upstream;
+}
+
+/* 문법: server 127.0.0.1:9001 [weight=N] [max_fails=N] [fail_timeout=초]; */
+void	UpstreamConfig::handleServer(const std::vector<Token>& tokens, size_t& i)
+{
+	i++;
+	if (i >= tokens.size() || tokens[i].type != TOKEN_WORD)
+		throw ConfigSyntaxException("Error: upstream server requires an address");
+
+	Server	server;
+	server.address = tokens[i].value;
+	server.weight = 1;
+	server.maxFails = DEFAULT_MAX_FAILS;
+	server.failTimeout = DEFAULT_FAIL_TIMEOUT;
+	checkServerAddress(server.address);
+	for (size_t j = 0; j < this->_servers.size(); ++j)
+	{
+		if (this->_servers[j].address == server.address)
+			throw ConfigSemanticException("Error: duplicate upstream server: " + server.address);
+	}
+	i++;
+
+	while (i < tokens.size() && tokens[i].type == TOKEN_WORD)
+	{
+		const std::string&	param = tokens[i].value;
+
+		if (param.compare(0, 7, "weight=") == 0)
+			server.weight = parseServerParam(param, 7, 1, 100);
+		else if (param.compare(0, 10, "max_fails=") == 0)
+			server.maxFails = parseServerParam(param, 10, 0, 100);		// 0 = 실패해도 제외하지 않음
+		else if (param.compare(0, 13, "fail_timeout=") == 0)
+			server.failTimeout = parseServerParam(param, 13, 1, 3600);
+		else
+			throw ConfigSyntaxException("Error: unknown upstream server parameter: " + param);
+		i++;
+	}
+	if (i >= tokens.size() || tokens[i].type != TOKEN_SEMICOLON)
+		throw ConfigSyntaxException("Error: missing ';' after upstream server");
+	i++;
+
+	this->_servers.push_back(server);
+}
+
+/* 문법: least_conn; */
+void	UpstreamConfig::handleLeastConn(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasBalance)
+		throw ConfigSemanticException("Error: upstream balancing method already set");
+
+	i++;
+	if (i >= tokens.size() || tokens[i].type != TOKEN_SEMICOLON)
+		throw ConfigSyntaxException("Error: missing ';' after least_conn");
+	i++;
+
+	this->_balance = BALANCE_LEAST_CONN;
+	this->_hasBalance = true;
+}
+
+/* 문법: hash $request_uri;  또는  hash $cookie_sid; */
+void	UpstreamConfig::handleHash(const std::vector<Token>& tokens, size_t& i)
+{
+	if (this->_hasBalance)
+		throw ConfigSemanticException("Error: upstream balancing method already set");
+
+	const Token&	keyToken = directiveSyntaxCheck(tokens, i, "hash");
+	const std::string&	key = keyToken.value;
+
+	if (key != "$request_uri" && (key.compare(0, 8, "$cookie_") != 0 || key.size() == 8))
+		throw ConfigSemanticException("Error: hash key must be $request_uri or $cookie_<name>");
+
+	this->_hashKey = key;
+	this->_balance = BALANCE_HASH;
+	this->_hasBalance = true;
+}
+
+void	UpstreamConfig::parseDirective(const std::vector<Token>& tokens, size_t& i)
+{
+	const std::string&	field = tokens[i].value;
+
+	if (field == "server")
+		handleServer(tokens, i);
+	else if (field == "least_conn")
+		handleLeastConn(tokens, i);
+	else if (field == "hash")
+		handleHash(tokens, i);
+	else
+		throw ConfigSemanticException("Error: Unknown upstream directive: " + field);
+}
+
+void	UpstreamConfig::validateUpstreamBlock(void) const
+{
+	if (this->_servers.empty())
+		throw ConfigSemanticException("Error: upstream " + this->_name + " has no server");
+}
+
+/* getters */
+const std::string&	UpstreamConfig::getName(void) const { return this->_name; }
+
+const std::vector<UpstreamConfig::Server>&	UpstreamConfig::getServers(void) const { return this->_servers; }
+
+UpstreamConfig::Balance	UpstreamConfig::getBalance(void) const { return this->_balance; }
+
+const std::string&	UpstreamConfig::getHashKey(void) const { return this->_hashKey; }
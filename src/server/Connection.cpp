@@ -1,39 +1,289 @@
 #include "Connection.hpp"
 #include <unistd.h>
+#include <cstring>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
-Connection::Connection(int fd)
-: _fd(fd), _state(READING), _outPos(0), _closeAfterWrite(false),
-  _lastActive(std::time(NULL)), _requestsHandled(0),
+Connection::Connection(int fd, unsigned long id)
+: _fd(fd), _id(id), _state(READING), _vhosts(NULL), _req(new HttpRequest), _responseSeq(0), _selected(0),
+  _closeAfterWrite(false), _writeArmed(false),
+  _lastActive(std::time(NULL)), _timerDeadline(0), _requestsHandled(0),
   _readFailStreak(0), _writeFailStreak(0) {}
 
 Connection::~Connection() {
+    while (!_out.empty())
+        popHead();
+    dropResponsesAfter(0);
+    delete _req;
     if (_fd != -1) ::close(_fd);
 }
 
 int Connection::fd() const { return _fd; }
+unsigned long Connection::id() const { return _id; }
 Connection::State Connection::state() const { return _state; }
 
 std::string& Connection::inBuf() { return _in; }
 const std::string& Connection::inBuf() const { return _in; }
 
+const VhostTable* Connection::vhosts() const { return _vhosts; }
+void Connection::setVhosts(const VhostTable* table) { _vhosts = table; }
+
+HttpRequest& Connection::request() { return *_req; }
+void Connection::resetRequest() { _req->reset(); }
+
+Connection::Response::Response()
+: id(0), cgi(NULL), held(NULL), done(false), blocking(false) {}
+
+Connection::Response* Connection::findResponse(unsigned long id) {
+    for (std::deque<Response>::iterator it = _responses.begin(); it != _responses.end(); ++it) {
+        if (it->id == id)
+            return &*it;
+    }
+    return NULL;
+}
+
+const Connection::Response* Connection::findResponse(unsigned long id) const {
+    for (std::deque<Response>::const_iterator it = _responses.begin(); it != _responses.end(); ++it) {
+        if (it->id == id)
+            return &*it;
+    }
+    return NULL;
+}
+
+std::deque<Connection::OutSegment>& Connection::target() {
+    if (_responses.empty() || _responses.front().id == _selected)
+        return _out;
+    Response* r = findResponse(_selected);
+    return (r != NULL) ? r->out : _out;
+}
+
+unsigned long Connection::beginResponse() {
+    _responses.push_back(Response());
+    _responses.back().id = ++_responseSeq;
+    _selected = _responseSeq;
+    return _selected;
+}
+
+void Connection::selectResponse(unsigned long id) { _selected = id; }
+unsigned long Connection::currentResponse() const { return _selected; }
+
+// Finished responses at the front go out in request order; the first one
+// still running becomes the head and from now on writes straight to _out.
+void Connection::endResponse(unsigned long id) {
+    Response* r = findResponse(id);
+    if (r == NULL)
+        return;
+    r->done = true;
+    while (!_responses.empty() && _responses.front().done) {
+        _responses.pop_front();
+        if (_responses.empty())
+            break;
+        std::deque<OutSegment>& waiting = _responses.front().out;
+        for (std::deque<OutSegment>::iterator it = waiting.begin(); it != waiting.end(); ++it) {
+            _out.push_back(OutSegment());
+            OutSegment& seg = _out.back();
+            seg.kind = it->kind;
+            seg.bytes.swap(it->bytes);
+            seg.shared = it->shared;
+            seg.pos = it->pos;
+            seg.fileFd = it->fileFd;
+            seg.fileOffset = it->fileOffset;
+            seg.fileRemaining = it->fileRemaining;
+        }
+        waiting.clear();
+    }
+    if (!_out.empty())
+        _state = WRITING;
+}
+
+void Connection::dropResponsesAfter(unsigned long id) {
+    while (!_responses.empty() && _responses.back().id > id) {
+        Response& r = _responses.back();
+        closeSegments(r.out);
+        delete r.held;
+        _responses.pop_back();
+    }
+}
+
+size_t Connection::openResponses() const { return _responses.size(); }
+
+bool Connection::responseBusy(unsigned long id) const {
+    const Response* r = findResponse(id);
+    return r != NULL && (r->cgi != NULL || r->held != NULL);
+}
+
+unsigned long Connection::firstResponse() const {
+    return _responses.empty() ? 0 : _responses.front().id;
+}
+
+CgiProcess* Connection::responseCgi(unsigned long id) const {
+    const Response* r = findResponse(id);
+    return (r != NULL) ? r->cgi : NULL;
+}
+
+void Connection::setResponseCgi(unsigned long id, CgiProcess* cgi) {
+    Response* r = findResponse(id);
+    if (r != NULL)
+        r->cgi = cgi;
+}
+
+void Connection::collectCgis(std::vector<CgiProcess*>& out) const {
+    for (std::deque<Response>::const_iterator it = _responses.begin(); it != _responses.end(); ++it) {
+        if (it->cgi != NULL)
+            out.push_back(it->cgi);
+    }
+}
+
+void Connection::holdRequest(unsigned long id) {
+    Response* r = findResponse(id);
+    if (r == NULL || r->held != NULL)
+        return;
+    r->held = _req;
+    _req = new HttpRequest;
+}
+
+HttpRequest* Connection::takeHeldRequest(unsigned long id) {
+    Response* r = findResponse(id);
+    if (r == NULL)
+        return NULL;
+    HttpRequest* req = r->held;
+    r->held = NULL;
+    return req;
+}
+
+void Connection::blockPipeline(unsigned long id) {
+    Response* r = findResponse(id);
+    if (r != NULL)
+        r->blocking = true;
+}
+
+bool Connection::pipelineBlocked() const {
+    for (std::deque<Response>::const_iterator it = _responses.begin(); it != _responses.end(); ++it) {
+        if (it->blocking)
+            return true;
+    }
+    return false;
+}
+
+Connection::OutSegment::OutSegment()
+: kind(SEG_OWNED), pos(0), fileFd(-1), fileOffset(0), fileRemaining(0) {}
+
+const char* Connection::OutSegment::data() const {
+    return (kind == SEG_SHARED) ? shared.data() : bytes.data();
+}
+
+size_t Connection::OutSegment::size() const {
+    return (kind == SEG_SHARED) ? shared.size() : bytes.size();
+}
+
 void Connection::queueWrite(const std::string& bytes) {
-    // Clear old data if we've already sent everything
-    if (_outPos > 0 && _outPos == _out.size()) {
-        _out.clear();
-        _outPos = 0;
+    if (bytes.empty())
+        return;
+    std::deque<OutSegment>& out = target();
+    // Coalesce with a trailing owned segment so small writes share one iovec.
+    if (!out.empty() && out.back().kind == SEG_OWNED) {
+        out.back().bytes.append(bytes);
+    } else {
+        out.push_back(OutSegment());
+        out.back().bytes = bytes;
     }
-    _out.append(bytes);
-    if (!_out.empty()) _state = WRITING;
+    _state = WRITING;
 }
 
-bool Connection::hasPendingWrite() const { return _outPos < _out.size(); }
+std::string& Connection::appendBuffer() {
+    std::deque<OutSegment>& out = target();
+    if (out.empty() || out.back().kind != SEG_OWNED) {
+        out.push_back(OutSegment());
+        out.back().bytes.swap(_spare);
+    }
+    _state = WRITING;
+    return out.back().bytes;
+}
+
+void Connection::queueOwned(std::string& bytes) {
+    if (bytes.empty())
+        return;
+    std::deque<OutSegment>& out = target();
+    out.push_back(OutSegment());
+    out.back().bytes.swap(bytes);
+    _state = WRITING;
+}
+
+void Connection::queueShared(const SharedBuffer& buf) {
+    if (buf.size() == 0)
+        return;
+    std::deque<OutSegment>& out = target();
+    out.push_back(OutSegment());
+    out.back().kind = SEG_SHARED;
+    out.back().shared = buf;
+    _state = WRITING;
+}
+
+void Connection::queueFile(int fileFd, off_t offset, size_t length) {
+    if (length == 0) {
+        ::close(fileFd);
+        return;
+    }
+    std::deque<OutSegment>& out = target();
+    out.push_back(OutSegment());
+    OutSegment& seg = out.back();
+    seg.kind = SEG_FILE;
+    seg.fileFd = fileFd;
+    seg.fileOffset = offset;
+    seg.fileRemaining = length;
+    _state = WRITING;
+}
+
+bool Connection::hasPendingWrite() const { return !_out.empty(); }
+
+size_t Connection::segmentBytes(const std::deque<OutSegment>& segs) {
+    size_t total = 0;
+    for (std::deque<OutSegment>::const_iterator it = segs.begin(); it != segs.end(); ++it)
+        total += (it->kind == SEG_FILE) ? it->fileRemaining : it->size() - it->pos;
+    return total;
+}
+
+void Connection::closeSegments(std::deque<OutSegment>& segs) {
+    for (std::deque<OutSegment>::iterator it = segs.begin(); it != segs.end(); ++it) {
+        if (it->kind == SEG_FILE)
+            ::close(it->fileFd);
+    }
+    segs.clear();
+}
+
+size_t Connection::pendingBytes(unsigned long id) const {
+    const Response* r = findResponse(id);
+    if (r == NULL || r == &_responses.front())
+        return segmentBytes(_out);
+    return segmentBytes(r->out);
+}
+
+void Connection::popHead() {
+    static const size_t MAX_SPARE_CAPACITY = 16 * 1024;
+    OutSegment& seg = _out.front();
+
+    if (seg.kind == SEG_FILE)
+        ::close(seg.fileFd);
+    else if (seg.kind == SEG_OWNED && seg.bytes.capacity() <= MAX_SPARE_CAPACITY
+             && seg.bytes.capacity() > _spare.capacity()) {
+        // Keep the header-sized buffer around so the next response reuses it.
+        seg.bytes.clear();
+        seg.bytes.swap(_spare);
+    }
+    _out.pop_front();
+}
+
+bool Connection::writeArmed() const { return _writeArmed; }
+void Connection::setWriteArmed(bool armed) { _writeArmed = armed; }
 
 void Connection::closeAfterWrite() {
     _closeAfterWrite = true;
     // If there is nothing left to write, close immediately so the connection
     // does not depend on a future onWritable() call that may never happen.
-    if (!hasPendingWrite() && _fd != -1) {
+    if (!hasPendingWrite() && _responses.empty() && _fd != -1) {
         ::close(_fd);
         _fd = -1;
     }
@@ -43,12 +293,15 @@ bool Connection::shouldCloseAfterWrite() const { return _closeAfterWrite; }
 void Connection::touch() { _lastActive = std::time(NULL); }
 std::time_t Connection::lastActive() const { return _lastActive; }
 
+std::time_t Connection::timerDeadline() const { return _timerDeadline; }
+void Connection::setTimerDeadline(std::time_t deadline) { _timerDeadline = deadline; }
+
 void Connection::incRequestCount() { ++_requestsHandled; }
 int Connection::requestCount() const { return _requestsHandled; }
 
 bool Connection::onReadable() {
-    // Must be large enough to return 413 for body-limit violations instead of
-    // dropping the connection before request validation.
+    // The parser drains _in after every read, so this only bounds bytes that
+    // are not being consumed (e.g. while a close is pending).
     static const size_t MAX_INPUT_SIZE = (10 * 1024 * 1024) + (64 * 1024);
     static const int MAX_FAIL_STREAK = 3;
 
@@ -76,40 +329,121 @@ bool Connection::onReadable() {
     return true;
 }
 
-bool Connection::onWritable() {
-    static const int MAX_FAIL_STREAK = 3;
+// Sends as much of the head of the queue as the socket takes in one syscall.
+// Returns WRITE_OK when everything attempted went out (the caller may try the
+// next segment), WRITE_PARTIAL when the socket buffer filled up, WRITE_RETRY
+// on a failed syscall and WRITE_FATAL when a file range can never complete.
+Connection::WriteResult Connection::writeHead() {
+    if (_out.front().kind == SEG_FILE)
+        return writeFile();
+    return writeMemory();
+}
 
-    if (_outPos >= _out.size()) {
-        _out.clear();
-        _outPos = 0;
-        if (_closeAfterWrite) return false;
-        _state = READING;
-        return true;
+// Gathers the run of memory segments at the head (headers, bodies, and
+// whole pipelined responses) into one sendmsg() call.
+Connection::WriteResult Connection::writeMemory() {
+    struct iovec iov[MAX_IOV];
+    int count = 0;
+
+    for (std::deque<OutSegment>::iterator it = _out.begin();
+         it != _out.end() && it->kind != SEG_FILE && count < MAX_IOV; ++it) {
+        iov[count].iov_base = const_cast<char*>(it->data() + it->pos);
+        iov[count].iov_len = it->size() - it->pos;
+        ++count;
     }
 
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
     int flags = 0;
 #ifdef MSG_NOSIGNAL
     flags |= MSG_NOSIGNAL;
 #endif
+    ssize_t n = ::sendmsg(_fd, &msg, flags);
+    if (n < 0)
+        return WRITE_RETRY;
 
-    ssize_t n = ::send(_fd, _out.data() + _outPos, _out.size() - _outPos, flags);
+    size_t sent = static_cast<size_t>(n);
+    while (sent > 0) {
+        OutSegment& seg = _out.front();
+        size_t left = seg.size() - seg.pos;
+        if (sent < left) {
+            seg.pos += sent;
+            return WRITE_PARTIAL;
+        }
+        sent -= left;
+        popHead();
+    }
+    return WRITE_OK;
+}
+
+// File range: the body goes kernel -> socket without entering user space.
+Connection::WriteResult Connection::writeFile() {
+    static const size_t MAX_FILE_CHUNK = 1024 * 1024;
+    OutSegment& seg = _out.front();
+    ssize_t n;
+
+    size_t want = seg.fileRemaining < MAX_FILE_CHUNK ? seg.fileRemaining : MAX_FILE_CHUNK;
+#ifdef __linux__
+    n = ::sendfile(_fd, seg.fileFd, &seg.fileOffset, want);
+#else
+    char buf[65536];
+    if (want > sizeof(buf)) want = sizeof(buf);
+    n = ::pread(seg.fileFd, buf, want, seg.fileOffset);
     if (n > 0) {
+        n = ::send(_fd, buf, static_cast<size_t>(n), 0);
+        if (n > 0) seg.fileOffset += n;
+    }
+#endif
+    if (n < 0)
+        return WRITE_RETRY;
+    if (n == 0)
+        return WRITE_FATAL;
+    seg.fileRemaining -= static_cast<size_t>(n);
+    if (seg.fileRemaining != 0)
+        return WRITE_PARTIAL; // one chunk per wakeup so large files do not starve others
+    popHead();
+    return WRITE_OK;
+}
+
+bool Connection::onWritable() {
+    static const int MAX_FAIL_STREAK = 3;
+
+    if (_out.empty()) {
+        if (_closeAfterWrite && _responses.empty()) return false;
+        _state = READING;
+        return true;
+    }
+
+    // Keep going while whole runs complete (e.g. headers+body, then a file);
+    // a partial write means the socket buffer is full.
+    WriteResult r;
+    bool progressed = false;
+    do {
+        r = writeHead();
+        if (r == WRITE_OK || r == WRITE_PARTIAL)
+            progressed = true;
+    } while (r == WRITE_OK && !_out.empty());
+
+    if (r == WRITE_FATAL)
+        return false;
+    if (progressed) {
         _writeFailStreak = 0;
-        _outPos += static_cast<size_t>(n);
         touch();
-    } else if (n < 0) {
-        // n < 0: do not branch on errno after send. Close only after repeated failures.
+    } else {
+        // Do not branch on errno after send. Close only after repeated failures.
         _writeFailStreak++;
         if (_writeFailStreak >= MAX_FAIL_STREAK)
             return false;
     }
 
-    if (_outPos < _out.size())
+    if (!_out.empty())
         return true;
 
-    _out.clear();
-    _outPos = 0;
-    if (_closeAfterWrite) return false;
+    // Earlier responses still running: later ones are parked until they finish.
+    if (_closeAfterWrite && _responses.empty()) return false;
     _state = READING;
     return true;
 }
@@ -0,0 +1,165 @@
+#include "EventLoop.hpp"
+#include <unistd.h>
+#include <stdexcept>
+
+EventLoop::EventLoop(Backend backend)
+: _backend(backend), _epfd(-1) {
+    if (!isAvailable(_backend))
+        throw std::runtime_error("event backend not available on this platform");
+#ifdef WEBSERV_HAVE_EPOLL
+    if (_backend == BACKEND_EPOLL) {
+        _epfd = ::epoll_create(1024);
+        if (_epfd < 0)
+            throw std::runtime_error("epoll_create failed");
+        _epEvents.resize(1024);
+    }
+#endif
+}
+
+EventLoop::~EventLoop() {
+    if (_epfd != -1) ::close(_epfd);
+}
+
+EventLoop::Backend EventLoop::defaultBackend() {
+#ifdef WEBSERV_HAVE_EPOLL
+    return BACKEND_EPOLL;
+#else
+    return BACKEND_POLL;
+#endif
+}
+
+bool EventLoop::isAvailable(Backend backend) {
+#ifdef WEBSERV_HAVE_EPOLL
+    return backend == BACKEND_POLL || backend == BACKEND_EPOLL;
+#else
+    return backend == BACKEND_POLL;
+#endif
+}
+
+EventLoop::Backend EventLoop::backend() const { return _backend; }
+
+const char* EventLoop::backendName() const {
+    return (_backend == BACKEND_EPOLL) ? "epoll" : "poll";
+}
+
+short EventLoop::toPollEvents(int events) {
+    short e = 0;
+    if (events & EVENT_READ) e |= POLLIN;
+    if (events & EVENT_WRITE) e |= POLLOUT;
+    return e;
+}
+
+int EventLoop::fromPollEvents(short revents) {
+    int e = 0;
+    if (revents & POLLIN) e |= EVENT_READ;
+    if (revents & POLLOUT) e |= EVENT_WRITE;
+    if (revents & (POLLERR | POLLHUP | POLLNVAL)) e |= EVENT_ERROR;
+    return e;
+}
+
+void EventLoop::add(int fd, int events) {
+#ifdef WEBSERV_HAVE_EPOLL
+    if (_backend == BACKEND_EPOLL) {
+        epoll_event ev;
+        ev.events = 0;
+        if (events & EVENT_READ) ev.events |= EPOLLIN;
+        if (events & EVENT_WRITE) ev.events |= EPOLLOUT;
+        ev.data.u64 = 0;
+        ev.data.fd = fd;
+        if (::epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            throw std::runtime_error("epoll_ctl(ADD) failed");
+        return;
+    }
+#endif
+    if (fd >= static_cast<int>(_pollIndex.size()))
+        _pollIndex.resize(fd + 1, -1);
+    if (_pollIndex[fd] != -1) {
+        modify(fd, events);
+        return;
+    }
+    pollfd p;
+    p.fd = fd;
+    p.events = toPollEvents(events);
+    p.revents = 0;
+    _pollIndex[fd] = static_cast<int>(_pfds.size());
+    _pfds.push_back(p);
+}
+
+void EventLoop::modify(int fd, int events) {
+#ifdef WEBSERV_HAVE_EPOLL
+    if (_backend == BACKEND_EPOLL) {
+        epoll_event ev;
+        ev.events = 0;
+        if (events & EVENT_READ) ev.events |= EPOLLIN;
+        if (events & EVENT_WRITE) ev.events |= EPOLLOUT;
+        ev.data.u64 = 0;
+        ev.data.fd = fd;
+        ::epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev);
+        return;
+    }
+#endif
+    if (fd < 0 || fd >= static_cast<int>(_pollIndex.size()) || _pollIndex[fd] == -1)
+        return;
+    _pfds[_pollIndex[fd]].events = toPollEvents(events);
+}
+
+void EventLoop::remove(int fd) {
+#ifdef WEBSERV_HAVE_EPOLL
+    if (_backend == BACKEND_EPOLL) {
+        // 이미 close된 fd면 EBADF: 커널이 자동으로 제거했으므로 무시
+        epoll_event ev;
+        ::epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, &ev);
+        return;
+    }
+#endif
+    if (fd < 0 || fd >= static_cast<int>(_pollIndex.size()) || _pollIndex[fd] == -1)
+        return;
+    // 마지막 원소와 swap 후 pop: O(1) 제거
+    size_t idx = static_cast<size_t>(_pollIndex[fd]);
+    size_t last = _pfds.size() - 1;
+    if (idx != last) {
+        _pfds[idx] = _pfds[last];
+        _pollIndex[_pfds[idx].fd] = static_cast<int>(idx);
+    }
+    _pfds.pop_back();
+    _pollIndex[fd] = -1;
+}
+
+int EventLoop::wait(std::vector<Event>& out, int timeoutMs) {
+    out.clear();
+#ifdef WEBSERV_HAVE_EPOLL
+    if (_backend == BACKEND_EPOLL) {
+        int n = ::epoll_wait(_epfd, &_epEvents[0], static_cast<int>(_epEvents.size()), timeoutMs);
+        if (n <= 0)
+            return n;
+        for (int i = 0; i < n; ++i) {
+            Event e;
+            e.fd = _epEvents[i].data.fd;
+            e.events = 0;
+            if (_epEvents[i].events & EPOLLIN) e.events |= EVENT_READ;
+            if (_epEvents[i].events & EPOLLOUT) e.events |= EVENT_WRITE;
+            if (_epEvents[i].events & (EPOLLERR | EPOLLHUP)) e.events |= EVENT_ERROR;
+            out.push_back(e);
+        }
+        return n;
+    }
+#endif
+    if (_pfds.empty()) {
+        // 감시할 fd가 없어도 timeout 만큼은 대기
+        int n = ::poll(NULL, 0, timeoutMs);
+        return n < 0 ? n : 0;
+    }
+    int n = ::poll(&_pfds[0], _pfds.size(), timeoutMs);
+    if (n <= 0)
+        return n;
+    for (size_t i = 0; i < _pfds.size() && static_cast<int>(out.size()) < n; ++i) {
+        if (_pfds[i].revents == 0)
+            continue;
+        Event e;
+        e.fd = _pfds[i].fd;
+        e.events = fromPollEvents(_pfds[i].revents);
+        _pfds[i].revents = 0;
+        out.push_back(e);
+    }
+    return static_cast<int>(out.size());
+}
@@ -0,0 +1,147 @@
+#include "Master.hpp"
+#include "Server.hpp"
+#include "ResponseCache.hpp"
+#include <iostream>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static volatile sig_atomic_t g_stopRequested = 0;
+
+static void onStopSignal(int) {
+    g_stopRequested = 1;
+}
+
+Master::Master(const std::vector<ServerConfig>& cfgs)
+: _configs(cfgs) {}
+
+Master::~Master() {}
+
+int Master::resolveWorkerCount() const {
+    int n = _configs[0].getWorkerProcesses();
+    if (n == 0) {
+        long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+        n = (cpus > 0) ? static_cast<int>(cpus) : 1;
+    }
+    return n;
+}
+
+pid_t Master::spawnWorker(int id) {
+    std::cout.flush(); // fork 후 버퍼가 중복 출력되지 않도록
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        // worker: master의 signal 설정을 기본값으로 되돌리고 자기 event loop 실행
+        std::signal(SIGTERM, SIG_DFL);
+        std::signal(SIGINT, SIG_DFL);
+        try {
+            Server server(_configs, true, resolveWorkerCount());
+            std::cout << "Worker " << id << " started (pid=" << ::getpid() << ")\n";
+            server.run();
+        } catch (const std::exception& e) {
+            std::cerr << "Worker " << id << " error: " << e.what() << std::endl;
+            std::exit(1);
+        }
+        std::exit(0);
+    }
+    return pid;
+}
+
+void Master::stopWorkers() {
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i] > 0)
+            ::kill(_workers[i], SIGTERM);
+    }
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        if (_workers[i] > 0) {
+            int status;
+            while (::waitpid(_workers[i], &status, 0) < 0 && errno == EINTR)
+                ;
+        }
+    }
+    _workers.clear();
+}
+
+// 응답 캐시 인덱스는 worker 메모리에만 있으므로 이전 실행(또는 죽은 worker)의 파일은 쓸 수 없다
+bool Master::prepareResponseCaches(pid_t owner) const {
+    std::set<std::string> dirs;
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<LocationConfig>& locs = _configs[i].getLocations();
+        for (size_t j = 0; j < locs.size(); ++j) {
+            if (locs[j].hasCachePath())
+                dirs.insert(locs[j].getCachePath());
+        }
+    }
+    for (std::set<std::string>::const_iterator it = dirs.begin(); it != dirs.end(); ++it) {
+        if (!ResponseCache::purge(*it, owner)) {
+            std::cerr << "cache_path " << *it << ": not a writable directory" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int Master::run() {
+    if (!prepareResponseCaches(0))
+        return 1;
+
+    int count = resolveWorkerCount();
+    if (count <= 1) {
+        Server server(_configs);
+        server.run();
+        return 0;
+    }
+
+    // SA_RESTART 없이 설치: waitpid가 EINTR로 깨어나 종료 요청을 확인할 수 있도록
+    struct sigaction sa;
+    sa.sa_handler = onStopSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    for (int i = 0; i < count; ++i) {
+        pid_t pid = spawnWorker(i);
+        if (pid < 0) {
+            stopWorkers();
+            return 1;
+        }
+        _workers.push_back(pid);
+    }
+    std::cout << "Master " << ::getpid() << ": " << count << " workers\n";
+
+    while (!g_stopRequested) {
+        int status;
+        pid_t pid = ::waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t i = 0; i < _workers.size(); ++i) {
+            if (_workers[i] != pid)
+                continue;
+            // 설정/bind 실패 같은 정상 종료(exit != 0)는 재시작해도 반복되므로 전체 종료
+            if (WIFEXITED(status)) {
+                std::cerr << "Worker " << i << " exited with status "
+                          << WEXITSTATUS(status) << std::endl;
+                _workers[i] = -1;
+                stopWorkers();
+                return 1;
+            }
+            // signal로 죽은 worker는 같은 id로 재시작
+            std::cerr << "Worker " << i << " killed by signal "
+                      << WTERMSIG(status) << ", respawning" << std::endl;
+            prepareResponseCaches(pid);
+            _workers[i] = spawnWorker(static_cast<int>(i));
+        }
+    }
+    stopWorkers();
+    return 0;
+}
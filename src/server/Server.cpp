@@ -4,11 +4,17 @@
 #include "Router.hpp"
 #include "GetHandler.hpp"
 #include "PostHandler.hpp"
+#include "MultipartParser.hpp"
 #include "DeleteHandler.hpp"
 #include "CgiHandler.hpp"
+#include "FastCgi.hpp"
+#include "ProxyHandler.hpp"
 #include "ErrorHandler.hpp"
+#include "GzipFilter.hpp"
 #include <iostream>
 #include <cstring>
+#include <strings.h>
+#include <cstdio>
 #include <cstdlib>
 #include <unistd.h>
 #include <arpa/inet.h>
@@ -18,6 +24,36 @@
 #include <cerrno>
 #include <sstream>
 #include <cctype>
+#include <csignal>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+// 세션 정리는 연결 timeout과 달리 느슨해도 되므로 주기적으로만
+static const int SESSION_TTL_SEC = 300;
+static const int SESSION_SWEEP_INTERVAL_SEC = 60;
+
+// CGI가 아무 출력 없이 이 시간 동안 멈춰 있으면 504
+static const int CGI_TIMEOUT_SEC = 30;
+// 헤더 끝을 찾지 못한 채 쌓을 수 있는 CGI 출력 한도
+static const size_t CGI_HEADER_MAX = 64 * 1024;
+// 클라이언트 출력 큐가 이만큼 쌓이면 CGI stdout 읽기를 멈춘다 (절반 아래로 줄면 재개)
+static const size_t CGI_PENDING_MAX = 256 * 1024;
+// 한 연결에서 동시에 진행할 pipelined 요청 수 (응답을 기다리는 CGI / upstream 요청 포함)
+static const size_t PIPELINE_MAX = 16;
+// worker당 upstream 주소마다 보관할 idle 연결 수
+// php-fpm은 연결 하나가 worker 하나를 점유하므로 적게, HTTP upstream은 넉넉하게
+static const size_t FASTCGI_KEEPALIVE = 8;
+static const size_t PROXY_KEEPALIVE = 32;
+
+// SIGCHLD -> event loop 전달용 self-pipe (handler에서는 1바이트 write만)
+static int g_sigchldPipe[2] = { -1, -1 };
+
+static void onSigchld(int) {
+    int saved = errno;
+    ssize_t n = ::write(g_sigchldPipe[1], "c", 1);
+    (void)n;
+    errno = saved;
+}
 
 static void fatal(const char* msg) {
     perror(msg);
@@ -31,10 +67,10 @@ static std::string stripQueryString(const std::string& uri) {
     return uri.substr(0, qpos);
 }
 
-static std::string toLowerAscii(std::string s) {
-    for (size_t i = 0; i < s.size(); ++i)
-        s[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(s[i])));
-    return s;
+static std::string requestAcceptEncoding(const HttpRequest& req) {
+    const std::map<std::string, std::string>& headers = req.getHeaders();
+    std::map<std::string, std::string>::const_iterator it = headers.find("accept-encoding");
+    return (it != headers.end()) ? it->second : std::string();
 }
 
 static bool hasMethod(const std::vector<std::string>& methods, const std::string& method) {
@@ -47,8 +83,9 @@ static bool hasMethod(const std::vector<std::string>& methods, const std::string
 
 static std::vector<std::string> normalizeConfiguredMethods(const std::vector<std::string>& configured) {
     std::vector<std::string> allowed;
-    // Project policy: GET is always allowed.
+    // Project policy: GET (and HEAD with it) is always allowed.
     allowed.push_back("GET");
+    allowed.push_back("HEAD");
     if (hasMethod(configured, "POST"))
         allowed.push_back("POST");
     if (hasMethod(configured, "DELETE"))
@@ -70,13 +107,14 @@ static std::vector<std::string> resolveAllowedMethods(const LocationConfig* loc,
 
     std::vector<std::string> defaults;
     defaults.push_back("GET");
+    defaults.push_back("HEAD");
     return defaults;
 }
 
 static std::string buildAllowHeaderValue(const std::vector<std::string>& allowed) {
     std::string value;
     if (hasMethod(allowed, "GET"))
-        value += "GET";
+        value += "GET, HEAD";
     if (hasMethod(allowed, "POST")) {
         if (!value.empty()) value += ", ";
         value += "POST";
@@ -100,24 +138,55 @@ static bool locationHasCgiForUri(const LocationConfig& loc, const std::string& u
     return pass.find(ext) != pass.end();
 }
 
-static bool exceedsClientMaxBodySize(const HttpRequest& req, size_t maxBodySize) {
-    const std::map<std::string, std::string>& headers = req.getHeaders();
-    std::map<std::string, std::string>::const_iterator clIt = headers.find("content-length");
-    if (clIt != headers.end()) {
-        std::istringstream iss(clIt->second);
-        size_t contentLen = 0;
-        iss >> contentLen;
-        if (!iss.fail() && contentLen > maxBodySize)
-            return true;
+// 응답 캐시 키: Host(소문자) + 요청 URI (쿼리 포함)
+// 메서드는 넣지 않는다: 캐시에는 GET 응답만 저장되고 (HEAD는 beginFlight에서 저장하지 않음)
+// HEAD는 같은 키의 GET 항목으로 헤더만 보낸다
+static std::string responseCacheKey(const HttpRequest& req) {
+    std::string key;
+    std::map<std::string, std::string>::const_iterator it = req.getHeaders().find("host");
+    if (it != req.getHeaders().end()) {
+        key = it->second;
+        for (size_t i = 0; i < key.size(); ++i)
+            key[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(key[i])));
     }
-    return req.getBody().size() > maxBodySize;
+    return key + req.getURI();
 }
 
-Server::Server(const std::vector<ServerConfig>& cfgs)
-: _configs(cfgs), _sidSeq(1) {
+// 응답을 캐시하거나 같은 요청끼리 나눠 가질 수 있는 요청:
+// cache_path를 둔 CGI / FastCGI / proxy location의 바디 없는 GET / HEAD
+// (응답을 여러 클라이언트가 나눠 가져도 된다는 설정은 cache_path뿐이다)
+// Authorization / Cookie가 있는 요청은 사용자별 응답일 수 있어 제외
+// (backend가 Vary: Cookie를 보내지 않는 세션 페이지도 있다)
+static bool isSharedRequest(const LocationConfig& loc, const HttpRequest& req) {
+    if (!loc.hasCachePath())
+        return false;
+    if (req.getMethod() != "GET" && req.getMethod() != "HEAD")
+        return false;
+    const std::map<std::string, std::string>& headers = req.getHeaders();
+    if (req.getBodySize() != 0 || headers.count("authorization") || headers.count("cookie"))
+        return false;
+    return loc.hasProxyPass() || loc.hasFastCgiPass() || locationHasCgiForUri(loc, req.getURI());
+}
+
+static EventLoop::Backend selectEventBackend(const std::vector<ServerConfig>& cfgs) {
+    if (cfgs.empty() || !cfgs[0].hasEventBackend())
+        return EventLoop::defaultBackend();
+    if (cfgs[0].getEventBackend() == "poll")
+        return EventLoop::BACKEND_POLL;
+    return EventLoop::BACKEND_EPOLL;
+}
+
+Server::Server(const std::vector<ServerConfig>& cfgs, bool reusePort, int workerCount)
+: _configs(cfgs), _reusePort(reusePort), _loop(selectEventBackend(cfgs)),
+  _connSeq(1), _sigchldFd(-1), _sidSeq(1),
+  _nextSessionSweep(std::time(NULL) + SESSION_SWEEP_INTERVAL_SEC),
+  _statAccepted(0), _statRequests(0), _statCoalesced(0) {
     if (_configs.empty())
         throw std::runtime_error("No server config provided");
 
+    // 끊긴 소켓에 sendfile/send 해도 프로세스가 죽지 않도록
+    std::signal(SIGPIPE, SIG_IGN);
+
     // listen 포트 수집 (중복 제거)
     std::set<int> ports;
     for (size_t i = 0; i < _configs.size(); ++i) {
@@ -127,6 +196,76 @@ Server::Server(const std::vector<ServerConfig>& cfgs)
     if (ports.empty())
         throw std::runtime_error("No listen port configured");
 
+    // 포트별 virtual host 테이블: 설정 순서대로 등록해 첫 블록이 기본 server
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<int> ps = _configs[i].getListenPorts();
+        for (size_t j = 0; j < ps.size(); ++j) {
+            VhostTable& table = _vhostsByPort[ps[j]];
+            table.setDefault(&_configs[i]);
+            if (!_configs[i].hasServerNames())
+                continue;
+            const std::vector<std::string>& names = _configs[i].getServerNames();
+            for (size_t k = 0; k < names.size(); ++k)
+                table.add(names[k], &_configs[i]);
+        }
+    }
+
+    // location 라우팅 테이블: _configs는 이후 바뀌지 않으므로 포인터를 그대로 보관
+    _routers.reserve(_configs.size());
+    for (size_t i = 0; i < _configs.size(); ++i)
+        _routers.push_back(Router(_configs[i].getLocations()));
+
+    // 정적 파일 캐시: location마다 독립된 LRU (크기 설정도 location 단위)
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<LocationConfig>& locs = _configs[i].getLocations();
+        for (size_t j = 0; j < locs.size(); ++j) {
+            if (locs[j].hasFileCache())
+                _fileCaches[&locs[j]] = new FileCache(locs[j].getFileCacheSize(),
+                                                      locs[j].getFileCacheMaxEntry());
+        }
+    }
+
+    // 응답 디스크 캐시: 같은 cache_path를 쓰는 location끼리 인덱스 공유 (한도는 가장 큰 cache_max_size)
+    // 인덱스는 worker마다 따로이므로 한도를 worker 수로 나눈다 (디렉터리 전체가 cache_max_size 이하)
+    std::map<std::string, size_t> cacheSizes;
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<LocationConfig>& locs = _configs[i].getLocations();
+        for (size_t j = 0; j < locs.size(); ++j) {
+            if (!locs[j].hasCachePath())
+                continue;
+            size_t& size = cacheSizes[locs[j].getCachePath()];
+            if (locs[j].getCacheMaxSize() > size)
+                size = locs[j].getCacheMaxSize();
+        }
+    }
+    for (std::map<std::string, size_t>::iterator it = cacheSizes.begin(); it != cacheSizes.end(); ++it)
+        _responseCaches[it->first] = new ResponseCache(it->first,
+                                                       it->second / (workerCount > 0 ? workerCount : 1));
+
+    // fastcgi_pass 연결 풀: 같은 주소를 쓰는 location끼리 공유
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<LocationConfig>& locs = _configs[i].getLocations();
+        for (size_t j = 0; j < locs.size(); ++j) {
+            if (!locs[j].hasFastCgiPass())
+                continue;
+            const std::string& addr = locs[j].getFastCgiPass();
+            if (_fastCgiPools.find(addr) == _fastCgiPools.end())
+                _fastCgiPools[addr] = new UpstreamPool(addr, FASTCGI_KEEPALIVE);
+        }
+    }
+
+    // proxy_pass upstream 그룹: 같은 upstream(또는 주소)을 쓰는 location끼리 backend 상태와 풀을 공유
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<LocationConfig>& locs = _configs[i].getLocations();
+        for (size_t j = 0; j < locs.size(); ++j) {
+            if (!locs[j].hasProxyPass())
+                continue;
+            const std::string& name = locs[j].getProxyPass();
+            if (_upstreamGroups.find(name) == _upstreamGroups.end())
+                _upstreamGroups[name] = new UpstreamGroup(locs[j].getUpstream(), PROXY_KEEPALIVE);
+        }
+    }
+
     // server-level runtime tuning values (use first server block as global runtime policy)
     _maxConnections = _configs[0].getMaxConnections();
     _idleTimeoutSec = _configs[0].getIdleTimeout();
@@ -141,12 +280,7 @@ Server::Server(const std::vector<ServerConfig>& cfgs)
         _listenFds.push_back(fd);
         _listenFdSet.insert(fd);
         _listenFdToPort[fd] = port;
-
-        pollfd p;
-        p.fd = fd;
-        p.events = POLLIN;
-        p.revents = 0;
-        _pfds.push_back(p);
+        _loop.add(fd, EventLoop::EVENT_READ);
 
         // 첫 포트는 기존 코드 호환성/로깅용으로 저장
         if (it == ports.begin())
@@ -154,6 +288,22 @@ Server::Server(const std::vector<ServerConfig>& cfgs)
 
         std::cout << "Listening on port " << port << "\n";
     }
+
+    // CGI 종료는 waitpid를 signal handler가 아닌 loop에서 (WNOHANG)
+    if (::pipe(g_sigchldPipe) < 0) fatal("pipe");
+    setNonBlocking(g_sigchldPipe[0]);
+    setNonBlocking(g_sigchldPipe[1]);
+    _sigchldFd = g_sigchldPipe[0];
+    _loop.add(_sigchldFd, EventLoop::EVENT_READ);
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSigchld;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    if (::sigaction(SIGCHLD, &sa, NULL) < 0) fatal("sigaction");
+
+    std::cout << "Event backend: " << _loop.backendName() << "\n";
 }
 
 Server::~Server() {
@@ -161,6 +311,50 @@ Server::~Server() {
         delete it->second;
     _conns.clear();
 
+    // 남은 CGI는 기다리지 않고 정리
+    for (std::map<pid_t, CgiProcess*>::iterator it = _cgiByPid.begin(); it != _cgiByPid.end(); ++it) {
+        CgiProcess* p = it->second;
+        if (!p->exited) ::kill(p->pid, SIGKILL);
+        if (p->inFd != -1) ::close(p->inFd);
+        if (p->outFd != -1) ::close(p->outFd);
+        delete p;
+    }
+    _cgiByPid.clear();
+    // FastCGI / proxy 요청은 _cgiByPid에 없으므로 fd 쪽에서 정리
+    for (std::map<int, CgiProcess*>::iterator it = _cgiByFd.begin(); it != _cgiByFd.end(); ++it) {
+        if (it->second->pid != -1)
+            continue;
+        ::close(it->first);
+        delete it->second;
+    }
+    _cgiByFd.clear();
+    for (std::map<std::string, UpstreamPool*>::iterator it = _fastCgiPools.begin();
+         it != _fastCgiPools.end(); ++it)
+        delete it->second;
+    _fastCgiPools.clear();
+    for (std::map<std::string, UpstreamGroup*>::iterator it = _upstreamGroups.begin();
+         it != _upstreamGroups.end(); ++it)
+        delete it->second;
+    _upstreamGroups.clear();
+    _upstreamIdle.clear();
+
+    std::signal(SIGCHLD, SIG_DFL);
+    for (int i = 0; i < 2; ++i) {
+        if (g_sigchldPipe[i] != -1) ::close(g_sigchldPipe[i]);
+        g_sigchldPipe[i] = -1;
+    }
+
+    for (std::map<const LocationConfig*, FileCache*>::iterator it = _fileCaches.begin();
+         it != _fileCaches.end(); ++it)
+        delete it->second;
+    _fileCaches.clear();
+
+    // 남은 CgiProcess가 저장 중이던 파일을 먼저 정리한 뒤 (위에서 delete)
+    for (std::map<std::string, ResponseCache*>::iterator it = _responseCaches.begin();
+         it != _responseCaches.end(); ++it)
+        delete it->second;
+    _responseCaches.clear();
+
     for (size_t i = 0; i < _listenFds.size(); ++i) {
         if (_listenFds[i] != -1) ::close(_listenFds[i]);
     }
@@ -173,6 +367,11 @@ int Server::createListenSocket(int port) {
     int opt = 1;
     if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
         fatal("setsockopt");
+#ifdef SO_REUSEPORT
+    // worker마다 같은 포트에 리스너를 열고 커널이 accept를 분산
+    if (_reusePort && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+        fatal("setsockopt(SO_REUSEPORT)");
+#endif
 
     sockaddr_in addr;
     std::memset(&addr, 0, sizeof(addr));
@@ -189,36 +388,43 @@ void Server::setNonBlocking(int fd) {
     int flags = ::fcntl(fd, F_GETFL, 0);
     if (flags < 0) fatal("fcntl(F_GETFL)");
     if (::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) fatal("fcntl(F_SETFL)");
+    // CGI 자식에게 소켓/pipe가 상속되지 않도록
+    if (::fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) fatal("fcntl(F_SETFD)");
 }
 
 void Server::run() {
     while (true) {
         sweepTimeouts();
 
-        int ready = ::poll(&_pfds[0], _pfds.size(), 1000); // 1s tick
+        // 고정 tick 대신 가장 가까운 deadline까지만 대기
+        int ready = _loop.wait(_events, nextWaitTimeoutMs());
         if (ready < 0) {
             if (errno == EINTR) continue;
-            fatal("poll");
-        }
-        if (ready == 0) continue;
-
-        for (size_t i = 0; i < _pfds.size(); /* increment inside */) {
-            if (_pfds[i].revents == 0) { ++i; continue; }
-
-        if (isListenFd(_pfds[i].fd)) {
-            if (_pfds[i].revents & POLLIN) acceptLoop(_pfds[i].fd);
-            _pfds[i].revents = 0;
-            ++i;
-            continue;
+            fatal("event wait");
         }
 
-            handleClientEvent(i);
-            // handleClientEvent may remove current index; safest is to just continue without ++i if removed
-            // We'll detect by checking i within bounds and revents reset.
-            if (i < _pfds.size() && _pfds[i].revents == 0) ++i;
+        // ready 이벤트만 순회: O(ready)
+        for (size_t i = 0; i < _events.size(); ++i) {
+            const EventLoop::Event& ev = _events[i];
+            if (isListenFd(ev.fd)) {
+                if (ev.events & EventLoop::EVENT_READ) acceptLoop(ev.fd);
+                continue;
+            }
+            if (ev.fd == _sigchldFd) {
+                reapChildren();
+                continue;
+            }
+            std::map<int, CgiProcess*>::iterator cit = _cgiByFd.find(ev.fd);
+            if (cit != _cgiByFd.end()) {
+                handleCgiEvent(cit->second, ev.fd, ev.events);
+                continue;
+            }
+            if (_upstreamIdle.find(ev.fd) != _upstreamIdle.end()) {
+                handleUpstreamIdleEvent(ev.fd);
+                continue;
+            }
+            handleClientEvent(ev.fd, ev.events);
         }
-
-        for (size_t k = 0; k < _pfds.size(); ++k) _pfds[k].revents = 0;
     }
 }
 
@@ -238,115 +444,52 @@ void Server::acceptLoop(int listenFd) {
 
         setNonBlocking(cfd);
 
-        Connection* conn = new Connection(cfd);
+        Connection* conn = new Connection(cfd, _connSeq++);
         _conns[cfd] = conn;
-        _clientPort[cfd] = _listenFdToPort[listenFd];
+        scheduleConnTimer(conn);
+        ++_statAccepted;
+        conn->setVhosts(&_vhostsByPort[_listenFdToPort[listenFd]]);
 
-        pollfd p;
-        p.fd = cfd;
-        p.events = POLLIN; // start with read
-        p.revents = 0;
-        _pfds.push_back(p);
+        _loop.add(cfd, EventLoop::EVENT_READ); // start with read
 
         std::cout << "Accepted fd=" << cfd << "\n";
     }
 }
 
 // CHECK)
-void    Server::handleClientEvent(size_t idx)
+void    Server::handleClientEvent(int fd, int ev)
 {
-    int fd = _pfds[idx].fd;
     Connection* conn = 0;
 
     std::map<int, Connection*>::iterator it = _conns.find(fd);
     if (it == _conns.end()) {
-        removeConn(fd);
+        // 같은 배치에서 이미 닫힌 fd의 stale 이벤트
+        _loop.remove(fd);
         return;
     }
     conn = it->second;
 
-    short ev = _pfds[idx].revents;
-
-    if (ev & (POLLERR | POLLHUP | POLLNVAL)) {
+    if (ev & EventLoop::EVENT_ERROR) {
         removeConn(fd);
         return;
     }
 
-    if (ev & POLLIN) {
+    if (ev & EventLoop::EVENT_READ) {
         if (!conn->onReadable()) { removeConn(fd); return; }
 
-        // =====================================================
-        // [HTTP/1.1 Validator 기반 보강 로직]
-        // - 명세 기반 상태코드 분기
-        // - Host 필수 검증
-        // - Version 검사
-        // - Method 구현 여부 검사
-        // =====================================================
-
-        while (true)
-        {
-            HttpRequest req;
-            std::string& in = conn->inBuf();
-
-            // raw buffer 기반 파싱 시도
-            req.appendData(in);
-
-            // 명세 기반 검증 수행
-            HttpParseResult result = HttpRequestValidator::validate(req);
-
-            // 1) 아직 데이터 부족 (partial read)
-            if (result.getStatus() == HttpParseResult::PARSE_NEED_MORE)
-            {
-                break ;
-            }
-
-            // 2) 파싱 에러 (정확한 HTTP 상태코드 사용)
-            if (result.getStatus() == HttpParseResult::PARSE_ERROR)
-            {
-                const ServerConfig& cfg = pickDefaultServerConfigForFd(fd);
-                HttpResponse resp = buildErrorResponse(result.getHttpStatusCode(), cfg);
-
-                std::string bytes = resp.toString();
-                conn->queueWrite(bytes);
-                conn->closeAfterWrite();
-                break ;
-            }
-
-            // 3) 정상 파싱 완료
-            if (result.getStatus() == HttpParseResult::PARSE_COMPLETE)
-            {
-                // 두번째 요청 있을 경우, 첫번째 요청(consumedLength)까지 지우기 -> 다음 요청을 남겨둬야함
-                in.erase(0, result.getConsumedLength());
-
-                const ServerConfig& cfg = pickServerConfig(fd, req);
-                if (exceedsClientMaxBodySize(req, cfg.getClientMaxBodySize())) {
-                    HttpResponse resp = buildErrorResponse(413, cfg);
-                    std::string bytes = resp.toString();
-                    conn->queueWrite(bytes);
-                    conn->closeAfterWrite();
-                    break ;
-                }
-
-                conn->incRequestCount();
-                onRequest(fd, req);
-
-                if (conn->shouldCloseAfterWrite())
-                    break ;
-                if (conn->requestCount() >= _maxKeepAlive)
-                {
-                    conn->closeAfterWrite();
-                    break ;
-                }
-            }
-        }
+        processInput(fd, conn);
+        // 이번 read로 만든 응답들 (pipelining이면 여러 개)을 EPOLLOUT을 기다리지 않고 바로 한 번에 보낸다
+        // 이미 WRITE를 기다리는 중이면 소켓 버퍼가 찬 것이므로 그대로 둔다
+        if (conn->hasPendingWrite() && !conn->writeArmed())
+            ev |= EventLoop::EVENT_WRITE;
     }
 
-    if (ev & POLLOUT) {
+    if (ev & EventLoop::EVENT_WRITE) {
         if (!conn->onWritable()) { removeConn(fd); return ; }
+        resumeCgiOutput(conn);
     }
 
     updatePollEventsFor(fd);
-    _pfds[idx].revents = 0;
 }
 
 
@@ -416,60 +559,216 @@ void    Server::handleClientEvent(size_t idx)
     _pfds[idx].revents = 0;
 }*/
 
-void Server::updatePollEventsFor(int fd) {
-    Connection* conn = _conns[fd];
-    for (size_t i = 0; i < _pfds.size(); ++i) {
-        if (isListenFd(_pfds[i].fd)) continue; // 리스너는 항상 POLLIN 유지
-        if (_pfds[i].fd == fd) {
-            short e = POLLIN;
-            if (conn->hasPendingWrite()) e |= POLLOUT;
-            _pfds[i].events = e;
-            return;
+// inBuf에 쌓인 바이트로 요청을 파싱/처리 (pipelining이면 여러 개)
+void Server::processInput(int fd, Connection* conn)
+{
+    // =====================================================
+    // [HTTP/1.1 Validator 기반 보강 로직]
+    // - 명세 기반 상태코드 분기
+    // - Host 필수 검증
+    // - Version 검사
+    // - Method 구현 여부 검사
+    // =====================================================
+
+    // 앞 요청의 응답을 CGI / upstream / single-flight가 만드는 동안에도 다음 요청을 처리한다
+    // 응답은 요청마다 연 자리에 모였다가 요청 순서대로 나간다 (Connection::beginResponse)
+    // GET / HEAD가 아닌 요청의 응답이 남아 있으면 그 뒤 요청은 기다린다 (부수 효과 순서)
+    while (!conn->shouldCloseAfterWrite() && conn->openResponses() < PIPELINE_MAX
+           && !conn->pipelineBlocked())
+    {
+        // 연결에 붙어 있는 파서가 새 바이트만 이어서 파싱
+        HttpRequest& req = conn->request();
+        req.consume(conn->inBuf());
+        // 헤더까지 읽었으면 server 블록을 골라 바디 한도 / 메모리 버퍼 크기를 정하고 이어서 읽는다
+        // 헤더 검사에서 거부할 요청은 바디를 받지 않는다 (multipart 업로드 파일을 만들기 전에)
+        HttpParseResult result(HttpParseResult::PARSE_NEED_MORE, 0, 0);
+        if (req.awaitingBodyPolicy())
+        {
+            result = HttpRequestValidator::validateHeaders(req);
+            if (result.getStatus() != HttpParseResult::PARSE_ERROR)
+            {
+                const ServerConfig& cfg = pickServerConfig(conn, req);
+                prepareBodyStreaming(req, cfg);
+                req.setBodyPolicy(cfg.getClientMaxBodySize(), cfg.getClientBodyBufferSize());
+                req.consume(conn->inBuf());
+            }
+        }
+
+        // 명세 기반 검증 수행
+        if (result.getStatus() != HttpParseResult::PARSE_ERROR)
+            result = HttpRequestValidator::validate(req);
+
+        // 1) 아직 데이터 부족 (partial read)
+        if (result.getStatus() == HttpParseResult::PARSE_NEED_MORE)
+        {
+            break ;
+        }
+
+        // 2) 파싱 에러 (정확한 HTTP 상태코드 사용)
+        if (result.getStatus() == HttpParseResult::PARSE_ERROR)
+        {
+            const ServerConfig& cfg = pickDefaultServerConfig(conn);
+            HttpResponse resp = buildErrorResponse(result.getHttpStatusCode(), cfg);
+            if (req.getMethod() == "HEAD")
+                resp.dropBody();
+
+            unsigned long id = conn->beginResponse();
+            queueResponse(conn, resp);
+            conn->endResponse(id);
+            conn->closeAfterWrite();
+            break ;
+        }
+
+        // 3) 정상 파싱 완료
+        // 요청 바이트는 consume()이 이미 in에서 제거함 -> 다음 요청만 남아 있음
+        if (result.getStatus() == HttpParseResult::PARSE_COMPLETE)
+        {
+            conn->incRequestCount();
+            ++_statRequests;
+            unsigned long id = conn->beginResponse();
+            const bool safe = (req.getMethod() == "GET" || req.getMethod() == "HEAD");
+            // close 요청 뒤의 pipelined 요청은 처리하지 않는다 (RFC 9112 9.6)
+            const bool keepAlive = wantsKeepAlive(conn, req);
+            onRequest(fd, req);
+            // single-flight 대기면 요청은 응답 자리로 옮겨졌고 파서는 이미 새 요청
+            conn->resetRequest();
+
+            // CGI 진행 중 / 대기: 응답은 끝날 때 닫는다 (closeAfterWrite도 그때)
+            // 그때까지 뒤 요청을 시작하지 않도록 막아 둔다
+            if (!conn->responseBusy(id))
+                conn->endResponse(id);
+            else if (!safe || !keepAlive)
+                conn->blockPipeline(id);
+            if (!keepAlive || conn->shouldCloseAfterWrite())
+                break ;
+            if (conn->requestCount() >= _maxKeepAlive)
+            {
+                conn->closeAfterWrite();
+                break ;
+            }
         }
     }
 }
 
+// onRequest와 같은 순서로 라우팅해서 결국 POSTHandler의 multipart 업로드로 갈 요청만 고른다
+void Server::prepareBodyStreaming(HttpRequest& req, const ServerConfig& cfg) {
+    if (req.getMethod() != "POST")
+        return;
+    const LocationConfig* location = routerFor(cfg).match(stripQueryString(req.getURI()));
+    if (location == NULL || !location->hasUploadStore()
+        || !hasMethod(resolveAllowedMethods(location, cfg), "POST")
+        || location->getStubStatus() || location->hasFastCgiPass() || location->hasProxyPass()
+        || locationHasCgiForUri(*location, req.getURI()))
+        return;
+
+    const std::map<std::string, std::string>& headers = req.getHeaders();
+    std::map<std::string, std::string>::const_iterator ctIt = headers.find("content-type");
+    std::string boundary;
+    if (ctIt == headers.end() || !MultipartParser::boundaryFromContentType(ctIt->second, boundary))
+        return;
+    req.streamMultipart(boundary, location->getUploadStore());
+}
+
+// hasPendingWrite 상태가 바뀐 경우에만 WRITE 관심을 토글 (불필요한 epoll_ctl 방지)
+void Server::updatePollEventsFor(int fd) {
+    std::map<int, Connection*>::iterator it = _conns.find(fd);
+    if (it == _conns.end())
+        return;
+    Connection* conn = it->second;
+    bool wantWrite = conn->hasPendingWrite();
+    if (wantWrite == conn->writeArmed())
+        return;
+    int e = EventLoop::EVENT_READ;
+    if (wantWrite) e |= EventLoop::EVENT_WRITE;
+    _loop.modify(fd, e);
+    conn->setWriteArmed(wantWrite);
+
+    // write_timeout이 idle_timeout보다 짧으면 걸려 있는 항목보다 먼저 만료될 수 있음
+    if (connDeadline(conn) < conn->timerDeadline())
+        scheduleConnTimer(conn);
+}
+
 void Server::removeConn(int fd) {
+    // close 전에 reactor에서 먼저 제거
+    _loop.remove(fd);
     std::map<int, Connection*>::iterator it = _conns.find(fd);
     if (it != _conns.end()) {
+        discardResponsesAfter(it->second, 0);
         delete it->second;
         _conns.erase(it);
     }
-    _clientPort.erase(fd);
-    for (size_t i = 0; i < _pfds.size(); ++i) {
-        if (isListenFd(_pfds[i].fd)) continue; // 리스너는 제거 대상 아님
-        if (_pfds[i].fd == fd) {
-            _pfds.erase(_pfds.begin() + i);
-            break;
-        }
-    }
     std::cout << "Closed fd=" << fd << "\n";
 }
 
+// 마지막 활동 시각 기준 deadline: 보낼 데이터가 남아 있으면 write_timeout
+// CGI 출력을 기다리는 중이면 CGI 제한 시간 (출력이 올 때마다 touch)
+std::time_t Server::connDeadline(const Connection* conn) const {
+    int limit = conn->hasPendingWrite() ? _writeTimeoutSec : _idleTimeoutSec;
+    if (conn->openResponses() > 0 && !conn->hasPendingWrite())
+        limit = CGI_TIMEOUT_SEC;
+    return conn->lastActive() + limit + 1;
+}
+
+void Server::scheduleConnTimer(Connection* conn) {
+    std::time_t deadline = connDeadline(conn);
+    conn->setTimerDeadline(deadline);
+    _timers.schedule(conn->fd(), conn->id(), deadline);
+}
+
+int Server::nextWaitTimeoutMs() const {
+    struct timeval tv;
+    ::gettimeofday(&tv, NULL);
+    long long nowMs = static_cast<long long>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+
+    long ms = _timers.msUntilNext(nowMs);
+    long untilSweep = static_cast<long>(_nextSessionSweep - tv.tv_sec) * 1000;
+    if (untilSweep < 0)
+        untilSweep = 0;
+    if (ms < 0 || untilSweep < ms)
+        ms = untilSweep;
+    return static_cast<int>(ms);
+}
+
 void Server::sweepTimeouts() {
     std::time_t now = std::time(NULL);
-    std::vector<int> toClose;
 
-    for (std::map<int, Connection*>::iterator it = _conns.begin(); it != _conns.end(); ++it) {
+    _expired.clear();
+    _timers.expire(now, _expired);
+    for (size_t i = 0; i < _expired.size(); ++i) {
+        const TimerWheel::Entry& e = _expired[i];
+        std::map<int, Connection*>::iterator it = _conns.find(e.fd);
+        // 이미 닫혔거나 fd가 재사용된 연결, 또는 더 이른 항목으로 대체된 stale 항목
+        if (it == _conns.end() || it->second->id() != e.id)
+            continue;
         Connection* c = it->second;
-        int idle = static_cast<int>(now - c->lastActive());
-        if (!c->hasPendingWrite()) {
-            if (idle > _idleTimeoutSec) toClose.push_back(it->first);
+        if (c->timerDeadline() != e.deadline)
+            continue;
+        // touch()로 deadline이 밀렸으면 그때 다시 예약
+        if (connDeadline(c) > now) {
+            scheduleConnTimer(c);
+        } else if (sendGatewayTimeout(c)) {
+            c->touch();
+            updatePollEventsFor(e.fd);
+            scheduleConnTimer(c);
         } else {
-            if (idle > _writeTimeoutSec) toClose.push_back(it->first);
+            removeConn(e.fd);
         }
     }
-    for (size_t i = 0; i < toClose.size(); ++i) removeConn(toClose[i]);
 
-    // (optional) session cleanup (very simple)
+    if (now >= _nextSessionSweep)
+        sweepSessions(now);
+}
+
+void Server::sweepSessions(std::time_t now) {
     for (std::map<std::string, Session>::iterator sit = _sessions.begin(); sit != _sessions.end(); ) {
-        if ((int)(now - sit->second.lastSeen) > 300) { // 5 minutes
+        if ((int)(now - sit->second.lastSeen) > SESSION_TTL_SEC) {
             std::map<std::string, Session>::iterator kill = sit++;
             _sessions.erase(kill);
         } else {
             ++sit;
         }
     }
+    _nextSessionSweep = now + SESSION_SWEEP_INTERVAL_SEC;
 }
 
 std::string Server::newSessionId() {
@@ -500,6 +799,12 @@ Server::Session& Server::getOrCreateSession(const HttpRequest& req, HttpResponse
         }
     }
     
+    // 주기 정리 전이라도 만료된 세션은 새 세션으로 취급
+    std::map<std::string, Session>::iterator found = _sessions.find(sid);
+    if (!sid.empty() && found != _sessions.end()
+        && (int)(std::time(NULL) - found->second.lastSeen) > SESSION_TTL_SEC)
+        _sessions.erase(found);
+
     if (sid.empty() || _sessions.find(sid) == _sessions.end()) {
         sid = newSessionId();
         _sessions[sid] = Session();
@@ -514,92 +819,135 @@ bool Server::isListenFd(int fd) const {
     return _listenFdSet.find(fd) != _listenFdSet.end();
 }
 
-std::string Server::extractHostName(const HttpRequest& req) const {
+// Host -> server 블록: 포트별 해시 테이블 한 번 조회 (없으면 포트의 첫 server)
+const ServerConfig& Server::pickServerConfig(const Connection* conn, const HttpRequest& req) const {
+    const VhostTable* table = conn->vhosts();
+    if (table == NULL)
+        return _configs[0];
+
     const std::map<std::string, std::string>& headers = req.getHeaders();
     std::map<std::string, std::string>::const_iterator it = headers.find("host");
-    if (it == headers.end())
-        return "";
-
-    std::string host = it->second;
-    while (!host.empty() && std::isspace(static_cast<unsigned char>(host[0])))
-        host.erase(0, 1);
-    while (!host.empty() && std::isspace(static_cast<unsigned char>(host[host.size() - 1])))
-        host.erase(host.size() - 1);
-
-    if (host.empty())
-        return "";
-
-    if (host[0] == '[') {
-        size_t end = host.find(']');
-        if (end != std::string::npos)
-            return toLowerAscii(host.substr(0, end + 1));
-        return toLowerAscii(host);
-    }
-
-    size_t colon = host.find(':');
-    if (colon != std::string::npos)
-        return toLowerAscii(host.substr(0, colon));
-    return toLowerAscii(host);
+    const ServerConfig* cfg = (it != headers.end()) ? table->lookup(it->second)
+                                                    : table->defaultServer();
+    return cfg ? *cfg : _configs[0];
 }
 
-const ServerConfig& Server::pickServerConfig(int fd, const HttpRequest& req) const {
-    std::map<int, int>::const_iterator pIt = _clientPort.find(fd);
-    int port = (pIt != _clientPort.end()) ? pIt->second : _port;
-    const std::string host = extractHostName(req);
+const ServerConfig& Server::pickDefaultServerConfig(const Connection* conn) const {
+    const VhostTable* table = conn->vhosts();
+    if (table == NULL || table->defaultServer() == NULL)
+        return _configs[0];
+    return *table->defaultServer();
+}
 
-    const ServerConfig* fallback = NULL;
-    for (size_t i = 0; i < _configs.size(); ++i) {
-        const ServerConfig& cfg = _configs[i];
-        const std::vector<int> ports = cfg.getListenPorts();
-        bool matchPort = false;
-        for (size_t j = 0; j < ports.size(); ++j) {
-            if (ports[j] == port) {
-                matchPort = true;
-                break;
-            }
-        }
-        if (!matchPort)
-            continue;
+// cfg는 항상 _configs의 원소 (pickServerConfig 계열이 참조를 돌려줌)
+const Router& Server::routerFor(const ServerConfig& cfg) const {
+    return _routers[static_cast<size_t>(&cfg - &_configs[0])];
+}
 
-        if (!fallback)
-            fallback = &cfg;
+FileCache* Server::fileCacheFor(const LocationConfig* loc) const {
+    std::map<const LocationConfig*, FileCache*>::const_iterator it = _fileCaches.find(loc);
+    return (it != _fileCaches.end()) ? it->second : NULL;
+}
 
-        if (host.empty())
-            continue;
+// nginx stub_status와 비슷한 텍스트 형식 + 파일 캐시 합계
+HttpResponse Server::buildStubStatusResponse() const {
+    FileCache::Stats total;
+    total.hits = total.misses = total.evictions = 0;
+    total.entries = total.bytes = 0;
+    for (std::map<const LocationConfig*, FileCache*>::const_iterator it = _fileCaches.begin();
+         it != _fileCaches.end(); ++it) {
+        FileCache::Stats s = it->second->stats();
+        total.hits += s.hits;
+        total.misses += s.misses;
+        total.evictions += s.evictions;
+        total.entries += s.entries;
+        total.bytes += s.bytes;
+    }
 
-        if (cfg.hasServerNames()) {
-            const std::vector<std::string>& names = cfg.getServerNames();
-            for (size_t k = 0; k < names.size(); ++k) {
-                if (toLowerAscii(names[k]) == host)
-                    return cfg;
-            }
+    std::ostringstream oss;
+    oss << "Active connections: " << _conns.size() << "\n"
+        << "server accepts handled requests\n"
+        << " " << _statAccepted << " " << _statAccepted << " " << _statRequests << "\n"
+        << "coalesced\n"
+        << " " << _statCoalesced << "\n"
+        << "file_cache hits misses evictions entries bytes\n"
+        << " " << total.hits << " " << total.misses << " " << total.evictions
+        << " " << total.entries << " " << total.bytes << "\n";
+    // cache_path 응답 캐시 합계
+    if (!_responseCaches.empty()) {
+        ResponseCache::Stats rc;
+        rc.hits = rc.misses = rc.stores = rc.evictions = 0;
+        rc.entries = rc.bytes = 0;
+        for (std::map<std::string, ResponseCache*>::const_iterator it = _responseCaches.begin();
+             it != _responseCaches.end(); ++it) {
+            ResponseCache::Stats s = it->second->stats();
+            rc.hits += s.hits;
+            rc.misses += s.misses;
+            rc.stores += s.stores;
+            rc.evictions += s.evictions;
+            rc.entries += s.entries;
+            rc.bytes += s.bytes;
         }
+        oss << "response_cache hits misses stores evictions entries bytes\n"
+            << " " << rc.hits << " " << rc.misses << " " << rc.stores << " " << rc.evictions
+            << " " << rc.entries << " " << rc.bytes << "\n";
+    }
+    // proxy_pass backend별 상태 (이 worker 기준)
+    if (!_upstreamGroups.empty()) {
+        oss << "upstream backend state active requests fails\n";
+        for (std::map<std::string, UpstreamGroup*>::const_iterator it = _upstreamGroups.begin();
+             it != _upstreamGroups.end(); ++it)
+            it->second->writeStatus(oss);
     }
 
-    if (fallback)
-        return *fallback;
-    return _configs[0];
+    HttpResponse resp;
+    resp.setStatus(200);
+    resp.setContentType("text/plain");
+    resp.setHeader("Cache-Control", "no-cache");
+    resp.setBody(oss.str());
+    return resp;
 }
 
-const ServerConfig& Server::pickDefaultServerConfigForFd(int fd) const {
-    std::map<int, int>::const_iterator pIt = _clientPort.find(fd);
-    int port = (pIt != _clientPort.end()) ? pIt->second : _port;
+// 바디는 캐시에서 공유 (HTML 생성 / 에러 페이지 파일 읽기는 처음 한 번만)
+// 상태 코드별 error_page가 있으면 그 파일, 없으면 server 기본 에러 페이지
+HttpResponse Server::buildErrorResponse(int code, const ServerConfig& cfg,
+                                        const std::string& acceptEncoding) {
+    const std::map<int, std::string>& pages = cfg.getErrorPages();
+    std::map<int, std::string>::const_iterator it = pages.find(code);
+    const std::string& path = (it != pages.end()) ? it->second : cfg.getErrorPage();
+    return _errorPages.build(code, path, GzipFilter(cfg), acceptEncoding);
+}
 
-    for (size_t i = 0; i < _configs.size(); ++i) {
-        const ServerConfig& cfg = _configs[i];
-        const std::vector<int> ports = cfg.getListenPorts();
-        for (size_t j = 0; j < ports.size(); ++j) {
-            if (ports[j] == port)
-                return cfg;
+void Server::queueResponse(Connection* conn, HttpResponse& resp, int fileFd) {
+    // 작은 바디는 헤더와 같은 버퍼에 붙여 iovec 하나로 보낸다
+    static const size_t INLINE_BODY_MAX = 4096;
+
+    std::string& out = conn->appendBuffer();
+    resp.appendHeaders(out);
+
+    if (fileFd >= 0 && !resp.getFileSegments().empty()) {
+        // Range 응답: 구간마다 fd를 하나씩 (queueFile이 소유권을 가져감)
+        const std::vector<HttpResponse::FileSegment>& segs = resp.getFileSegments();
+        for (size_t i = 0; i < segs.size(); ++i) {
+            if (!segs[i].prefix.empty())
+                conn->appendBuffer().append(segs[i].prefix);
+            int fd = (i + 1 == segs.size()) ? fileFd : ::dup(fileFd);
+            conn->queueFile(fd, segs[i].offset, segs[i].length);
         }
+        if (!resp.getFileSuffix().empty())
+            conn->appendBuffer().append(resp.getFileSuffix());
+    } else if (fileFd >= 0) {
+        conn->queueFile(fileFd, 0, resp.getFileLength());
+    } else if (resp.hasSharedBody()) {
+        conn->queueShared(resp.getSharedBody());
+    } else {
+        std::string body;
+        resp.takeBody(body);
+        if (body.size() <= INLINE_BODY_MAX)
+            out.append(body);
+        else
+            conn->queueOwned(body);
     }
-    return _configs[0];
-}
-
-HttpResponse Server::buildErrorResponse(int code, const ServerConfig& cfg) const {
-    std::map<int, std::string> errorPages;
-    errorPages[code] = cfg.getErrorPage();
-    return ErrorHandler::buildError(code, errorPages);
 }
 
 bool Server::isMethodAllowed(const ServerConfig& cfg, const std::string& method) const {
@@ -613,12 +961,8 @@ bool Server::isMethodAllowed(const ServerConfig& cfg, const std::string& method)
     return false;
 }
 
-void Server::onRequest(int fd, const HttpRequest& req) {
-    Connection* conn = _conns[fd];
-
-    const ServerConfig& cfg = pickServerConfig(fd, req);
-
-    // keep-alive decision
+// keep-alive decision
+bool Server::wantsKeepAlive(const Connection* conn, const HttpRequest& req) const {
     bool keepAlive = (req.getVersion() == "HTTP/1.1");
     const std::map<std::string, std::string>& headers = req.getHeaders();
     std::map<std::string, std::string>::const_iterator connIt = headers.find("connection");
@@ -633,31 +977,67 @@ void Server::onRequest(int fd, const HttpRequest& req) {
 
     if (conn->requestCount() >= (_maxKeepAlive - 1))
         keepAlive = false;
+    return keepAlive;
+}
+
+void Server::onRequest(int fd, const HttpRequest& req, bool coalesce) {
+    Connection* conn = _conns[fd];
+
+    const ServerConfig& cfg = pickServerConfig(conn, req);
+    const bool keepAlive = wantsKeepAlive(conn, req);
 
     HttpResponse resp;
     const std::string uriPath = stripQueryString(req.getURI());
+    const GzipFilter gzip(cfg);
+    const std::string acceptEncoding = requestAcceptEncoding(req);
 
-    Router router;
-    const std::vector<LocationConfig>& locations = cfg.getLocations();
-    for (size_t i = 0; i < locations.size(); ++i)
-        router.addLocation(locations[i]);
-    const LocationConfig* location = router.match(uriPath);
+    const LocationConfig* location = routerFor(cfg).match(uriPath);
     const std::vector<std::string> allowedMethods = resolveAllowedMethods(location, cfg);
     const std::string allowHeader = buildAllowHeaderValue(allowedMethods);
+    // cache_path location의 GET / HEAD: 캐시 키 (Host + URI)와 single-flight 키 (server 블록 + 캐시 키)
+    ResponseCache* cache = NULL;
+    std::string cacheKey;
+    std::string flightKey;
+    if (location != NULL && isSharedRequest(*location, req)) {
+        cache = responseCacheFor(*location);
+        cacheKey = responseCacheKey(req);
+        std::ostringstream vhost;
+        vhost << (&cfg - &_configs[0]) << " ";
+        flightKey = vhost.str() + cacheKey;
+    }
 
     if (location == NULL) {
-        resp = buildErrorResponse(404, cfg);
+        resp = buildErrorResponse(404, cfg, acceptEncoding);
     } else {
         bool allowed = hasMethod(allowedMethods, req.getMethod());
 
         if (!allowed) {
-            resp = buildErrorResponse(405, cfg);
+            resp = buildErrorResponse(405, cfg, acceptEncoding);
             resp.setHeader("Allow", allowHeader);
+        } else if (location->getStubStatus()) {
+            resp = buildStubStatusResponse();
+        } else if (cache != NULL && serveFromCache(conn, req, cache, cacheKey, keepAlive)) {
+            return;
+        } else if (coalesce && !flightKey.empty() && joinFlight(conn, flightKey)) {
+            return;
+        } else if (location->hasProxyPass()) {
+            if (startProxy(conn, req, *location, cfg, keepAlive, resp)) {
+                beginFlight(conn, req, *location, cache, cacheKey, flightKey);
+                return;
+            }
+        } else if (location->hasFastCgiPass()) {
+            if (startFastCgi(conn, req, *location, cfg, keepAlive, resp)) {
+                beginFlight(conn, req, *location, cache, cacheKey, flightKey);
+                return;
+            }
         } else if (locationHasCgiForUri(*location, req.getURI())) {
-            CgiHandler cgiHandler;
-            resp = cgiHandler.handle(req, *location);
-        } else if (req.getMethod() == "GET") {
-            GETHandler getHandler;
+            // 성공하면 응답은 CGI 출력이 도착할 때 큐에 들어간다
+            if (startCgi(conn, req, *location, cfg, keepAlive, resp)) {
+                beginFlight(conn, req, *location, cache, cacheKey, flightKey);
+                return;
+            }
+        } else if (req.getMethod() == "GET" || req.getMethod() == "HEAD") {
+            GETHandler getHandler(fileCacheFor(location), &gzip);
             resp = getHandler.handle(req, *location);
         } else if (req.getMethod() == "POST") {
             size_t maxBody = cfg.hasClientMaxBodySize() ? cfg.getClientMaxBodySize() : 0;
@@ -667,24 +1047,1127 @@ void Server::onRequest(int fd, const HttpRequest& req) {
             DELETEHandler deleteHandler;
             resp = deleteHandler.handle(req, *location);
         } else {
-            resp = buildErrorResponse(501, cfg);
+            resp = buildErrorResponse(501, cfg, acceptEncoding);
         }
 
         if (resp.getStatusCode() >= 400) {
             int code = resp.getStatusCode();
-            HttpResponse errResp = buildErrorResponse(code, cfg);
+            HttpResponse errResp = buildErrorResponse(code, cfg, acceptEncoding);
             if (code == 405)
                 errResp.setHeader("Allow", allowHeader);
+            if (code == 416)
+                errResp.setHeader("Content-Range", resp.getHeader("Content-Range"));
             resp = errResp;
         }
 
     }
 
+    // 파일 바디는 여기서 open: 실패하면 헤더를 보내기 전에 에러 응답으로 교체
+    int fileFd = -1;
+    if (resp.hasFileBody()) {
+        if (resp.getFileFd() >= 0)
+            fileFd = ::dup(resp.getFileFd());
+        else
+            fileFd = ::open(resp.getFilePath().c_str(), O_RDONLY);
+        if (fileFd < 0)
+            resp = buildErrorResponse(403, cfg, acceptEncoding);
+    }
+
+    // 메모리 바디 (autoindex 등)는 gzip 설정에 따라 압축 (에러 페이지는 캐시된 압축본)
+    if (fileFd < 0)
+        gzip.apply(acceptEncoding, resp);
+
+    // HEAD: GET과 같은 헤더 (Content-Length / Content-Encoding 포함), 바디는 보내지 않는다
+    if (req.getMethod() == "HEAD") {
+        if (fileFd >= 0)
+            ::close(fileFd);
+        fileFd = -1;
+        resp.dropBody();
+    }
+
     // Connection 헤더 설정
     resp.setKeepAlive(keepAlive, _idleTimeoutSec, _maxKeepAlive);
 
-    std::string bytes = resp.toString();
-    conn->queueWrite(bytes);
+    queueResponse(conn, resp, fileFd);
 
     if (!keepAlive) conn->closeAfterWrite();
 }
+
+// =========================
+// Response cache (cache_path) / single-flight
+// =========================
+
+ResponseCache* Server::responseCacheFor(const LocationConfig& loc) const {
+    if (!loc.hasCachePath())
+        return NULL;
+    std::map<std::string, ResponseCache*>::const_iterator it = _responseCaches.find(loc.getCachePath());
+    return (it != _responseCaches.end()) ? it->second : NULL;
+}
+
+bool Server::serveFromCache(Connection* conn, const HttpRequest& req, ResponseCache* cache,
+                            const std::string& key, bool keepAlive) {
+    const ResponseCache::Entry* e = cache->lookup(key, req.getHeaders());
+    if (e == NULL)
+        return false;
+    int fileFd = -1;
+    if (req.getMethod() != "HEAD" && e->size > 0) {
+        // 다른 프로세스가 지웠으면 항목을 버리고 miss로
+        fileFd = ::open(e->file.c_str(), O_RDONLY);
+        if (fileFd < 0) {
+            cache->invalidate(e);
+            return false;
+        }
+    }
+
+    HttpResponse resp;
+    resp.setStatus(e->status);
+    for (size_t i = 0; i < e->headers.size(); ++i) {
+        if (strcasecmp(e->headers[i].first.c_str(), "age") != 0)
+            resp.addHeader(e->headers[i].first, e->headers[i].second);
+    }
+    std::ostringstream age;
+    age << (std::time(NULL) - e->storedAt);
+    resp.setHeader("Age", age.str());
+    resp.setHeader("X-Cache", "HIT");
+    if (fileFd >= 0)
+        resp.setFileBody(e->file, e->size);
+    else
+        resp.setContentLength(e->size);
+    resp.setKeepAlive(keepAlive, _idleTimeoutSec, _maxKeepAlive);
+    queueResponse(conn, resp, fileFd);
+    if (!keepAlive)
+        conn->closeAfterWrite();
+    return true;
+}
+
+// 같은 요청을 이미 backend로 보냈으면 또 보내지 않고 그 응답을 기다린다
+bool Server::joinFlight(Connection* conn, const std::string& flightKey) {
+    std::map<std::string, std::vector<FlightWaiter> >::iterator it = _flights.find(flightKey);
+    if (it == _flights.end())
+        return false;
+    FlightWaiter w;
+    w.fd = conn->fd();
+    w.conn = conn->id();
+    w.response = conn->currentResponse();
+    it->second.push_back(w);
+    conn->holdRequest(w.response);
+    return true;
+}
+
+void Server::beginFlight(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                         ResponseCache* cache, const std::string& cacheKey,
+                         const std::string& flightKey) {
+    // HEAD 응답에는 바디가 없어 저장하거나 나눠 줄 수 없다
+    if (flightKey.empty() || req.getMethod() != "GET")
+        return;
+    CgiProcess* p = conn->responseCgi(conn->currentResponse());
+    p->requestHeaders = req.getHeaders();
+    if (cache != NULL) {
+        p->cache = cache;
+        p->cacheKey = cacheKey;
+        p->cacheValid = loc.getCacheValid();
+    }
+    if (_flights.find(flightKey) == _flights.end()) {
+        _flights[flightKey];
+        p->flightKey = flightKey;
+    }
+}
+
+void Server::startResponseCopy(CgiProcess* p, const HttpResponse& resp) {
+    if (p->cache == NULL && p->flightKey.empty())
+        return;
+    std::vector<ResponseCache::Header> headers;
+    if (!resp.getContentType().empty())
+        headers.push_back(ResponseCache::Header("Content-Type", resp.getContentType()));
+    headers.insert(headers.end(), resp.getHeaders().begin(), resp.getHeaders().end());
+    if (p->cache != NULL)
+        p->cacheFill = p->cache->begin(p->cacheKey, p->requestHeaders, resp.getStatusCode(),
+                                       headers, p->cacheValid);
+    if (!p->flightKey.empty() && ResponseCache::shareable(headers)) {
+        p->flightCopy = true;
+        p->flightStatus = resp.getStatusCode();
+        p->flightHeaders.swap(headers);
+    }
+}
+
+// 기다리던 요청마다: Vary가 맞으면 대표 요청의 응답 사본을 (바디는 공유 버퍼 하나로),
+// 아니면 (저장 / 공유할 수 없는 응답, 실패, 다른 variant) 각자 다시 처리 (cache hit이거나 backend로)
+void Server::endFlight(CgiProcess* p, bool complete) {
+    if (p->cacheFill != NULL) {
+        if (complete)
+            p->cache->commit(p->cacheFill);
+        else
+            p->cache->abandon(p->cacheFill);
+        p->cacheFill = NULL;
+    }
+    if (p->flightKey.empty())
+        return;
+    std::map<std::string, std::vector<FlightWaiter> >::iterator it = _flights.find(p->flightKey);
+    p->flightKey.clear();
+    if (it == _flights.end())
+        return;
+    std::vector<FlightWaiter> waiters;
+    waiters.swap(it->second);
+    _flights.erase(it);
+
+    const bool copy = complete && p->flightCopy;
+    SharedBuffer body;
+    if (copy)
+        body = SharedBuffer::adopt(p->flightBody);
+
+    for (size_t i = 0; i < waiters.size(); ++i) {
+        const FlightWaiter& w = waiters[i];
+        std::map<int, Connection*>::iterator cit = _conns.find(w.fd);
+        // 기다리는 동안 닫혔거나 fd가 재사용된 연결 / 버려진 응답 자리
+        if (cit == _conns.end() || cit->second->id() != w.conn)
+            continue;
+        Connection* conn = cit->second;
+        HttpRequest* req = conn->takeHeldRequest(w.response);
+        if (req == NULL)
+            continue;
+        int fd = conn->fd();
+        conn->touch();
+        conn->selectResponse(w.response);
+
+        if (copy && ResponseCache::sameVariant(p->flightHeaders, p->requestHeaders, req->getHeaders())) {
+            bool keepAlive = wantsKeepAlive(conn, *req);
+            HttpResponse resp;
+            resp.setStatus(p->flightStatus);
+            for (size_t h = 0; h < p->flightHeaders.size(); ++h)
+                resp.addHeader(p->flightHeaders[h].first, p->flightHeaders[h].second);
+            if (req->getMethod() == "HEAD")
+                resp.setContentLength(body.size());
+            else
+                resp.setBody(body);
+            resp.setKeepAlive(keepAlive, _idleTimeoutSec, _maxKeepAlive);
+            queueResponse(conn, resp);
+            if (!keepAlive)
+                discardResponsesAfter(conn, w.response);
+            conn->endResponse(w.response);
+            if (!keepAlive)
+                conn->closeAfterWrite();
+            ++_statCoalesced;
+        } else {
+            onRequest(fd, *req, false);
+            if (conn->shouldCloseAfterWrite())
+                discardResponsesAfter(conn, w.response);
+            if (!conn->responseBusy(w.response))
+                conn->endResponse(w.response);
+        }
+        delete req;
+        // 기다리는 동안 쌓인 pipelined 요청 (자리가 모자라 멈췄던 것)
+        processInput(fd, conn);
+        updatePollEventsFor(fd);
+    }
+}
+
+// =========================
+// CGI (non-blocking)
+// =========================
+
+static void appendChunk(std::string& out, const char* data, size_t len) {
+    char size[32];
+    std::snprintf(size, sizeof(size), "%lx\r\n", static_cast<unsigned long>(len));
+    out.append(size);
+    out.append(data, len);
+    out.append("\r\n", 2);
+}
+
+// 클라이언트로 보낼 출력을 읽어 오는 fd (CGI stdout 또는 FastCGI / proxy 연결)
+static int cgiReadFd(const CgiProcess* p) {
+    return (p->upstreamFd != -1) ? p->upstreamFd : p->outFd;
+}
+
+// upstream 연결로 아직 보낼 바이트가 남았는지 (채우지 않은 바디 포함)
+static bool upstreamHasInput(const CgiProcess* p) {
+    return p->requestPos < p->request.size() || !p->stdinDone;
+}
+
+static int cgiReadEvents(const CgiProcess* p) {
+    int e = EventLoop::EVENT_READ;
+    if (p->upstreamFd != -1 && upstreamHasInput(p))
+        e |= EventLoop::EVENT_WRITE;
+    return e;
+}
+
+// 스트리밍 응답 조각을 chunk로 (gzip이면 압축해서 sync flush: 받은 만큼은 바로 풀 수 있게)
+// 캐시 miss / 같은 요청의 대표면 클라이언트로 보내는 바디 바이트를 캐시 파일 / 메모리 사본에도
+static void copyResponseBody(CgiProcess* p, const char* data, size_t len) {
+    // 사본 한도: 넘으면 기다리는 연결은 각자 다시 처리 (캐시에 저장됐으면 hit)
+    static const size_t FLIGHT_BODY_MAX = 1024 * 1024;
+
+    if (p->cacheFill != NULL)
+        p->cacheFill->write(data, len);
+    if (!p->flightCopy)
+        return;
+    if (p->flightBody.size() + len > FLIGHT_BODY_MAX) {
+        p->flightCopy = false;
+        std::string().swap(p->flightBody);
+        return;
+    }
+    p->flightBody.append(data, len);
+}
+
+static void appendCgiChunk(CgiProcess* p, std::string& out, const char* data, size_t len) {
+    if (p->deflater == NULL) {
+        appendChunk(out, data, len);
+        copyResponseBody(p, data, len);
+        return;
+    }
+    std::string packed;
+    p->deflater->write(data, len, packed);
+    p->deflater->flush(packed);
+    appendChunk(out, packed.data(), packed.size());
+    copyResponseBody(p, packed.data(), packed.size());
+}
+
+// 요청 바디를 CgiProcess가 따로 들고 간다: 요청 객체는 곧 reset되기 때문
+// 임시 파일 바디는 fd만 dup (같은 파일, 읽기는 pread로 위치 지정)
+static bool takeCgiBody(CgiProcess* p, const HttpRequest& req) {
+    p->bodySize = req.getBodySize();
+    if (!req.isBodyInFile()) {
+        p->body = req.getBody();
+        return true;
+    }
+    p->bodyFd = ::dup(req.getBodyFd());
+    return p->bodyFd != -1;
+}
+
+// bodyPos부터 최대 max 바이트를 buf로 (메모리 바디는 복사 없이 포인터만)
+static ssize_t peekCgiBody(const CgiProcess* p, char* buf, size_t max, const char*& data) {
+    size_t left = p->bodySize - p->bodyPos;
+    size_t want = (left < max) ? left : max;
+    if (p->bodyFd == -1) {
+        data = p->body.data() + p->bodyPos;
+        return static_cast<ssize_t>(want);
+    }
+    data = buf;
+    return ::pread(p->bodyFd, buf, want, static_cast<off_t>(p->bodyPos));
+}
+
+static void releaseCgiBody(CgiProcess* p) {
+    std::string().swap(p->body);
+    if (p->bodyFd != -1) {
+        ::close(p->bodyFd);
+        p->bodyFd = -1;
+    }
+}
+
+// 보낸 레코드가 모두 나갔으면 바디 다음 조각을 STDIN 레코드로 채운다
+// 큰 바디도 한 번에 64KB 분량의 레코드만 메모리에 둔다
+static bool refillFastCgiRequest(CgiProcess* p) {
+    static const unsigned short REQUEST_ID = 1;
+    static const size_t STDIN_CHUNK = 65536;
+
+    if (p->requestPos < p->request.size() || p->stdinDone)
+        return true;
+    p->request.clear();
+    p->requestPos = 0;
+    if (p->bodyPos < p->bodySize) {
+        char buf[STDIN_CHUNK];
+        const char* data = NULL;
+        ssize_t n = peekCgiBody(p, buf, sizeof(buf), data);
+        if (n <= 0)
+            return false;
+        FastCgi::appendStream(p->request, FastCgi::STDIN, REQUEST_ID, data, static_cast<size_t>(n));
+        p->bodyPos += static_cast<size_t>(n);
+    }
+    if (p->bodyPos >= p->bodySize) {
+        FastCgi::appendStream(p->request, FastCgi::STDIN, REQUEST_ID, NULL, 0);
+        p->stdinDone = true;
+    }
+    return true;
+}
+
+// proxy_pass는 레코드 없이 바디를 그대로 이어 보낸다
+static bool refillProxyRequest(CgiProcess* p) {
+    static const size_t BODY_CHUNK = 65536;
+
+    if (p->requestPos < p->request.size() || p->stdinDone)
+        return true;
+    p->request.clear();
+    p->requestPos = 0;
+    if (p->bodyPos < p->bodySize) {
+        char buf[BODY_CHUNK];
+        const char* data = NULL;
+        ssize_t n = peekCgiBody(p, buf, sizeof(buf), data);
+        if (n <= 0)
+            return false;
+        p->request.assign(data, static_cast<size_t>(n));
+        p->bodyPos += static_cast<size_t>(n);
+    }
+    if (p->bodyPos >= p->bodySize)
+        p->stdinDone = true;
+    return true;
+}
+
+bool Server::startCgi(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                      const ServerConfig& cfg, bool keepAlive, HttpResponse& errResp) {
+    CgiHandler handler;
+    if (!handler.prepare(req, loc, errResp))
+        return false;
+
+    int inFd = -1;
+    int outFd = -1;
+    pid_t pid = handler.spawn(inFd, outFd);
+    if (pid < 0) {
+        errResp.setStatus(502);
+        return false;
+    }
+    setNonBlocking(inFd);
+    setNonBlocking(outFd);
+
+    CgiProcess* p = new CgiProcess;
+    p->pid = pid;
+    p->inFd = inFd;
+    p->outFd = outFd;
+    p->clientFd = conn->fd();
+    p->clientId = conn->id();
+    p->cfg = &cfg;
+    p->keepAlive = keepAlive;
+    // HTTP/1.0은 chunked를 모르므로 끝까지 모아서 Content-Length로 보낸다
+    p->streaming = (req.getVersion() == "HTTP/1.1");
+    p->acceptEncoding = requestAcceptEncoding(req);
+    p->headOnly = (req.getMethod() == "HEAD");
+
+    _cgiByPid[pid] = p;
+    _cgiByFd[outFd] = p;
+    _loop.add(outFd, EventLoop::EVENT_READ);
+    // 바디를 넘길 수 없으면 stdin을 바로 닫는다: 스크립트는 짧은 입력을 보고 스스로 처리
+    if (!takeCgiBody(p, req) || p->bodySize == 0) {
+        closeCgiInput(p);
+    } else {
+        _cgiByFd[inFd] = p;
+        _loop.add(inFd, EventLoop::EVENT_WRITE);
+    }
+
+    p->response = conn->currentResponse();
+    conn->setResponseCgi(p->response, p);
+    conn->touch();
+    return true;
+}
+
+// BEGIN_REQUEST + PARAMS는 미리 인코딩하고, STDIN은 연결이 쓰기 가능해질 때마다 바디에서 채운다
+bool Server::startFastCgi(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                          const ServerConfig& cfg, bool keepAlive, HttpResponse& errResp) {
+    static const unsigned short REQUEST_ID = 1;
+
+    CgiHandler handler;
+    if (!handler.prepareFastCgi(req, loc, errResp))
+        return false;
+
+    CgiProcess* p = new CgiProcess;
+    p->pool = _fastCgiPools[loc.getFastCgiPass()];
+    p->clientFd = conn->fd();
+    p->clientId = conn->id();
+    p->cfg = &cfg;
+    p->keepAlive = keepAlive;
+    p->streaming = (req.getVersion() == "HTTP/1.1");
+    p->acceptEncoding = requestAcceptEncoding(req);
+    p->headOnly = (req.getMethod() == "HEAD");
+
+    FastCgi::appendBeginRequest(p->requestHead, REQUEST_ID, true);
+    FastCgi::appendParams(p->requestHead, REQUEST_ID, handler.environment());
+
+    if (!takeCgiBody(p, req) || !connectUpstream(p)) {
+        delete p;
+        errResp.setStatus(502);
+        return false;
+    }
+
+    p->response = conn->currentResponse();
+    conn->setResponseCgi(p->response, p);
+    conn->touch();
+    return true;
+}
+
+// 요청 헤더는 미리 만들어 두고, 바디는 연결이 쓰기 가능해질 때마다 64KB씩 채운다
+bool Server::startProxy(Connection* conn, const HttpRequest& req, const LocationConfig& loc,
+                        const ServerConfig& cfg, bool keepAlive, HttpResponse& errResp) {
+    CgiProcess* p = new CgiProcess;
+    p->proxy = true;
+    p->group = _upstreamGroups[loc.getProxyPass()];
+    p->tried.assign(p->group->size(), false);
+    p->hashKey = p->group->hashKey(req);
+    // 보낸 뒤 실패한 요청은 멱등 메서드만 다른 backend로 다시 보낸다 (POST가 두 번 처리되지 않게)
+    p->idempotent = req.getMethod() != "POST";
+    p->clientFd = conn->fd();
+    p->clientId = conn->id();
+    p->cfg = &cfg;
+    p->keepAlive = keepAlive;
+    // HTTP/1.1 요청만 여기까지 오므로 길이를 모르는 바디는 항상 chunked로 보낼 수 있다
+    p->streaming = true;
+    p->acceptEncoding = requestAcceptEncoding(req);
+    p->headOnly = (req.getMethod() == "HEAD");
+    p->upstream.reset(req.getMethod() == "HEAD");
+    ProxyHandler::buildRequestHead(req, loc, p->requestHead);
+
+    if (!takeCgiBody(p, req) || !connectProxyBackend(p)) {
+        delete p;
+        errResp.setStatus(502);
+        return false;
+    }
+
+    p->response = conn->currentResponse();
+    conn->setResponseCgi(p->response, p);
+    conn->touch();
+    return true;
+}
+
+bool Server::connectProxyBackend(CgiProcess* p) {
+    while (true) {
+        int b = p->group->pick(p->hashKey, p->tried);
+        if (b < 0) {
+            std::cerr << "proxy: all upstreams in " << p->group->name() << " failed" << std::endl;
+            return false;
+        }
+        p->tried[b] = true;
+        p->backend = b;
+        p->pool = p->group->pool(b);
+        p->group->begin(b);
+        if (connectUpstream(p))
+            return true;
+        std::cerr << "proxy: connect to " << p->group->address(b) << " failed" << std::endl;
+        releaseBackend(p, true);
+    }
+}
+
+void Server::releaseBackend(CgiProcess* p, bool failed) {
+    if (p->group == NULL || p->backend < 0)
+        return;
+    p->group->end(p->backend, failed);
+    p->backend = -1;
+}
+
+bool Server::connectUpstream(CgiProcess* p) {
+    bool reused = false;
+    int fd = p->pool->acquire(reused);
+    if (fd < 0)
+        return false;
+
+    // 새 연결마다 처음부터: 재시도 때도 같은 요청을 다시 보낸다
+    p->upstreamFd = fd;
+    p->reusedConn = reused;
+    p->requestSent = false;
+    p->request = p->requestHead;
+    p->requestPos = 0;
+    p->bodyPos = 0;
+    p->stdinDone = false;
+    _cgiByFd[fd] = p;
+    if (reused) {
+        // idle 동안에는 닫힘 감지용으로 READ만 등록되어 있었음
+        _upstreamIdle.erase(fd);
+        _loop.modify(fd, cgiReadEvents(p));
+    } else {
+        _loop.add(fd, cgiReadEvents(p));
+    }
+    return true;
+}
+
+Connection* Server::cgiClient(const CgiProcess* p) {
+    std::map<int, Connection*>::iterator it = _conns.find(p->clientFd);
+    if (it == _conns.end() || it->second->id() != p->clientId
+        || it->second->responseCgi(p->response) != p)
+        return NULL;
+    it->second->selectResponse(p->response);
+    return it->second;
+}
+
+void Server::closeCgiInput(CgiProcess* p) {
+    if (p->inFd == -1)
+        return;
+    _loop.remove(p->inFd);
+    _cgiByFd.erase(p->inFd);
+    ::close(p->inFd);
+    p->inFd = -1;
+    releaseCgiBody(p);
+}
+
+void Server::closeCgiOutput(CgiProcess* p) {
+    if (p->outFd == -1)
+        return;
+    if (!p->paused)
+        _loop.remove(p->outFd);
+    _cgiByFd.erase(p->outFd);
+    ::close(p->outFd);
+    p->outFd = -1;
+}
+
+void Server::handleCgiEvent(CgiProcess* p, int fd, int events) {
+    if (fd == p->upstreamFd && p->proxy)
+        handleProxyEvent(p, events);
+    else if (fd == p->upstreamFd)
+        handleFastCgiEvent(p, events);
+    else if (fd == p->inFd)
+        writeCgiInput(p, events);
+    else if (fd == p->outFd)
+        relayCgiOutput(p, events);
+}
+
+void Server::writeCgiInput(CgiProcess* p, int events) {
+    // 스크립트가 stdin을 닫음 (남은 body는 버림)
+    if (events & EventLoop::EVENT_ERROR) {
+        closeCgiInput(p);
+        return;
+    }
+    char buf[65536];
+    const char* data = NULL;
+    ssize_t len = peekCgiBody(p, buf, sizeof(buf), data);
+    if (len <= 0) {
+        closeCgiInput(p);
+        return;
+    }
+    ssize_t n = ::write(p->inFd, data, static_cast<size_t>(len));
+    if (n > 0)
+        p->bodyPos += static_cast<size_t>(n);
+    if (p->bodyPos >= p->bodySize)
+        closeCgiInput(p);
+}
+
+void Server::relayCgiOutput(CgiProcess* p, int events) {
+    Connection* conn = cgiClient(p);
+    if (conn == NULL) {
+        // removeConn에서 정리되므로 오지 않아야 하지만 방어적으로
+        closeCgiOutput(p);
+        return;
+    }
+
+    char buf[65536];
+    ssize_t n = ::read(p->outFd, buf, sizeof(buf));
+    if (n <= 0) {
+        // EOF, 또는 읽을 것 없이 HUP/ERR
+        if (n == 0 || (events & EventLoop::EVENT_ERROR)) {
+            closeCgiOutput(p);
+            maybeFinishCgi(p);
+        }
+        return;
+    }
+    deliverCgiOutput(p, conn, buf, static_cast<size_t>(n));
+    if (p->failed && p->pid > 0)
+        ::kill(p->pid, SIGKILL);
+}
+
+// CGI 출력(FastCGI STDOUT 포함)을 클라이언트 출력 큐로
+// p를 해제하지 않는다: 실패는 p->failed로만 알린다
+void Server::deliverCgiOutput(CgiProcess* p, Connection* conn, const char* data, size_t len) {
+    conn->touch();
+    if (p->discard || p->failed)
+        return;
+
+    if (p->streaming && p->headersSent) {
+        if (p->rawBody) {
+            conn->appendBuffer().append(data, len);
+            copyResponseBody(p, data, len);
+        } else
+            appendCgiChunk(p, conn->appendBuffer(), data, len);
+    } else {
+        p->output.append(data, len);
+        if (p->streaming)
+            sendCgiHeaders(p, conn);
+    }
+
+    // 클라이언트가 느리면 upstream에 남겨 두어 CGI가 write에서 막히게 한다
+    int fd = cgiReadFd(p);
+    if (fd != -1 && !p->paused && conn->pendingBytes(p->response) > CGI_PENDING_MAX) {
+        _loop.remove(fd);
+        p->paused = true;
+    }
+    updatePollEventsFor(p->clientFd);
+}
+
+// 헤더가 다 모이면 chunked 응답으로 바로 전달 시작
+void Server::sendCgiHeaders(CgiProcess* p, Connection* conn) {
+    size_t end = CgiHandler::findHeaderEnd(p->output);
+    if (end == std::string::npos) {
+        if (p->output.size() > CGI_HEADER_MAX) {
+            p->failed = true;
+            p->output.clear();
+        }
+        return;
+    }
+
+    CgiHandler handler;
+    std::map<std::string, std::string> cgiHeaders;
+    std::string body;
+    handler.parseCgiOutput(p->output, cgiHeaders, body);
+    std::string().swap(p->output);
+
+    HttpResponse resp;
+    handler.applyCgiHeaders(cgiHeaders, resp);
+    p->headersSent = true;
+
+    const GzipFilter gzip(*p->cfg);
+    if (resp.getStatusCode() >= 400) {
+        HttpResponse errResp = buildErrorResponse(resp.getStatusCode(), *p->cfg, p->acceptEncoding);
+        if (p->headOnly)
+            errResp.dropBody();
+        errResp.setKeepAlive(p->keepAlive, _idleTimeoutSec, _maxKeepAlive);
+        queueResponse(conn, errResp);
+        p->discard = true;
+        return;
+    }
+
+    // 길이를 모르므로 gzip_min_length는 보지 않고 타입만으로 결정
+    int status = resp.getStatusCode();
+    if (status != 204 && status != 304 && resp.getHeader("Content-Encoding").empty()
+        && gzip.matchesType(resp.getContentType())) {
+        GzipFilter::addVary(resp);
+        const char* coding = gzip.negotiate(p->acceptEncoding);
+        if (coding) {
+            resp.setHeader("Content-Encoding", coding);
+            p->deflater = new Deflater(GzipFilter::formatOf(coding), gzip.level());
+        }
+    }
+
+    startResponseCopy(p, resp);
+    if (p->cache != NULL)
+        resp.setHeader("X-Cache", "MISS");
+    resp.setChunked(true);
+    resp.setKeepAlive(p->keepAlive, _idleTimeoutSec, _maxKeepAlive);
+    std::string& out = conn->appendBuffer();
+    resp.appendHeaders(out);
+    // HEAD: 남은 CGI 출력 (바디)과 마지막 chunk는 보내지 않는다
+    if (p->headOnly) {
+        p->discard = true;
+        return;
+    }
+    if (!body.empty())
+        appendCgiChunk(p, out, body.data(), body.size());
+}
+
+void Server::resumeCgiOutput(Connection* conn) {
+    std::vector<CgiProcess*> cgis;
+    conn->collectCgis(cgis);
+    for (size_t i = 0; i < cgis.size(); ++i) {
+        CgiProcess* p = cgis[i];
+        if (!p->paused || conn->pendingBytes(p->response) > CGI_PENDING_MAX / 2)
+            continue;
+        p->paused = false;
+        int fd = cgiReadFd(p);
+        if (fd != -1)
+            _loop.add(fd, cgiReadEvents(p));
+    }
+}
+
+void Server::handleFastCgiEvent(CgiProcess* p, int events) {
+    int fd = p->upstreamFd;
+
+    if ((events & EventLoop::EVENT_WRITE) && upstreamHasInput(p)) {
+        if (!refillFastCgiRequest(p)) {
+            p->failed = true;
+            finishUpstream(p, false);
+            return;
+        }
+        ssize_t n = ::send(fd, p->request.data() + p->requestPos,
+                           p->request.size() - p->requestPos, MSG_NOSIGNAL);
+        if (n > 0) {
+            p->requestPos += static_cast<size_t>(n);
+            if (!upstreamHasInput(p))
+                _loop.modify(fd, cgiReadEvents(p));
+        }
+    }
+
+    if (!(events & (EventLoop::EVENT_READ | EventLoop::EVENT_ERROR)))
+        return;
+
+    char buf[65536];
+    ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+        p->records.append(buf, static_cast<size_t>(n));
+        processFastCgiRecords(p);
+        return;
+    }
+    if (n < 0 && !(events & EventLoop::EVENT_ERROR))
+        return;
+
+    // END_REQUEST 전에 연결이 끊김 (또는 connect 실패)
+    if (p->reusedConn && !p->gotResponse) {
+        // idle 동안 upstream이 닫은 연결: 아무것도 받지 않았으므로 새 연결로 다시 보낸다
+        _loop.remove(fd);
+        _cgiByFd.erase(fd);
+        ::close(fd);
+        p->upstreamFd = -1;
+        p->records.clear();
+        if (connectUpstream(p))
+            return;
+    }
+    p->failed = true;
+    finishUpstream(p, false);
+}
+
+void Server::processFastCgiRecords(CgiProcess* p) {
+    Connection* conn = cgiClient(p);
+    size_t pos = 0;
+    bool ended = false;
+    bool complete = false;
+    FastCgi::Record rec;
+
+    while (!ended && !p->failed && FastCgi::nextRecord(p->records, pos, rec)) {
+        if (rec.requestId != 1)
+            continue;
+        p->gotResponse = true;
+        const char* content = p->records.data() + rec.contentOffset;
+        if (rec.type == FastCgi::STDOUT && rec.contentLength > 0) {
+            if (conn != NULL)
+                deliverCgiOutput(p, conn, content, rec.contentLength);
+        } else if (rec.type == FastCgi::STDERR && rec.contentLength > 0) {
+            std::cerr << "fastcgi " << p->pool->address() << ": "
+                      << std::string(content, rec.contentLength);
+        } else if (rec.type == FastCgi::END_REQUEST && rec.contentLength >= 8) {
+            // appStatus(4바이트) 다음이 protocolStatus
+            ended = true;
+            complete = (static_cast<unsigned char>(content[4]) == FastCgi::REQUEST_COMPLETE);
+        }
+    }
+    p->records.erase(0, pos);
+
+    // 응답을 받기 시작하면 재전송할 일이 없으므로 요청 사본은 버린다
+    if (p->gotResponse && !upstreamHasInput(p)) {
+        std::string().swap(p->request);
+        std::string().swap(p->requestHead);
+        releaseCgiBody(p);
+    }
+
+    if (ended) {
+        if (!complete)
+            p->failed = true;
+        // END_REQUEST 뒤에 남은 바이트가 있으면 연결 상태를 믿을 수 없다
+        finishUpstream(p, p->records.empty() && !p->failed);
+    } else if (p->failed) {
+        finishUpstream(p, false);
+    }
+}
+
+// upstream 연결을 pool에 돌려주거나 닫고, CGI 종료 회수와 같은 경로로 응답을 마무리
+void Server::finishUpstream(CgiProcess* p, bool reusable) {
+    int fd = p->upstreamFd;
+    if (fd != -1) {
+        _cgiByFd.erase(fd);
+        if (reusable && p->pool->release(fd)) {
+            _upstreamIdle[fd] = p->pool;
+            if (p->paused)
+                _loop.add(fd, EventLoop::EVENT_READ);
+            else
+                _loop.modify(fd, EventLoop::EVENT_READ);
+        } else {
+            if (!p->paused)
+                _loop.remove(fd);
+            ::close(fd);
+        }
+        p->upstreamFd = -1;
+    }
+    // proxy: 끊김 / 잘못된 응답 / 5xx는 backend 실패로 센다 (passive health check)
+    releaseBackend(p, p->failed || p->upstream.status() >= 500);
+    p->paused = false;
+    p->exited = true;
+    maybeFinishCgi(p);
+}
+
+void Server::handleProxyEvent(CgiProcess* p, int events) {
+    int fd = p->upstreamFd;
+
+    if ((events & EventLoop::EVENT_WRITE) && upstreamHasInput(p)) {
+        if (!refillProxyRequest(p)) {
+            p->failed = true;
+            finishUpstream(p, false);
+            return;
+        }
+        ssize_t n = ::send(fd, p->request.data() + p->requestPos,
+                           p->request.size() - p->requestPos, MSG_NOSIGNAL);
+        if (n > 0) {
+            p->requestSent = true;
+            p->requestPos += static_cast<size_t>(n);
+            if (!upstreamHasInput(p))
+                _loop.modify(fd, cgiReadEvents(p));
+        }
+    }
+
+    if (!(events & (EventLoop::EVENT_READ | EventLoop::EVENT_ERROR)))
+        return;
+
+    char buf[65536];
+    ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+        relayProxyOutput(p, buf, static_cast<size_t>(n));
+        return;
+    }
+    if (n < 0 && !(events & EventLoop::EVENT_ERROR))
+        return;
+
+    // 응답이 끝나기 전에 연결이 끊김 (또는 connect 실패)
+    if (!p->gotResponse) {
+        _loop.remove(fd);
+        _cgiByFd.erase(fd);
+        ::close(fd);
+        p->upstreamFd = -1;
+        // idle 동안 upstream이 닫은 연결: 아무것도 받지 않았으므로 같은 backend에 새 연결로
+        if (p->reusedConn && connectUpstream(p))
+            return;
+        // backend 실패로 기록하고, 아직 보내지 않았거나 멱등 요청이면 다른 backend로
+        releaseBackend(p, true);
+        if ((!p->requestSent || p->idempotent) && connectProxyBackend(p))
+            return;
+        p->failed = true;
+        finishUpstream(p, false);
+        return;
+    }
+    // 길이 없이 연결 종료로 끝나는 바디면 정상 종료
+    if (p->upstream.closed() != ProxyHandler::DONE)
+        p->failed = true;
+    finishUpstream(p, false);
+}
+
+// upstream 응답 바이트를 해석해서 헤더가 완성되면 응답 헤더를, 그 뒤로는 바디를 받는 대로 전달
+void Server::relayProxyOutput(CgiProcess* p, const char* data, size_t len) {
+    p->gotResponse = true;
+    std::string body;
+    ProxyHandler::State state = p->upstream.feed(data, len, body);
+    if (state == ProxyHandler::FAILED) {
+        std::cerr << "proxy " << p->pool->address() << ": invalid upstream response\n";
+        p->failed = true;
+        finishUpstream(p, false);
+        return;
+    }
+
+    Connection* conn = cgiClient(p);
+    if (conn != NULL && state != ProxyHandler::HEAD) {
+        if (!p->headersSent)
+            sendProxyHeaders(p, conn);
+        if (!body.empty())
+            deliverCgiOutput(p, conn, body.data(), body.size());
+        else
+            updatePollEventsFor(p->clientFd);
+    }
+
+    // 응답을 받기 시작하면 재전송할 일이 없으므로 요청 사본은 버린다
+    if (!upstreamHasInput(p)) {
+        std::string().swap(p->request);
+        std::string().swap(p->requestHead);
+        releaseCgiBody(p);
+    }
+
+    // 바디를 다 보내기 전에 응답이 끝났으면 연결 상태를 믿을 수 없다
+    if (state == ProxyHandler::DONE)
+        finishUpstream(p, p->upstream.reusable() && !upstreamHasInput(p));
+}
+
+// upstream 상태 / 헤더를 그대로 전달 (에러 상태도 upstream 페이지 그대로)
+// 길이를 알면 Content-Length로 바디를 그대로, 모르거나 압축하면 chunked로 다시 감싼다
+void Server::sendProxyHeaders(CgiProcess* p, Connection* conn) {
+    const ProxyHandler& up = p->upstream;
+    HttpResponse resp;
+    resp.setStatus(up.status());
+    const std::vector<ProxyHandler::Header>& headers = up.headers();
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (ProxyHandler::passResponseHeader(headers[i].first))
+            resp.addHeader(headers[i].first, headers[i].second);
+    }
+    p->headersSent = true;
+
+    const GzipFilter gzip(*p->cfg);
+    const std::string type = resp.getContentType();
+    const bool bodyless = (up.status() == 204 || up.status() == 304);
+    if ((up.hasBody() || (p->headOnly && !bodyless)) && up.status() != 206
+        && resp.getHeader("Content-Encoding").empty() && gzip.matchesType(type)) {
+        GzipFilter::addVary(resp);
+        // 길이를 알면 gzip_min_length도 본다
+        const char* coding = gzip.negotiate(p->acceptEncoding);
+        if (coding && (!up.hasLength() || gzip.matches(type, up.length()))) {
+            resp.setHeader("Content-Encoding", coding);
+            p->deflater = new Deflater(GzipFilter::formatOf(coding), gzip.level());
+        }
+    }
+
+    startResponseCopy(p, resp);
+    if (p->cache != NULL)
+        resp.setHeader("X-Cache", "MISS");
+
+    if (p->headOnly) {
+        // HEAD: upstream 응답에는 바디가 없다. GET이었으면 보냈을 길이 헤더만 붙인다
+        p->discard = true;
+        if (p->deflater == NULL && (up.hasLength() || bodyless))
+            resp.setContentLength(up.hasLength() ? up.length() : 0);
+        else
+            resp.setChunked(true);
+    } else if (p->deflater == NULL && (up.hasLength() || !up.hasBody())) {
+        p->rawBody = true;
+        resp.setContentLength(up.hasLength() ? up.length() : 0);
+    } else {
+        resp.setChunked(true);
+    }
+    resp.setKeepAlive(p->keepAlive, _idleTimeoutSec, _maxKeepAlive);
+    resp.appendHeaders(conn->appendBuffer());
+}
+
+// idle 연결에 이벤트가 왔다면 upstream이 닫았거나 요청하지 않은 데이터: 버린다
+void Server::handleUpstreamIdleEvent(int fd) {
+    std::map<int, UpstreamPool*>::iterator it = _upstreamIdle.find(fd);
+    _loop.remove(fd);
+    it->second->dropIdle(fd);
+    _upstreamIdle.erase(it);
+}
+
+// stdout EOF와 종료 회수가 모두 끝났을 때만 응답을 마무리
+void Server::maybeFinishCgi(CgiProcess* p) {
+    if (p->outFd != -1 || !p->exited)
+        return;
+
+    Connection* conn = cgiClient(p);
+    closeCgiInput(p);
+    if (p->pid > 0)
+        _cgiByPid.erase(p->pid);
+    if (conn == NULL) {
+        endFlight(p, false);
+        delete p;
+        return;
+    }
+
+    bool keepAlive = p->keepAlive;
+
+    if (p->headersSent) {
+        if (p->discard || (p->rawBody && !p->failed)) {
+            // 에러 페이지는 이미 큐에 있음 / 길이로 끝이 정해진 바디
+        } else if (p->failed) {
+            // 마지막 chunk 없이 닫아 응답이 잘렸음을 알린다
+            keepAlive = false;
+        } else {
+            std::string& out = conn->appendBuffer();
+            if (p->deflater) {
+                std::string tail;
+                p->deflater->finish(tail);
+                appendChunk(out, tail.data(), tail.size());
+                copyResponseBody(p, tail.data(), tail.size());
+            }
+            out.append("0\r\n\r\n", 5);
+        }
+    } else {
+        const ServerConfig& cfg = *p->cfg;
+        HttpResponse resp;
+        if (p->failed || p->output.empty()) {
+            resp = buildErrorResponse(502, cfg, p->acceptEncoding);
+        } else {
+            CgiHandler handler;
+            std::map<std::string, std::string> cgiHeaders;
+            std::string body;
+            handler.parseCgiOutput(p->output, cgiHeaders, body);
+            handler.applyCgiHeaders(cgiHeaders, resp);
+            if (resp.getStatusCode() >= 400)
+                resp = buildErrorResponse(resp.getStatusCode(), cfg, p->acceptEncoding);
+            else
+                resp.setBody(body);
+        }
+        GzipFilter(cfg).apply(p->acceptEncoding, resp);
+        if (p->headOnly)
+            resp.dropBody();
+        resp.setKeepAlive(keepAlive, _idleTimeoutSec, _maxKeepAlive);
+        queueResponse(conn, resp);
+    }
+
+    // 끝까지 정상으로 보낸 응답만 저장 (잘린 바디 / 에러 페이지로 바꾼 응답은 버림)
+    endFlight(p, p->headersSent && !p->discard && !p->failed);
+    unsigned long id = p->response;
+    conn->setResponseCgi(id, NULL);
+    delete p;
+    conn->touch();
+    // 닫을 연결이면 뒤 pipelined 응답은 보내지 않는다 (잘린 chunked 응답 뒤에 붙일 수 없음)
+    if (!keepAlive)
+        discardResponsesAfter(conn, id);
+    conn->endResponse(id);
+    if (!keepAlive)
+        conn->closeAfterWrite();
+
+    // 자리가 모자라 / 이 응답 때문에 멈췄던 pipelined 요청 처리
+    int fd = conn->fd();
+    processInput(fd, conn);
+    updatePollEventsFor(fd);
+}
+
+// 클라이언트가 끊기거나 timeout: 자식은 죽이고 회수만 기다린다
+// FastCGI 연결은 요청 도중이라 재사용할 수 없으므로 닫는다
+void Server::abortCgi(Connection* conn, CgiProcess* p) {
+    conn->setResponseCgi(p->response, NULL);
+    closeCgiInput(p);
+    closeCgiOutput(p);
+    releaseBackend(p, p->failed);
+    endFlight(p, false);
+    if (p->upstreamFd != -1) {
+        if (!p->paused)
+            _loop.remove(p->upstreamFd);
+        _cgiByFd.erase(p->upstreamFd);
+        ::close(p->upstreamFd);
+        p->upstreamFd = -1;
+    }
+    if (p->pid < 0 || p->exited) {
+        if (p->pid > 0)
+            _cgiByPid.erase(p->pid);
+        delete p;
+        return;
+    }
+    ::kill(p->pid, SIGKILL);
+    p->detached = true;
+}
+
+void Server::discardResponsesAfter(Connection* conn, unsigned long id) {
+    std::vector<CgiProcess*> cgis;
+    conn->collectCgis(cgis);
+    // 대기 요청을 먼저 버려서, 아래 abort가 깨우는 single-flight 대기자에 이 연결이 끼지 않게
+    conn->dropResponsesAfter(id);
+    for (size_t i = 0; i < cgis.size(); ++i) {
+        if (cgis[i]->response > id)
+            abortCgi(conn, cgis[i]);
+    }
+}
+
+// 맨 앞 응답이 CGI / upstream / single-flight 대기로 멈춰 있는 경우
+bool Server::sendGatewayTimeout(Connection* conn) {
+    unsigned long id = conn->firstResponse();
+    if (id == 0)
+        return false;
+    CgiProcess* head = conn->responseCgi(id);
+    if (head != NULL && head->headersSent)
+        return false;
+
+    const ServerConfig& cfg = (head != NULL) ? *head->cfg : pickDefaultServerConfig(conn);
+    const std::string acceptEncoding = (head != NULL) ? head->acceptEncoding : std::string();
+    HttpResponse resp = buildErrorResponse(504, cfg, acceptEncoding);
+    HttpRequest* held = conn->takeHeldRequest(id);
+    if ((head != NULL) ? head->headOnly : (held != NULL && held->getMethod() == "HEAD"))
+        resp.dropBody();
+    delete held;
+    if (head != NULL) {
+        head->failed = true;    // upstream backend에는 실패로 기록
+        abortCgi(conn, head);
+    }
+    discardResponsesAfter(conn, id);
+
+    conn->selectResponse(id);
+    resp.setKeepAlive(false, _idleTimeoutSec, _maxKeepAlive);
+    queueResponse(conn, resp);
+    conn->endResponse(id);
+    conn->closeAfterWrite();
+    return true;
+}
+
+void Server::reapChildren() {
+    char buf[64];
+    while (::read(_sigchldFd, buf, sizeof(buf)) > 0)
+        ;
+
+    int status;
+    pid_t pid;
+    while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+        std::map<pid_t, CgiProcess*>::iterator it = _cgiByPid.find(pid);
+        if (it == _cgiByPid.end())
+            continue;
+        CgiProcess* p = it->second;
+        p->exited = true;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            p->failed = true;
+        if (p->detached) {
+            _cgiByPid.erase(it);
+            delete p;
+            continue;
+        }
+        maybeFinishCgi(p);
+    }
+}
@@ -0,0 +1,46 @@
+#include "SharedBuffer.hpp"
+
+static const std::string g_emptyBytes;
+
+SharedBuffer::SharedBuffer() : _block(NULL) {}
+
+SharedBuffer::SharedBuffer(const std::string& bytes) : _block(new Block) {
+    _block->bytes = bytes;
+    _block->refs = 1;
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : _block(other._block) {
+    if (_block) ++_block->refs;
+}
+
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other) {
+    if (_block != other._block) {
+        release();
+        _block = other._block;
+        if (_block) ++_block->refs;
+    }
+    return *this;
+}
+
+SharedBuffer::~SharedBuffer() {
+    release();
+}
+
+SharedBuffer SharedBuffer::adopt(std::string& bytes) {
+    SharedBuffer buf;
+    buf._block = new Block;
+    buf._block->bytes.swap(bytes);
+    buf._block->refs = 1;
+    return buf;
+}
+
+void SharedBuffer::release() {
+    if (_block && --_block->refs == 0)
+        delete _block;
+    _block = NULL;
+}
+
+bool SharedBuffer::isNull() const { return _block == NULL; }
+const char* SharedBuffer::data() const { return _block ? _block->bytes.data() : g_emptyBytes.data(); }
+size_t SharedBuffer::size() const { return _block ? _block->bytes.size() : 0; }
+const std::string& SharedBuffer::str() const { return _block ? _block->bytes : g_emptyBytes; }
@@ -0,0 +1,75 @@
+#include "TimerWheel.hpp"
+
+TimerWheel::TimerWheel(size_t slots)
+: _slots(slots ? slots : 1), _current(std::time(NULL)), _count(0) {}
+
+void TimerWheel::schedule(int fd, unsigned long id, std::time_t deadline) {
+    Entry e;
+    e.fd = fd;
+    e.id = id;
+    e.deadline = deadline;
+
+    // 이미 지난 deadline은 다음 tick에 바로 처리
+    std::time_t at = (deadline > _current) ? deadline : _current + 1;
+    _slots[static_cast<size_t>(at) % _slots.size()].push_back(e);
+    ++_count;
+}
+
+void TimerWheel::expire(std::time_t now, std::vector<Entry>& out) {
+    if (now <= _current)
+        return;
+
+    // 한 바퀴 이상 밀렸으면 모든 slot을 한 번씩만 본다
+    std::time_t steps = now - _current;
+    if (steps > static_cast<std::time_t>(_slots.size()))
+        steps = static_cast<std::time_t>(_slots.size());
+
+    for (std::time_t s = 1; s <= steps; ++s) {
+        std::vector<Entry>& slot = _slots[static_cast<size_t>(_current + s) % _slots.size()];
+        size_t i = 0;
+        while (i < slot.size()) {
+            if (slot[i].deadline <= now) {
+                out.push_back(slot[i]);
+                slot[i] = slot.back();
+                slot.pop_back();
+                --_count;
+            } else {
+                ++i;
+            }
+        }
+    }
+    _current = now;
+}
+
+long TimerWheel::msUntilNext(long long nowMs) const {
+    if (_count == 0)
+        return -1;
+
+    // 가까운 slot부터 보다가 이번 바퀴에 만료되는 항목을 찾으면 그게 최소값
+    std::time_t best = 0;
+    bool found = false;
+    for (size_t k = 1; k <= _slots.size(); ++k) {
+        std::time_t sec = _current + static_cast<std::time_t>(k);
+        const std::vector<Entry>& slot = _slots[static_cast<size_t>(sec) % _slots.size()];
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].deadline <= sec) {
+                best = sec;
+                found = true;
+                break;
+            }
+            if (!found || slot[i].deadline < best) {
+                best = slot[i].deadline;
+                found = true;
+            }
+        }
+        if (found && best == sec)
+            break;
+    }
+
+    long long ms = static_cast<long long>(best) * 1000 - nowMs;
+    if (ms < 0)
+        return 0;
+    return static_cast<long>(ms);
+}
+
+size_t TimerWheel::size() const { return _count; }
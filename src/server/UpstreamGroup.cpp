@@ -0,0 +1,231 @@
+#include "UpstreamGroup.hpp"
+#include "HttpRequest.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// 가상 노드 수 (weight 1당). 많을수록 분포가 고르고, 링이 커진다
+static const int VNODES_PER_WEIGHT = 160;
+
+// FNV-1a + murmur3 finalizer (FNV만으로는 "주소#번호" 같은 비슷한 키가 링에 몰린다)
+static unsigned int hashKeyString(const std::string& s) {
+    unsigned int h = 2166136261U;
+    for (size_t i = 0; i < s.size(); ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619U;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+// Cookie 헤더에서 name=value 값 (이름은 정확히 일치해야 함: "xsid"는 "sid"가 아님)
+static std::string cookieValue(const std::string& header, const std::string& name) {
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(';', pos);
+        if (end == std::string::npos)
+            end = header.size();
+        size_t start = pos;
+        while (start < end && (header[start] == ' ' || header[start] == '\t'))
+            ++start;
+        size_t eq = header.find('=', start);
+        if (eq != std::string::npos && eq < end && header.compare(start, eq - start, name) == 0
+            && eq - start == name.size())
+            return header.substr(eq + 1, end - eq - 1);
+        pos = end + 1;
+    }
+    return "";
+}
+
+UpstreamGroup::UpstreamGroup(const UpstreamConfig& cfg, size_t keepalive)
+    : _name(cfg.getName()), _balance(cfg.getBalance()), _hashKey(cfg.getHashKey()), _next(0) {
+    const std::vector<UpstreamConfig::Server>& servers = cfg.getServers();
+    for (size_t i = 0; i < servers.size(); ++i) {
+        Backend b;
+        b.address = servers[i].address;
+        b.weight = servers[i].weight;
+        b.maxFails = servers[i].maxFails;
+        b.failTimeout = servers[i].failTimeout;
+        b.pool = NULL;
+        b.currentWeight = 0;
+        b.active = 0;
+        b.requests = 0;
+        b.fails = 0;
+        b.recentFails = 0;
+        b.firstFailAt = 0;
+        b.downUntil = 0;
+        _backends.push_back(b);
+    }
+    // 풀은 vector 복사가 끝난 뒤에 만든다 (Backend 복사로 포인터가 흩어지지 않게)
+    for (size_t i = 0; i < _backends.size(); ++i)
+        _backends[i].pool = new UpstreamPool(_backends[i].address, keepalive);
+
+    if (_balance == UpstreamConfig::BALANCE_HASH) {
+        for (size_t i = 0; i < _backends.size(); ++i) {
+            int points = _backends[i].weight * VNODES_PER_WEIGHT;
+            for (int v = 0; v < points; ++v) {
+                std::ostringstream vnode;
+                vnode << _backends[i].address << "#" << v;
+                _ring.push_back(std::make_pair(hashKeyString(vnode.str()), static_cast<int>(i)));
+            }
+        }
+        std::sort(_ring.begin(), _ring.end());
+    }
+}
+
+UpstreamGroup::~UpstreamGroup() {
+    for (size_t i = 0; i < _backends.size(); ++i)
+        delete _backends[i].pool;
+}
+
+const std::string& UpstreamGroup::name() const { return _name; }
+
+size_t UpstreamGroup::size() const { return _backends.size(); }
+
+const std::string& UpstreamGroup::address(int backend) const { return _backends[backend].address; }
+
+UpstreamPool* UpstreamGroup::pool(int backend) { return _backends[backend].pool; }
+
+std::string UpstreamGroup::hashKey(const HttpRequest& request) const {
+    if (_balance != UpstreamConfig::BALANCE_HASH)
+        return "";
+    if (_hashKey == "$request_uri")
+        return request.getURI();
+    const std::map<std::string, std::string>& headers = request.getHeaders();
+    std::map<std::string, std::string>::const_iterator it = headers.find("cookie");
+    if (it == headers.end())
+        return "";
+    return cookieValue(it->second, _hashKey.substr(8));    // "$cookie_" 뒤
+}
+
+bool UpstreamGroup::usable(size_t i, const std::vector<bool>& tried, std::time_t now) const {
+    if (i < tried.size() && tried[i])
+        return false;
+    return _backends[i].downUntil <= now;
+}
+
+int UpstreamGroup::pick(const std::string& key, const std::vector<bool>& tried) {
+    std::time_t now = std::time(NULL);
+    int b;
+    // 키가 없는 요청(쿠키 없음 등)은 hash 그룹이라도 round-robin
+    if (_balance == UpstreamConfig::BALANCE_HASH && !key.empty())
+        b = pickHash(key, tried, now);
+    else if (_balance == UpstreamConfig::BALANCE_LEAST_CONN)
+        b = pickLeastConn(tried, now);
+    else
+        b = pickRoundRobin(tried, now);
+    if (b >= 0)
+        return b;
+
+    // 남은 backend가 모두 down: 요청을 버리는 대신 가장 먼저 풀릴 backend에 한 번 보내 본다
+    // (5xx 몇 번에 그룹 전체가 fail_timeout 동안 502만 내는 것을 막는다)
+    for (size_t i = 0; i < _backends.size(); ++i) {
+        if (i < tried.size() && tried[i])
+            continue;
+        if (b < 0 || _backends[i].downUntil < _backends[b].downUntil)
+            b = static_cast<int>(i);
+    }
+    return b;
+}
+
+// smooth weighted round-robin: 매번 currentWeight += weight, 가장 큰 곳을 고르고 합계만큼 뺀다
+// weight 5/1/1이면 a a b a c a a 처럼 한쪽으로 몰리지 않게 섞인다
+int UpstreamGroup::pickRoundRobin(const std::vector<bool>& tried, std::time_t now) {
+    int best = -1;
+    int total = 0;
+    for (size_t i = 0; i < _backends.size(); ++i) {
+        if (!usable(i, tried, now))
+            continue;
+        _backends[i].currentWeight += _backends[i].weight;
+        total += _backends[i].weight;
+        if (best < 0 || _backends[i].currentWeight > _backends[best].currentWeight)
+            best = static_cast<int>(i);
+    }
+    if (best >= 0)
+        _backends[best].currentWeight -= total;
+    return best;
+}
+
+// 진행 중 요청 / weight가 가장 작은 곳. 동점이면 매번 시작 위치를 돌려 한 곳에 몰리지 않게
+int UpstreamGroup::pickLeastConn(const std::vector<bool>& tried, std::time_t now) {
+    int best = -1;
+    size_t n = _backends.size();
+    for (size_t k = 0; k < n; ++k) {
+        size_t i = (_next + k) % n;
+        if (!usable(i, tried, now))
+            continue;
+        // active_i / weight_i < active_best / weight_best 를 곱셈으로
+        if (best < 0 || _backends[i].active * _backends[best].weight
+                        < _backends[best].active * _backends[i].weight)
+            best = static_cast<int>(i);
+    }
+    _next = n ? (_next + 1) % n : 0;
+    return best;
+}
+
+// 키 해시 이상인 첫 가상 노드부터 시계 방향으로, 쓸 수 있는 backend가 나올 때까지
+// backend 하나가 빠져도 그 backend의 키만 옮겨 가고 나머지 키는 그대로 남는다
+int UpstreamGroup::pickHash(const std::string& key, const std::vector<bool>& tried, std::time_t now) {
+    if (_ring.empty())
+        return -1;
+    std::vector<std::pair<unsigned int, int> >::const_iterator it =
+        std::lower_bound(_ring.begin(), _ring.end(), std::make_pair(hashKeyString(key), -1));
+    size_t start = static_cast<size_t>(it - _ring.begin());
+    std::vector<bool> seen(_backends.size(), false);
+    size_t left = _backends.size();
+    for (size_t k = 0; k < _ring.size() && left > 0; ++k) {
+        int b = _ring[(start + k) % _ring.size()].second;
+        if (seen[b])
+            continue;
+        if (usable(b, tried, now))
+            return b;
+        seen[b] = true;
+        --left;
+    }
+    return -1;
+}
+
+void UpstreamGroup::begin(int backend) {
+    ++_backends[backend].active;
+    ++_backends[backend].requests;
+}
+
+void UpstreamGroup::end(int backend, bool failed) {
+    Backend& b = _backends[backend];
+    if (b.active > 0)
+        --b.active;
+    if (!failed) {
+        // down 중에 (모두 down이라) 보낸 요청이 성공했으면 바로 복귀
+        b.recentFails = 0;
+        b.downUntil = 0;
+        return;
+    }
+    ++b.fails;
+    std::time_t now = std::time(NULL);
+    if (b.recentFails == 0 || now - b.firstFailAt >= b.failTimeout) {
+        b.recentFails = 0;
+        b.firstFailAt = now;
+    }
+    ++b.recentFails;
+    if (b.maxFails > 0 && b.recentFails >= b.maxFails && _backends.size() > 1 && b.downUntil <= now) {
+        b.downUntil = now + b.failTimeout;
+        b.recentFails = 0;
+        std::cerr << "upstream " << _name << ": " << b.address << " marked down for "
+                  << b.failTimeout << "s" << std::endl;
+    }
+}
+
+void UpstreamGroup::writeStatus(std::ostream& out) const {
+    std::time_t now = std::time(NULL);
+    for (size_t i = 0; i < _backends.size(); ++i) {
+        const Backend& b = _backends[i];
+        out << " " << _name << " " << b.address << " " << (b.downUntil > now ? "down" : "up")
+            << " " << b.active << " " << b.requests << " " << b.fails << "\n";
+    }
+}
@@ -0,0 +1,99 @@
+#include "UpstreamPool.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+UpstreamPool::UpstreamPool(const std::string& address, size_t maxIdle)
+: _address(address), _maxIdle(maxIdle), _unix(false) {
+    std::memset(&_unAddr, 0, sizeof(_unAddr));
+    std::memset(&_inAddr, 0, sizeof(_inAddr));
+
+    if (address.compare(0, 5, "unix:") == 0) {
+        std::string path = address.substr(5);
+        if (path.size() >= sizeof(_unAddr.sun_path))
+            throw std::runtime_error("upstream: unix socket path too long: " + path);
+        _unix = true;
+        _unAddr.sun_family = AF_UNIX;
+        std::memcpy(_unAddr.sun_path, path.c_str(), path.size() + 1);
+        return;
+    }
+
+    // 형식(host:port, port 범위)은 설정 파싱에서 이미 검사됨
+    size_t colon = address.rfind(':');
+    std::string host = address.substr(0, colon);
+    int port = std::atoi(address.c_str() + colon + 1);
+    if (host == "localhost")
+        host = "127.0.0.1";
+    _inAddr.sin_family = AF_INET;
+    _inAddr.sin_port = htons(static_cast<unsigned short>(port));
+    if (::inet_pton(AF_INET, host.c_str(), &_inAddr.sin_addr) != 1)
+        throw std::runtime_error("upstream: invalid IPv4 address: " + host);
+}
+
+UpstreamPool::~UpstreamPool() {
+    for (size_t i = 0; i < _idle.size(); ++i)
+        ::close(_idle[i]);
+}
+
+const std::string& UpstreamPool::address() const { return _address; }
+
+size_t UpstreamPool::idleCount() const { return _idle.size(); }
+
+int UpstreamPool::acquire(bool& reused) {
+    // 가장 최근에 돌려받은 연결부터: upstream idle timeout에 걸렸을 가능성이 가장 낮다
+    if (!_idle.empty()) {
+        int fd = _idle.back();
+        _idle.pop_back();
+        reused = true;
+        return fd;
+    }
+    reused = false;
+    return connectNew();
+}
+
+bool UpstreamPool::release(int fd) {
+    if (_idle.size() >= _maxIdle)
+        return false;
+    _idle.push_back(fd);
+    return true;
+}
+
+void UpstreamPool::dropIdle(int fd) {
+    for (size_t i = 0; i < _idle.size(); ++i) {
+        if (_idle[i] != fd)
+            continue;
+        _idle[i] = _idle.back();
+        _idle.pop_back();
+        break;
+    }
+    ::close(fd);
+}
+
+int UpstreamPool::connectNew() const {
+    int fd = ::socket(_unix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0
+        || ::fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    int rc;
+    if (_unix)
+        rc = ::connect(fd, reinterpret_cast<const sockaddr*>(&_unAddr), sizeof(_unAddr));
+    else
+        rc = ::connect(fd, reinterpret_cast<const sockaddr*>(&_inAddr), sizeof(_inAddr));
+    // 진행 중인 connect는 첫 write 가능 이벤트(또는 에러 이벤트)로 결과가 드러난다
+    if (rc < 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,123 @@
+#include "VhostTable.hpp"
+#include <cctype>
+
+static char lowerAscii(char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+VhostTable::VhostTable() : _slots(16), _used(0), _default(NULL) {
+    for (size_t i = 0; i < _slots.size(); ++i)
+        _slots[i].cfg = NULL;
+}
+
+// FNV-1a (소문자 기준)
+unsigned long VhostTable::hashLower(const char* s, size_t len) {
+    unsigned long h = 2166136261UL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(lowerAscii(s[i]));
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+bool VhostTable::equalsLower(const std::string& lowered, const char* s, size_t len) {
+    if (lowered.size() != len)
+        return false;
+    for (size_t i = 0; i < len; ++i) {
+        if (lowered[i] != lowerAscii(s[i]))
+            return false;
+    }
+    return true;
+}
+
+void VhostTable::add(const std::string& name, const ServerConfig* cfg) {
+    if (name.empty())
+        return;
+    // load factor 1/2 이하 유지
+    if ((_used + 1) * 2 > _slots.size())
+        grow();
+
+    unsigned long h = hashLower(name.data(), name.size());
+    size_t mask = _slots.size() - 1;
+    for (size_t i = h & mask; ; i = (i + 1) & mask) {
+        Slot& slot = _slots[i];
+        if (slot.name.empty()) {
+            slot.hash = h;
+            slot.name.resize(name.size());
+            for (size_t k = 0; k < name.size(); ++k)
+                slot.name[k] = lowerAscii(name[k]);
+            slot.cfg = cfg;
+            ++_used;
+            return;
+        }
+        if (slot.hash == h && equalsLower(slot.name, name.data(), name.size()))
+            return; // 먼저 등록된 server 유지
+    }
+}
+
+void VhostTable::grow() {
+    std::vector<Slot> old;
+    old.swap(_slots);
+    _slots.resize(old.size() * 2);
+    for (size_t i = 0; i < _slots.size(); ++i)
+        _slots[i].cfg = NULL;
+    _used = 0;
+
+    size_t mask = _slots.size() - 1;
+    for (size_t i = 0; i < old.size(); ++i) {
+        if (old[i].name.empty())
+            continue;
+        size_t j = old[i].hash & mask;
+        while (!_slots[j].name.empty())
+            j = (j + 1) & mask;
+        _slots[j].hash = old[i].hash;
+        _slots[j].name.swap(old[i].name);
+        _slots[j].cfg = old[i].cfg;
+        ++_used;
+    }
+}
+
+void VhostTable::setDefault(const ServerConfig* cfg) {
+    if (_default == NULL)
+        _default = cfg;
+}
+
+const ServerConfig* VhostTable::defaultServer() const { return _default; }
+
+const ServerConfig* VhostTable::lookup(const std::string& hostHeader) const {
+    // Host 값에서 이름 부분만 잘라낸다: 공백 제거, [IPv6]는 ']'까지, 그 외는 ':' 앞까지
+    const char* p = hostHeader.data();
+    size_t begin = 0;
+    size_t end = hostHeader.size();
+    while (begin < end && isSpace(p[begin]))
+        ++begin;
+    while (end > begin && isSpace(p[end - 1]))
+        --end;
+    if (begin == end || _used == 0)
+        return _default;
+
+    size_t stop = begin;
+    if (p[begin] == '[') {
+        while (stop < end && p[stop] != ']')
+            ++stop;
+        if (stop < end)
+            ++stop;
+    } else {
+        while (stop < end && p[stop] != ':')
+            ++stop;
+    }
+
+    const char* name = p + begin;
+    size_t len = stop - begin;
+    unsigned long h = hashLower(name, len);
+    size_t mask = _slots.size() - 1;
+    for (size_t i = h & mask; !_slots[i].name.empty(); i = (i + 1) & mask) {
+        if (_slots[i].hash == h && equalsLower(_slots[i].name, name, len))
+            return _slots[i].cfg;
+    }
+    return _default;
+}
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""proxy_pass 테스트용 HTTP/1.1 upstream (tests/conf_proxy.conf와 함께)
+
+    python3 tests/proxy_upstream.py 8000
+
+/info          받은 요청 줄 / 헤더와 지금까지 받은 연결 수 (Content-Length)
+/chunked       chunked 응답
+/close         길이 없이 연결 종료로 끝나는 응답
+/echo          POST 바디를 그대로 돌려준다
+/big?n=BYTES   큰 바디 (Content-Length)
+/slow          0.3초 간격으로 chunk 5개
+/status/CODE   해당 상태 코드
+/port          이 upstream의 포트 (upstream 그룹 분산 확인용)
+/count?...     /count 요청을 받은 횟수 (캐시 확인용)
+               cc=Cache-Control 값, vary=Vary 값, delay=응답 전 대기(초)
+HEAD           모든 경로: GET과 같은 헤더, 바디 없음
+"""
+import sys
+import time
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse, parse_qs
+
+connections = 0
+counted = 0
+lock = threading.Lock()
+
+
+class HeadersOnly:
+    """HEAD 응답용 wfile: 첫 write (end_headers가 한 번에 보내는 헤더)만 전달"""
+
+    def __init__(self, out):
+        self.out = out
+        self.sent = False
+
+    def write(self, data):
+        if self.sent:
+            return len(data)
+        self.sent = True
+        return self.out.write(data)
+
+    def flush(self):
+        self.out.flush()
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def setup(self):
+        global connections
+        super().setup()
+        with lock:
+            connections += 1
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def send_body(self, body, ctype="text/plain"):
+        self.send_response(200)
+        self.send_header("Content-Type", ctype)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def send_chunks(self, parts, delay=0):
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        for part in parts:
+            self.wfile.write(b"%x\r\n%s\r\n" % (len(part), part))
+            self.wfile.flush()
+            if delay:
+                time.sleep(delay)
+        self.wfile.write(b"0\r\n\r\n")
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        if url.path.endswith("/info"):
+            lines = [self.requestline]
+            lines += ["%s: %s" % (k, v) for k, v in self.headers.items()]
+            lines.append("connections: %d" % connections)
+            self.send_body(("\n".join(lines) + "\n").encode())
+        elif url.path.endswith("/port"):
+            self.send_body(b"%d\n" % self.server.server_address[1])
+        elif url.path.endswith("/count"):
+            global counted
+            q = parse_qs(url.query)
+            with lock:
+                counted += 1
+                n = counted
+            time.sleep(float(q.get("delay", ["0"])[0]))
+            body = b"count %d\n" % n
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Length", str(len(body)))
+            if "cc" in q:
+                self.send_header("Cache-Control", q["cc"][0])
+            if "vary" in q:
+                self.send_header("Vary", q["vary"][0])
+            self.end_headers()
+            self.wfile.write(body)
+        elif url.path.endswith("/chunked"):
+            self.send_chunks([b"hello ", b"chunked ", b"world\n"])
+        elif url.path.endswith("/slow"):
+            self.send_chunks([b"tick %d\n" % i for i in range(5)], 0.3)
+        elif url.path.endswith("/close"):
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(b"closed by upstream\n")
+            self.close_connection = True
+        elif url.path.endswith("/big"):
+            n = int(parse_qs(url.query).get("n", ["1048576"])[0])
+            self.send_body(b"x" * n)
+        elif "/status/" in url.path:
+            code = int(url.path.rsplit("/", 1)[1])
+            body = b"upstream status %d\n" % code
+            self.send_response(code)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+        else:
+            self.send_body(b"upstream: " + self.path.encode() + b"\n")
+
+    def do_POST(self):
+        n = int(self.headers.get("Content-Length", "0"))
+        body = self.rfile.read(n)
+        self.send_body(body, self.headers.get("Content-Type", "application/octet-stream"))
+
+    def do_HEAD(self):
+        out = self.wfile
+        self.wfile = HeadersOnly(out)
+        try:
+            self.do_GET()
+        finally:
+            self.wfile = out
+
+    do_DELETE = do_GET
+
+
+if __name__ == "__main__":
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 8000
+    ThreadingHTTPServer(("127.0.0.1", port), Handler).serve_forever()